@@ -0,0 +1,412 @@
+/**
+ * @file bench_common.cpp
+ * @brief Corpus loading, statistics and reporting helpers shared by the benchmark tools.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <sys/resource.h>
+#include "AudioFile.h"
+#include "bench_common.h"
+
+
+namespace {
+    /**
+     * @brief Reads a 16 kHz mono 16-bit wav file, empty if the format is unsupported
+     */
+    std::vector<float> read_wav(const std::filesystem::path &path) {
+        AudioFile<float> af;
+
+        if (!af.load(path.string()) ||
+            af.getNumChannels() != 1 || af.getBitDepth() != 16 ||
+            af.getSampleRate() != static_cast<uint32_t>(MoonshineBench::sample_rate))
+        {
+            return {};
+        }
+
+        return af.samples[0];
+    }
+
+    /**
+     * @brief Reads a packed file of raw float samples
+     */
+    std::vector<float> read_f32(const std::filesystem::path &path) {
+        std::ifstream ifs(path, std::ios::binary);
+
+        if (!ifs) {
+            return {};
+        }
+
+        std::vector<float> samples(std::filesystem::file_size(path) / sizeof(float));
+        ifs.read(reinterpret_cast<char *>(samples.data()), samples.size() * sizeof(float));
+
+        return samples;
+    }
+
+    /**
+     * @brief Reads a "<key>: <value> kB" line from /proc/self/status
+     */
+    size_t proc_status_bytes(const std::string &key) {
+        std::ifstream ifs("/proc/self/status");
+        std::string line;
+
+        while (std::getline(ifs, line)) {
+            if (line.compare(0, key.size(), key) == 0 && line.size() > key.size() && line[key.size()] == ':') {
+                return std::stoull(line.substr(key.size() + 1)) * 1024;
+            }
+        }
+
+        return 0;
+    }
+
+    /**
+     * @class JsonFlattener
+     * @brief Recursive descent JSON reader that keeps only numbers and booleans
+     */
+    class JsonFlattener {
+    public:
+        explicit JsonFlattener(const std::string &text) : text(text) {}
+
+        std::map<std::string, double> parse() {
+            value("");
+            skip_space();
+
+            if (pos != text.size()) {
+                fail("trailing characters");
+            }
+
+            return numbers;
+        }
+
+    private:
+        void value(const std::string &path) {
+            skip_space();
+
+            if (pos >= text.size()) {
+                fail("unexpected end");
+            }
+
+            char c = text[pos];
+
+            if (c == '{') {
+                object(path);
+            } else if (c == '[') {
+                array(path);
+            } else if (c == '"') {
+                string();
+            } else if (literal("true")) {
+                numbers[path] = 1.0;
+            } else if (literal("false")) {
+                numbers[path] = 0.0;
+            } else if (!literal("null")) {
+                char *end = nullptr;
+                double number = std::strtod(text.c_str() + pos, &end);
+
+                if (end == text.c_str() + pos) {
+                    fail("invalid value");
+                }
+
+                pos = static_cast<size_t>(end - text.c_str());
+                numbers[path] = number;
+            }
+        }
+
+        void object(const std::string &path) {
+            pos++;
+
+            if (next_is('}')) {
+                return;
+            }
+
+            do {
+                skip_space();
+                auto key = string();
+                skip_space();
+                expect(':');
+                value(path.empty() ? key : path + "." + key);
+            } while (next_is(','));
+
+            expect('}');
+        }
+
+        void array(const std::string &path) {
+            pos++;
+
+            if (next_is(']')) {
+                return;
+            }
+
+            size_t index = 0;
+
+            do {
+                auto key = std::to_string(index++);
+                value(path.empty() ? key : path + "." + key);
+            } while (next_is(','));
+
+            expect(']');
+        }
+
+        std::string string() {
+            expect('"');
+            std::string out;
+
+            while (pos < text.size() && text[pos] != '"') {
+                if (text[pos] == '\\' && pos + 1 < text.size()) {
+                    pos++;
+                }
+
+                out += text[pos++];
+            }
+
+            expect('"');
+
+            return out;
+        }
+
+        bool literal(const char *word) {
+            size_t len = std::strlen(word);
+
+            if (text.compare(pos, len, word) != 0) {
+                return false;
+            }
+
+            pos += len;
+
+            return true;
+        }
+
+        bool next_is(char c) {
+            skip_space();
+
+            if (pos < text.size() && text[pos] == c) {
+                pos++;
+                return true;
+            }
+
+            return false;
+        }
+
+        void expect(char c) {
+            if (!next_is(c)) {
+                fail(std::string("expected '") + c + "'");
+            }
+        }
+
+        void skip_space() {
+            while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) {
+                pos++;
+            }
+        }
+
+        [[noreturn]] void fail(const std::string &what) {
+            throw std::runtime_error("Invalid JSON at offset " + std::to_string(pos) + ": " + what);
+        }
+
+        const std::string &text;                /**< Document */
+        size_t pos = 0;                         /**< Read position */
+        std::map<std::string, double> numbers;  /**< Collected numbers by path */
+    };
+}
+
+
+namespace MoonshineBench {
+
+ModelSpec ModelSpec::parse(const std::vector<std::string> &args) {
+    if (args.size() < 4) {
+        throw std::runtime_error("Expected <model> <encoder.onnx> <decoder.onnx> <tok.json>");
+    }
+
+    auto type = Moonshine::ModelType::from_string(args[0]);
+
+    if (!type) {
+        throw std::runtime_error("Invalid model name. Use 'base' or 'tiny'.");
+    }
+
+    return {*type, args[1], args[2], args[3]};
+}
+
+std::unique_ptr<Moonshine::Transcriber> ModelSpec::make_transcriber(int num_threads) const {
+    return std::make_unique<Moonshine::Transcriber>(type, encoder, decoder, tokenizer, num_threads);
+}
+
+std::unique_ptr<Moonshine::Transcriber> ModelSpec::make_transcriber(const Moonshine::ModelOptions &options) const {
+    return std::make_unique<Moonshine::Transcriber>(type, encoder, decoder, tokenizer, options);
+}
+
+std::vector<Clip> load_corpus(const std::filesystem::path &path) {
+    std::vector<std::filesystem::path> files;
+
+    if (std::filesystem::is_regular_file(path)) {
+        files.push_back(path);
+    } else if (std::filesystem::is_directory(path)) {
+        for (const auto &entry : std::filesystem::directory_iterator(path)) {
+            auto ext = entry.path().extension();
+
+            if (entry.is_regular_file() && (ext == ".wav" || ext == ".f32")) {
+                files.push_back(entry.path());
+            }
+        }
+
+        std::sort(files.begin(), files.end());
+    } else {
+        throw std::runtime_error("Corpus not found: " + path.string());
+    }
+
+    std::vector<Clip> corpus;
+
+    for (const auto &file : files) {
+        auto samples = file.extension() == ".f32" ? read_f32(file) : read_wav(file);
+
+        if (samples.empty()) {
+            std::cerr << "Skipping unsupported audio file: " << file << '\n';
+            continue;
+        }
+
+        corpus.push_back({file.stem().string(), std::move(samples)});
+    }
+
+    if (corpus.empty()) {
+        throw std::runtime_error("No usable audio in corpus: " + path.string());
+    }
+
+    return corpus;
+}
+
+double percentile(std::vector<double> &values, double q) {
+    if (values.empty()) {
+        return 0.0;
+    }
+
+    std::sort(values.begin(), values.end());
+
+    auto rank = static_cast<size_t>(std::ceil(std::clamp(q, 0.0, 1.0) * values.size()));
+
+    return values[std::max<size_t>(rank, 1) - 1];
+}
+
+double mean(const std::vector<double> &values) {
+    if (values.empty()) {
+        return 0.0;
+    }
+
+    return std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+}
+
+size_t peak_rss_bytes() {
+    if (auto hwm = proc_status_bytes("VmHWM")) {
+        return hwm;
+    }
+
+    struct rusage usage{};
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+size_t current_rss_bytes() {
+    return proc_status_bytes("VmRSS");
+}
+
+std::vector<int> parse_int_list(const std::string &list) {
+    std::vector<int> values;
+    std::stringstream ss(list);
+    std::string item;
+
+    while (std::getline(ss, item, ',')) {
+        int value = std::atoi(item.c_str());
+
+        if (value <= 0) {
+            throw std::runtime_error("Expected a list of positive integers: " + list);
+        }
+
+        values.push_back(value);
+    }
+
+    return values;
+}
+
+std::string json_string(const std::string &str) {
+    std::string out = "\"";
+
+    for (char c : str) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out += buf;
+                } else {
+                    out += c;
+                }
+        }
+    }
+
+    return out + "\"";
+}
+
+std::map<std::string, double> read_json_numbers(const std::filesystem::path &path) {
+    std::ifstream ifs(path);
+
+    if (!ifs) {
+        throw std::runtime_error("Unable to open " + path.string());
+    }
+
+    std::stringstream buffer;
+    buffer << ifs.rdbuf();
+
+    return JsonFlattener(buffer.str()).parse();
+}
+
+Args::Args(int argc, char *argv[], const std::vector<std::string> &flags) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg.size() > 2 && arg.compare(0, 2, "--") == 0) {
+            bool is_flag = std::find(flags.begin(), flags.end(), arg) != flags.end();
+
+            if (!is_flag && i + 1 >= argc) {
+                throw std::runtime_error("Missing value for " + arg);
+            }
+
+            options[arg] = is_flag ? "1" : argv[++i];
+        } else {
+            positionals.push_back(arg);
+        }
+    }
+}
+
+std::string Args::get(const std::string &name, const std::string &fallback) const {
+    auto it = options.find(name);
+
+    return it == options.end() ? fallback : it->second;
+}
+
+double Args::get_number(const std::string &name, double fallback) const {
+    auto it = options.find(name);
+
+    return it == options.end() ? fallback : std::stod(it->second);
+}
+
+} // namespace MoonshineBench
@@ -0,0 +1,189 @@
+#ifndef MOONSHINE_BENCH_COMMON_H__
+#define MOONSHINE_BENCH_COMMON_H__
+
+/**
+ * @file bench_common.h
+ * @brief Corpus loading, statistics and reporting helpers shared by the benchmark tools
+ */
+
+#include <cstddef>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "moonshine.h"
+
+
+namespace MoonshineBench {
+
+constexpr size_t sample_rate = 16000;   /**< Audio sample rate of the models */
+
+/**
+ * @struct Clip
+ * @brief One corpus entry
+ */
+struct Clip {
+    std::string name;               /**< File stem */
+    std::vector<float> samples;     /**< 16 kHz mono samples */
+
+    /**
+     * @brief Gets the clip duration
+     * @return double Duration in seconds
+     */
+    double seconds() const noexcept { return static_cast<double>(samples.size()) / sample_rate; }
+};
+
+/**
+ * @struct ModelSpec
+ * @brief Model type and files given on a tool's command line
+ */
+struct ModelSpec {
+    Moonshine::ModelType type = Moonshine::ModelType::Tiny;     /**< Model architecture */
+    std::filesystem::path encoder;      /**< Encoder ONNX file */
+    std::filesystem::path decoder;      /**< Decoder ONNX file */
+    std::filesystem::path tokenizer;    /**< Tokenizer JSON file */
+
+    /**
+     * @brief Parses "<model> <encoder.onnx> <decoder.onnx> <tok.json>" positional arguments
+     *
+     * @param args Positional arguments, the first four are consumed
+     * @return ModelSpec The parsed spec
+     */
+    static ModelSpec parse(const std::vector<std::string> &args);
+
+    /**
+     * @brief Constructs a transcriber owning its own sessions
+     * @param num_threads Intra-op threads of each session
+     * @return std::unique_ptr<Moonshine::Transcriber> The transcriber
+     */
+    std::unique_ptr<Moonshine::Transcriber> make_transcriber(int num_threads) const;
+
+    /**
+     * @brief Constructs a transcriber owning its own sessions
+     * @param options Session configuration
+     * @return std::unique_ptr<Moonshine::Transcriber> The transcriber
+     */
+    std::unique_ptr<Moonshine::Transcriber> make_transcriber(const Moonshine::ModelOptions &options) const;
+};
+
+/**
+ * @brief Loads a corpus from a file or a directory
+ *
+ * Accepts 16 kHz mono 16-bit .wav files and packed .f32 files holding raw
+ * little-endian float samples at 16 kHz. A directory is scanned (not
+ * recursively) for both, in name order. Unsupported wav files are skipped
+ * with a warning on stderr.
+ *
+ * @param path File or directory
+ * @return std::vector<Clip> The clips, never empty
+ */
+std::vector<Clip> load_corpus(const std::filesystem::path &path);
+
+/**
+ * @brief Gets a percentile of a set of values
+ *
+ * @param values Values, sorted in place
+ * @param q Quantile in [0, 1]
+ * @return double Nearest-rank value, 0 if empty
+ */
+double percentile(std::vector<double> &values, double q);
+
+/**
+ * @brief Gets the mean of a set of values
+ * @param values Values
+ * @return double Mean, 0 if empty
+ */
+double mean(const std::vector<double> &values);
+
+/**
+ * @brief Gets the peak resident set size of the process
+ * @return size_t Peak RSS in bytes, 0 if unavailable
+ */
+size_t peak_rss_bytes();
+
+/**
+ * @brief Gets the current resident set size of the process
+ * @return size_t RSS in bytes, 0 if unavailable
+ */
+size_t current_rss_bytes();
+
+/**
+ * @brief Parses a comma separated list of positive integers, e.g. "1,2,4"
+ * @param list The list
+ * @return std::vector<int> Parsed values
+ */
+std::vector<int> parse_int_list(const std::string &list);
+
+/**
+ * @brief Quotes and escapes a string for JSON output
+ * @param str The string
+ * @return std::string JSON string literal
+ */
+std::string json_string(const std::string &str);
+
+/**
+ * @brief Reads the numbers of a JSON document, keyed by their dotted path
+ *
+ * Nested objects are flattened, e.g. {"a": {"b": 1, "c": [2, true]}} gives
+ * a.b = 1, a.c.0 = 2 and a.c.1 = 1. Strings and nulls are skipped.
+ *
+ * @param path JSON file
+ * @return std::map<std::string, double> Numbers by path
+ */
+std::map<std::string, double> read_json_numbers(const std::filesystem::path &path);
+
+/**
+ * @class Args
+ * @brief Minimal parser for positional arguments and --name value options
+ */
+class Args {
+public:
+    /**
+     * @brief Parses the command line
+     *
+     * @param argc Argument count
+     * @param argv Arguments
+     * @param flags Option names that take no value, e.g. "--verbose"
+     */
+    Args(int argc, char *argv[], const std::vector<std::string> &flags = {});
+
+    /**
+     * @brief Gets the positional arguments
+     * @return const std::vector<std::string>& Arguments not belonging to options
+     */
+    const std::vector<std::string> &positional() const noexcept { return positionals; }
+
+    /**
+     * @brief Checks whether an option was given
+     * @param name Option name including the dashes
+     * @return bool True if present
+     */
+    bool has(const std::string &name) const { return options.count(name) > 0; }
+
+    /**
+     * @brief Gets an option value
+     *
+     * @param name Option name including the dashes
+     * @param fallback Value when the option is absent
+     * @return std::string The value
+     */
+    std::string get(const std::string &name, const std::string &fallback = "") const;
+
+    /**
+     * @brief Gets a numeric option value
+     *
+     * @param name Option name including the dashes
+     * @param fallback Value when the option is absent
+     * @return double The value
+     */
+    double get_number(const std::string &name, double fallback) const;
+
+private:
+    std::vector<std::string> positionals;           /**< Positional arguments */
+    std::map<std::string, std::string> options;     /**< Options by name */
+};
+
+}
+
+#endif
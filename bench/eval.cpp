@@ -0,0 +1,424 @@
+/**
+ * @file eval.cpp
+ * @brief Accuracy and speed evaluation of one or two Transcriber configurations.
+ *
+ * Transcribes every entry of a manifest and reports word error rate after
+ * text normalization alongside RTF and latency. Given a second configuration
+ * it runs both on the same audio and reports the difference, with a per
+ * utterance tally of which configuration made fewer errors.
+ *
+ * Usage:
+ *   moonshine_eval <manifest.tsv> --a <config> [--b <config>] [--json out.json] [--show-errors 10]
+ *
+ * The manifest holds one utterance per line, "<audio path>\t<reference text>",
+ * with paths relative to the manifest. A config is a comma separated list of
+ * key=value pairs:
+ *   model=tiny|base,encoder=<onnx>,decoder=<onnx>,tokenizer=<json>[,threads=N][,compact_pause_ms=N]
+ *   [,shortlist_decoder=<onnx>,shortlist_tokens=<txt>[,shortlist_min_logit=X]][,name=label]
+ * so float and int8 exports, or Tiny and Base, are compared by pointing the
+ * two configs at different files. compact_pause_ms enables silence compaction
+ * of pauses at least that long, and the shortlist keys a vocabulary
+ * shortlist, to check they do not cost accuracy.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include "bench_common.h"
+
+
+namespace {
+    using namespace MoonshineBench;
+
+    /**
+     * @struct Utterance
+     * @brief One manifest entry
+     */
+    struct Utterance {
+        Clip clip;                  /**< Audio */
+        std::string reference;      /**< Reference transcript */
+    };
+
+    /**
+     * @struct Config
+     * @brief A named Transcriber configuration
+     */
+    struct Config {
+        std::string name;   /**< Label in the report */
+        ModelSpec spec;     /**< Model files */
+        int threads = 1;    /**< Intra-op threads */
+        std::optional<Moonshine::SilenceCompaction> compaction;  /**< Pause shortening, off when unset */
+        std::optional<Moonshine::VocabShortlist> shortlist;     /**< Vocabulary shortlist, off when unset */
+    };
+
+    /**
+     * @struct EditCounts
+     * @brief Word level alignment errors
+     */
+    struct EditCounts {
+        size_t substitutions = 0;
+        size_t deletions = 0;
+        size_t insertions = 0;
+        size_t reference_words = 0;
+
+        size_t errors() const noexcept { return substitutions + deletions + insertions; }
+
+        double wer() const noexcept {
+            return reference_words ? static_cast<double>(errors()) / reference_words : 0.0;
+        }
+
+        EditCounts &operator+=(const EditCounts &other) noexcept {
+            substitutions += other.substitutions;
+            deletions += other.deletions;
+            insertions += other.insertions;
+            reference_words += other.reference_words;
+
+            return *this;
+        }
+    };
+
+    /**
+     * @struct ConfigResult
+     * @brief Everything measured for one configuration
+     */
+    struct ConfigResult {
+        std::string name;                   /**< Config label */
+        EditCounts total;                   /**< Errors over the whole manifest */
+        std::vector<EditCounts> per_utterance;  /**< Errors of each utterance */
+        std::vector<std::string> hypotheses;    /**< Normalized transcripts */
+        std::vector<double> latency_ms;     /**< Per-utterance wall time */
+        std::vector<double> rtf;            /**< Per-utterance real time factor */
+    };
+
+    /**
+     * @brief Lowercases, drops punctuation other than in-word apostrophes and splits into words
+     */
+    std::vector<std::string> normalize(const std::string &text) {
+        std::vector<std::string> words;
+        std::string word;
+
+        for (size_t i = 0; i < text.size(); i++) {
+            unsigned char c = static_cast<unsigned char>(text[i]);
+            bool in_word_apostrophe = c == '\'' && !word.empty() &&
+                                      i + 1 < text.size() && std::isalnum(static_cast<unsigned char>(text[i + 1]));
+
+            if (std::isalnum(c) || c >= 0x80 || in_word_apostrophe) {
+                word += static_cast<char>(std::tolower(c));
+            } else if (std::isspace(c) || c == '-') {
+                if (!word.empty()) {
+                    words.push_back(std::move(word));
+                    word.clear();
+                }
+            }
+        }
+
+        if (!word.empty()) {
+            words.push_back(std::move(word));
+        }
+
+        return words;
+    }
+
+    /**
+     * @brief Aligns hypothesis to reference words with unit edit costs
+     */
+    EditCounts align(const std::vector<std::string> &ref, const std::vector<std::string> &hyp) {
+        struct Cell {
+            size_t cost, sub, del, ins;
+        };
+
+        std::vector<Cell> prev(hyp.size() + 1);
+        std::vector<Cell> cur(hyp.size() + 1);
+
+        for (size_t j = 0; j <= hyp.size(); j++) {
+            prev[j] = {j, 0, 0, j};
+        }
+
+        for (size_t i = 1; i <= ref.size(); i++) {
+            cur[0] = {i, 0, i, 0};
+
+            for (size_t j = 1; j <= hyp.size(); j++) {
+                Cell diag = prev[j - 1];
+
+                if (ref[i - 1] != hyp[j - 1]) {
+                    diag.cost++;
+                    diag.sub++;
+                }
+
+                Cell del = prev[j];
+                del.cost++;
+                del.del++;
+
+                Cell ins = cur[j - 1];
+                ins.cost++;
+                ins.ins++;
+
+                cur[j] = diag;
+
+                if (del.cost < cur[j].cost) {
+                    cur[j] = del;
+                }
+
+                if (ins.cost < cur[j].cost) {
+                    cur[j] = ins;
+                }
+            }
+
+            std::swap(prev, cur);
+        }
+
+        const auto &end = prev[hyp.size()];
+
+        return {end.sub, end.del, end.ins, ref.size()};
+    }
+
+    std::string join(const std::vector<std::string> &words) {
+        std::string out;
+
+        for (const auto &word : words) {
+            out += (out.empty() ? "" : " ") + word;
+        }
+
+        return out;
+    }
+
+    std::vector<Utterance> load_manifest(const std::filesystem::path &path) {
+        std::ifstream ifs(path);
+
+        if (!ifs) {
+            throw std::runtime_error("Unable to open manifest: " + path.string());
+        }
+
+        std::vector<Utterance> utterances;
+        std::string line;
+
+        while (std::getline(ifs, line)) {
+            auto tab = line.find('\t');
+
+            if (line.empty() || line[0] == '#' || tab == std::string::npos) {
+                continue;
+            }
+
+            auto audio = path.parent_path() / line.substr(0, tab);
+            utterances.push_back({load_corpus(audio).front(), line.substr(tab + 1)});
+        }
+
+        if (utterances.empty()) {
+            throw std::runtime_error("Manifest has no entries: " + path.string());
+        }
+
+        return utterances;
+    }
+
+    Config parse_config(const std::string &text, const std::string &fallback_name) {
+        std::map<std::string, std::string> fields;
+        std::stringstream ss(text);
+        std::string item;
+
+        while (std::getline(ss, item, ',')) {
+            auto eq = item.find('=');
+
+            if (eq == std::string::npos) {
+                throw std::runtime_error("Expected key=value in config: " + item);
+            }
+
+            fields[item.substr(0, eq)] = item.substr(eq + 1);
+        }
+
+        Config config;
+        config.name = fields.count("name") ? fields["name"] : fallback_name;
+        config.spec = ModelSpec::parse({fields["model"], fields["encoder"], fields["decoder"], fields["tokenizer"]});
+        config.threads = fields.count("threads") ? std::stoi(fields["threads"]) : 1;
+
+        if (fields.count("compact_pause_ms")) {
+            config.compaction = Moonshine::SilenceCompaction{};
+            config.compaction->min_pause_ms = std::stoul(fields["compact_pause_ms"]);
+        }
+
+        if (fields.count("shortlist_decoder")) {
+            float min_logit = fields.count("shortlist_min_logit") ? std::stof(fields["shortlist_min_logit"]) : 0.0f;
+            config.shortlist = Moonshine::VocabShortlist::from_files(
+                fields["shortlist_decoder"], fields["shortlist_tokens"], min_logit);
+        }
+
+        return config;
+    }
+
+    ConfigResult evaluate(const Config &config, const std::vector<Utterance> &utterances) {
+        ConfigResult result;
+        result.name = config.name;
+
+        Moonshine::ModelOptions options;
+        options.num_threads = config.threads;
+        options.silence_compaction = config.compaction;
+        options.shortlist = config.shortlist;
+
+        auto stt = config.spec.make_transcriber(options);
+        stt->transcribe(utterances.front().clip.samples);
+
+        for (const auto &utterance : utterances) {
+            auto start = std::chrono::steady_clock::now();
+            auto text = stt->transcribe(utterance.clip.samples);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            auto hyp = normalize(text);
+            auto counts = align(normalize(utterance.reference), hyp);
+
+            result.total += counts;
+            result.per_utterance.push_back(counts);
+            result.hypotheses.push_back(join(hyp));
+            result.latency_ms.push_back(ms);
+            result.rtf.push_back(ms / 1000.0 / utterance.clip.seconds());
+        }
+
+        return result;
+    }
+
+    void print_summary(std::vector<ConfigResult> &results) {
+        std::cout << std::left << std::setw(16) << "config" << std::right
+                  << std::setw(8) << "wer%" << std::setw(7) << "sub" << std::setw(7) << "del"
+                  << std::setw(7) << "ins" << std::setw(9) << "rtf_mean" << std::setw(9) << "rtf_p90"
+                  << std::setw(10) << "p50_ms" << std::setw(10) << "p99_ms" << '\n';
+
+        for (auto &r : results) {
+            std::cout << std::left << std::setw(16) << r.name << std::right << std::fixed
+                      << std::setprecision(2) << std::setw(8) << r.total.wer() * 100.0
+                      << std::setw(7) << r.total.substitutions << std::setw(7) << r.total.deletions
+                      << std::setw(7) << r.total.insertions
+                      << std::setprecision(3) << std::setw(9) << mean(r.rtf) << std::setw(9) << percentile(r.rtf, 0.9)
+                      << std::setprecision(1) << std::setw(10) << percentile(r.latency_ms, 0.5)
+                      << std::setw(10) << percentile(r.latency_ms, 0.99) << '\n';
+        }
+    }
+
+    /**
+     * @brief Prints the paired comparison of two configurations
+     */
+    void print_comparison(const ConfigResult &a, const ConfigResult &b) {
+        size_t a_better = 0;
+        size_t b_better = 0;
+
+        for (size_t i = 0; i < a.per_utterance.size(); i++) {
+            a_better += a.per_utterance[i].errors() < b.per_utterance[i].errors();
+            b_better += b.per_utterance[i].errors() < a.per_utterance[i].errors();
+        }
+
+        std::cout << '\n' << b.name << " vs " << a.name << ": WER "
+                  << std::showpos << std::setprecision(2) << (b.total.wer() - a.total.wer()) * 100.0
+                  << " points, mean RTF " << std::setprecision(1)
+                  << (mean(b.rtf) / mean(a.rtf) - 1.0) * 100.0 << "%" << std::noshowpos << '\n'
+                  << "utterances with fewer errors: " << a.name << " " << a_better << ", "
+                  << b.name << " " << b_better << ", tied "
+                  << a.per_utterance.size() - a_better - b_better << '\n';
+    }
+
+    /**
+     * @brief Prints the utterances with the most errors for each configuration
+     */
+    void print_errors(const std::vector<Utterance> &utterances, const ConfigResult &r, size_t count) {
+        std::vector<size_t> order(utterances.size());
+
+        for (size_t i = 0; i < order.size(); i++) {
+            order[i] = i;
+        }
+
+        std::stable_sort(order.begin(), order.end(), [&](size_t x, size_t y) {
+            return r.per_utterance[x].errors() > r.per_utterance[y].errors();
+        });
+
+        std::cout << "\nworst utterances for " << r.name << ":\n";
+
+        for (size_t i = 0; i < std::min(count, order.size()) && r.per_utterance[order[i]].errors(); i++) {
+            size_t u = order[i];
+
+            std::cout << "  " << utterances[u].clip.name << " (" << r.per_utterance[u].errors() << " errors)\n"
+                      << "    ref: " << join(normalize(utterances[u].reference)) << '\n'
+                      << "    hyp: " << r.hypotheses[u] << '\n';
+        }
+    }
+
+    void write_json(std::ostream &out, const std::vector<Utterance> &utterances, std::vector<ConfigResult> &results) {
+        out << std::setprecision(6) << "{\n  \"utterances\": " << utterances.size() << ",\n  \"configs\": [";
+
+        for (size_t i = 0; i < results.size(); i++) {
+            auto &r = results[i];
+
+            out << (i ? "," : "") << "\n    {\"name\": " << json_string(r.name)
+                << ", \"wer\": " << r.total.wer()
+                << ", \"substitutions\": " << r.total.substitutions
+                << ", \"deletions\": " << r.total.deletions
+                << ", \"insertions\": " << r.total.insertions
+                << ", \"reference_words\": " << r.total.reference_words
+                << ", \"rtf\": {\"mean\": " << mean(r.rtf) << ", \"p50\": " << percentile(r.rtf, 0.5)
+                << ", \"p90\": " << percentile(r.rtf, 0.9) << "}"
+                << ", \"latency_ms\": {\"p50\": " << percentile(r.latency_ms, 0.5)
+                << ", \"p90\": " << percentile(r.latency_ms, 0.9)
+                << ", \"p99\": " << percentile(r.latency_ms, 0.99) << "}}";
+        }
+
+        out << "\n  ]\n}\n";
+    }
+}
+
+
+int main(int argc, char *argv[]) {
+    try {
+        Args args(argc, argv);
+
+        if (args.positional().size() != 1 || !args.has("--a")) {
+            std::cerr << "Usage: " << argv[0]
+                      << " <manifest.tsv> --a <config> [--b <config>] [--json out.json] [--show-errors 10]\n"
+                      << "  config: model=tiny|base,encoder=<onnx>,decoder=<onnx>,tokenizer=<json>[,threads=N][,compact_pause_ms=N]"
+                      << "[,shortlist_decoder=<onnx>,shortlist_tokens=<txt>[,shortlist_min_logit=X]][,name=label]"
+                      << std::endl;
+
+            return 1;
+        }
+
+        auto utterances = load_manifest(args.positional()[0]);
+        std::vector<Config> configs{parse_config(args.get("--a"), "a")};
+
+        if (args.has("--b")) {
+            configs.push_back(parse_config(args.get("--b"), "b"));
+        }
+
+        std::vector<ConfigResult> results;
+
+        for (const auto &config : configs) {
+            std::cerr << "Evaluating " << config.name << " on " << utterances.size() << " utterances..." << std::endl;
+            results.push_back(evaluate(config, utterances));
+        }
+
+        print_summary(results);
+
+        if (results.size() == 2) {
+            print_comparison(results[0], results[1]);
+        }
+
+        if (auto count = static_cast<size_t>(args.get_number("--show-errors", 0))) {
+            for (const auto &r : results) {
+                print_errors(utterances, r, count);
+            }
+        }
+
+        if (args.has("--json")) {
+            std::ofstream ofs(args.get("--json"), std::ios::trunc);
+
+            if (!ofs) {
+                throw std::runtime_error("Unable to open " + args.get("--json"));
+            }
+
+            write_json(ofs, utterances, results);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+/**
+ * @file latency_histogram.cpp
+ * @brief Log-linear latency histogram in the style of HdrHistogram.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "latency_histogram.h"
+
+
+namespace {
+    constexpr size_t linear_buckets = size_t{1} << 7;   /**< One bucket per value below this */
+    constexpr size_t half_buckets = linear_buckets / 2; /**< Buckets per power of two above it */
+    constexpr size_t max_exponent = 64 - 7;             /**< Powers of two above the linear range */
+}
+
+
+namespace MoonshineBench {
+
+LatencyHistogram::LatencyHistogram()
+    : counts(linear_buckets + max_exponent * half_buckets, 0)
+{}
+
+size_t LatencyHistogram::bucket_index(uint64_t value) noexcept {
+    if (value < linear_buckets) {
+        return static_cast<size_t>(value);
+    }
+
+    // Keep the top sub_bucket_bits bits: the exponent picks the power of two,
+    // the remaining mantissa bits the linear bucket within it.
+    int msb = 63;
+
+    while (!(value >> msb)) {
+        msb--;
+    }
+
+    size_t exponent = static_cast<size_t>(msb - (sub_bucket_bits - 1));
+    size_t mantissa = static_cast<size_t>(value >> exponent);
+
+    return linear_buckets + (exponent - 1) * half_buckets + (mantissa - half_buckets);
+}
+
+uint64_t LatencyHistogram::bucket_upper(size_t index) noexcept {
+    if (index < linear_buckets) {
+        return index;
+    }
+
+    size_t exponent = (index - linear_buckets) / half_buckets + 1;
+    uint64_t mantissa = (index - linear_buckets) % half_buckets + half_buckets;
+
+    return ((mantissa + 1) << exponent) - 1;
+}
+
+void LatencyHistogram::record(uint64_t value_us) noexcept {
+    counts[bucket_index(value_us)]++;
+    total++;
+    sum += value_us;
+    max_value = std::max(max_value, value_us);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other) noexcept {
+    for (size_t i = 0; i < counts.size(); i++) {
+        counts[i] += other.counts[i];
+    }
+
+    total += other.total;
+    sum += other.sum;
+    max_value = std::max(max_value, other.max_value);
+}
+
+uint64_t LatencyHistogram::value_at_quantile(double q) const noexcept {
+    if (!total) {
+        return 0;
+    }
+
+    auto target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * total)));
+    uint64_t seen = 0;
+
+    for (size_t i = 0; i < counts.size(); i++) {
+        seen += counts[i];
+
+        if (seen >= target) {
+            return std::min(bucket_upper(i), max_value);
+        }
+    }
+
+    return max_value;
+}
+
+} // namespace MoonshineBench
@@ -0,0 +1,468 @@
+/**
+ * @file load_gen.cpp
+ * @brief Open-loop load generator measuring latency under a fixed arrival rate.
+ *
+ * Requests arrive on a schedule that does not depend on completions, either a
+ * Poisson process at a target rate or offsets read from a trace file, and
+ * queue for a fixed pool of worker Transcribers. Latency is measured from the
+ * scheduled arrival time rather than from when a worker picked the request up,
+ * so time spent queued behind a slow request is counted instead of silently
+ * omitted (coordinated omission). Service time is reported separately.
+ *
+ * With --slo-p99-ms the rate is doubled until the p99 latency misses the SLO
+ * and then bisected, reporting the highest rate that met it.
+ *
+ * Usage:
+ *   moonshine_load_gen <model> <encoder.onnx> <decoder.onnx> <tok.json> <corpus>
+ *       [--workers 1] [--threads 1] [--rate 1] [--duration 30] [--drain 10]
+ *       [--slo-p99-ms 1000] [--search-steps 4] [--trace file] [--seed 1] [--json out.json]
+ *       [--metrics out.prom] [--adaptive-spin rps]
+ *
+ * With --metrics the library metrics, including the queue wait seen here, are
+ * enabled and written in the Prometheus text format at exit.
+ *
+ * With --adaptive-spin each worker's model switches to spinning sessions
+ * when the requests it sees reach the given rate, and back below half of it.
+ *
+ * A trace file holds one request per line: "<offset seconds> [clip name]".
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+#include "bench_common.h"
+#include "latency_histogram.h"
+#include "moonshine_metrics.h"
+
+
+namespace {
+    using namespace MoonshineBench;
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @struct Arrival
+     * @brief One scheduled request
+     */
+    struct Arrival {
+        double offset_s;    /**< Arrival time from the start of the step */
+        size_t clip;        /**< Corpus index */
+    };
+
+    /**
+     * @struct Request
+     * @brief A request waiting for a worker
+     */
+    struct Request {
+        size_t clip;                /**< Corpus index */
+        Clock::time_point intended; /**< Scheduled arrival time */
+    };
+
+    /**
+     * @class RequestQueue
+     * @brief Unbounded FIFO between the arrival thread and the workers
+     */
+    class RequestQueue {
+    public:
+        void push(Request request) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                requests.push_back(request);
+            }
+
+            ready.notify_one();
+        }
+
+        /**
+         * @brief Waits for a request until the queue is closed and empty or the deadline passes
+         */
+        bool pop(Request &request, Clock::time_point deadline) {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            ready.wait_until(lock, deadline, [this]() { return closed || !requests.empty(); });
+
+            if (requests.empty() || Clock::now() >= deadline) {
+                return false;
+            }
+
+            request = requests.front();
+            requests.pop_front();
+
+            return true;
+        }
+
+        void close() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                closed = true;
+            }
+
+            ready.notify_all();
+        }
+
+        /**
+         * @brief Removes the requests no worker got to
+         */
+        std::deque<Request> take_remaining() {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            return std::move(requests);
+        }
+
+    private:
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::deque<Request> requests;
+        bool closed = false;
+    };
+
+    /**
+     * @struct StepResult
+     * @brief Outcome of running one arrival schedule
+     */
+    struct StepResult {
+        double offered_rate = 0.0;      /**< Scheduled requests per second */
+        double achieved_rate = 0.0;     /**< Completed requests per second */
+        size_t issued = 0;              /**< Requests scheduled */
+        size_t unserved = 0;            /**< Requests still queued at the drain deadline */
+        double audio_rate = 0.0;        /**< Offered audio seconds per second */
+        LatencyHistogram latency;       /**< Scheduled arrival to completion */
+        LatencyHistogram service;       /**< Worker pickup to completion */
+        bool passed = true;             /**< Whether the SLO was met */
+    };
+
+    uint64_t to_us(Clock::duration d) {
+        return static_cast<uint64_t>(std::max<int64_t>(0,
+            std::chrono::duration_cast<std::chrono::microseconds>(d).count()));
+    }
+
+    /**
+     * @brief Draws Poisson arrivals over the step duration
+     */
+    std::vector<Arrival> poisson_schedule(double rate, double duration_s, size_t clips, std::mt19937_64 &rng) {
+        std::exponential_distribution<double> gap(rate);
+        std::uniform_int_distribution<size_t> pick(0, clips - 1);
+        std::vector<Arrival> schedule;
+
+        for (double t = gap(rng); t < duration_s; t += gap(rng)) {
+            schedule.push_back({t, pick(rng)});
+        }
+
+        return schedule;
+    }
+
+    /**
+     * @brief Reads a trace file, mapping clip names to corpus indices
+     */
+    std::vector<Arrival> trace_schedule(const std::string &path, const std::vector<Clip> &corpus) {
+        std::ifstream ifs(path);
+
+        if (!ifs) {
+            throw std::runtime_error("Unable to open trace: " + path);
+        }
+
+        std::vector<Arrival> schedule;
+        std::string line;
+
+        while (std::getline(ifs, line)) {
+            std::istringstream fields(line);
+            double offset;
+            std::string name;
+
+            if (!(fields >> offset)) {
+                continue;
+            }
+
+            size_t clip = schedule.size() % corpus.size();
+
+            if (fields >> name) {
+                auto it = std::find_if(corpus.begin(), corpus.end(), [&](const Clip &c) { return c.name == name; });
+
+                if (it == corpus.end()) {
+                    throw std::runtime_error("Trace names a clip not in the corpus: " + name);
+                }
+
+                clip = static_cast<size_t>(it - corpus.begin());
+            }
+
+            schedule.push_back({offset, clip});
+        }
+
+        std::sort(schedule.begin(), schedule.end(),
+                  [](const Arrival &a, const Arrival &b) { return a.offset_s < b.offset_s; });
+
+        return schedule;
+    }
+
+    /**
+     * @brief Replays a schedule against the workers
+     */
+    StepResult run_step(std::vector<std::unique_ptr<Moonshine::Transcriber>> &transcribers,
+                        const std::vector<Clip> &corpus,
+                        const std::vector<Arrival> &schedule,
+                        double duration_s,
+                        double drain_s)
+    {
+        StepResult result;
+        RequestQueue queue;
+        std::vector<LatencyHistogram> latency(transcribers.size());
+        std::vector<LatencyHistogram> service(transcribers.size());
+
+        auto start = Clock::now() + std::chrono::milliseconds(10);
+        auto deadline = start + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(duration_s + drain_s));
+
+        std::vector<std::thread> workers;
+
+        for (size_t w = 0; w < transcribers.size(); w++) {
+            workers.emplace_back([&, w]() {
+                Request request;
+
+                while (queue.pop(request, deadline)) {
+                    auto picked = Clock::now();
+
+                    if (Moonshine::Metrics::instance().is_enabled()) {
+                        Moonshine::Metrics::instance().queue_wait.observe(
+                            std::chrono::duration<double>(picked - request.intended).count());
+                    }
+
+                    transcribers[w]->transcribe(corpus[request.clip].samples);
+
+                    auto done = Clock::now();
+                    latency[w].record(to_us(done - request.intended));
+                    service[w].record(to_us(done - picked));
+                }
+            });
+        }
+
+        double audio_s = 0.0;
+
+        // The arrival thread never waits on a worker. If it wakes up late the
+        // request still carries its scheduled time, so the delay is measured.
+        for (const auto &arrival : schedule) {
+            auto intended = start + std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(arrival.offset_s));
+
+            std::this_thread::sleep_until(intended);
+            queue.push({arrival.clip, intended});
+            audio_s += corpus[arrival.clip].seconds();
+        }
+
+        queue.close();
+
+        for (auto &worker : workers) {
+            worker.join();
+        }
+
+        for (size_t w = 0; w < transcribers.size(); w++) {
+            result.latency.merge(latency[w]);
+            result.service.merge(service[w]);
+        }
+
+        // Requests left behind are recorded with the latency they had reached
+        // at the deadline, a lower bound that still drags the tail up.
+        for (const auto &request : queue.take_remaining()) {
+            result.latency.record(to_us(deadline - request.intended));
+            result.unserved++;
+        }
+
+        double elapsed_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+        result.issued = schedule.size();
+        result.offered_rate = schedule.size() / duration_s;
+        result.audio_rate = audio_s / duration_s;
+        result.achieved_rate = result.service.count() / std::max(elapsed_s, duration_s);
+
+        return result;
+    }
+
+    void print_header() {
+        std::cout << std::right << std::setw(10) << "rate" << std::setw(9) << "issued"
+                  << std::setw(9) << "unserved" << std::setw(10) << "done/s"
+                  << std::setw(10) << "p50_ms" << std::setw(10) << "p90_ms"
+                  << std::setw(10) << "p99_ms" << std::setw(10) << "p999_ms"
+                  << std::setw(10) << "max_ms" << std::setw(12) << "svc_p50_ms"
+                  << std::setw(6) << "slo" << std::endl;
+    }
+
+    void print_row(const StepResult &r) {
+        auto ms = [](uint64_t us) { return us / 1000.0; };
+
+        std::cout << std::fixed << std::setprecision(2)
+                  << std::setw(10) << r.offered_rate << std::setw(9) << r.issued
+                  << std::setw(9) << r.unserved << std::setw(10) << r.achieved_rate
+                  << std::setprecision(1)
+                  << std::setw(10) << ms(r.latency.value_at_quantile(0.5))
+                  << std::setw(10) << ms(r.latency.value_at_quantile(0.9))
+                  << std::setw(10) << ms(r.latency.value_at_quantile(0.99))
+                  << std::setw(10) << ms(r.latency.value_at_quantile(0.999))
+                  << std::setw(10) << ms(r.latency.max())
+                  << std::setw(12) << ms(r.service.value_at_quantile(0.5))
+                  << std::setw(6) << (r.passed ? "ok" : "miss") << std::endl;
+    }
+
+    void write_json(std::ostream &out, const std::vector<StepResult> &steps, double max_rate, double slo_ms) {
+        auto ms = [](uint64_t us) { return us / 1000.0; };
+
+        out << std::setprecision(6) << "{\n"
+            << "  \"slo_p99_ms\": " << slo_ms << ",\n"
+            << "  \"max_sustainable_rate\": " << max_rate << ",\n"
+            << "  \"steps\": [";
+
+        for (size_t i = 0; i < steps.size(); i++) {
+            const auto &r = steps[i];
+
+            out << (i ? "," : "") << "\n    {"
+                << "\"offered_rate\": " << r.offered_rate
+                << ", \"offered_audio_s_per_s\": " << r.audio_rate
+                << ", \"achieved_rate\": " << r.achieved_rate
+                << ", \"issued\": " << r.issued
+                << ", \"unserved\": " << r.unserved
+                << ", \"latency_ms\": {\"mean\": " << r.latency.mean() / 1000.0
+                << ", \"p50\": " << ms(r.latency.value_at_quantile(0.5))
+                << ", \"p90\": " << ms(r.latency.value_at_quantile(0.9))
+                << ", \"p99\": " << ms(r.latency.value_at_quantile(0.99))
+                << ", \"p999\": " << ms(r.latency.value_at_quantile(0.999))
+                << ", \"max\": " << ms(r.latency.max()) << "}"
+                << ", \"service_ms\": {\"p50\": " << ms(r.service.value_at_quantile(0.5))
+                << ", \"p99\": " << ms(r.service.value_at_quantile(0.99)) << "}"
+                << ", \"passed\": " << (r.passed ? "true" : "false") << "}";
+        }
+
+        out << "\n  ]\n}\n";
+    }
+}
+
+
+int main(int argc, char *argv[]) {
+    try {
+        Args args(argc, argv);
+
+        if (args.positional().size() != 5) {
+            std::cerr << "Usage: " << argv[0]
+                      << " <model> <encoder.onnx> <decoder.onnx> <tok.json> <corpus>"
+                      << " [--workers 1] [--threads 1] [--rate 1] [--duration 30] [--drain 10]"
+                      << " [--slo-p99-ms ms] [--search-steps 4] [--trace file] [--seed 1] [--json out.json]"
+                      << " [--metrics out.prom] [--adaptive-spin rps]" << std::endl;
+
+            return 1;
+        }
+
+        auto spec = ModelSpec::parse(args.positional());
+        auto corpus = load_corpus(args.positional()[4]);
+        auto workers = static_cast<int>(args.get_number("--workers", 1));
+        auto threads = static_cast<int>(args.get_number("--threads", 1));
+        double rate = args.get_number("--rate", 1.0);
+        double duration_s = args.get_number("--duration", 30.0);
+        double drain_s = args.get_number("--drain", 10.0);
+        double slo_ms = args.get_number("--slo-p99-ms", 0.0);
+        auto search_steps = static_cast<int>(args.get_number("--search-steps", 4));
+        if (rate <= 0.0 || duration_s <= 0.0) {
+            throw std::runtime_error("--rate and --duration must be positive");
+        }
+
+        std::mt19937_64 rng(static_cast<uint64_t>(args.get_number("--seed", 1)));
+
+        Moonshine::Metrics::instance().set_enabled(args.has("--metrics"));
+
+        std::vector<std::unique_ptr<Moonshine::Transcriber>> transcribers;
+
+        for (int i = 0; i < std::max(workers, 1); i++) {
+            Moonshine::ModelOptions options;
+            options.num_threads = threads;
+
+            if (args.has("--adaptive-spin")) {
+                double spin_rps = args.get_number("--adaptive-spin", 1.0);
+                options.adaptive_spin = Moonshine::AdaptiveSpin{spin_rps, spin_rps / 2.0};
+            }
+
+            transcribers.push_back(spec.make_transcriber(options));
+            transcribers.back()->transcribe(corpus.front().samples);
+        }
+
+        std::vector<StepResult> steps;
+        double max_rate = 0.0;
+
+        auto evaluate = [&](const std::vector<Arrival> &schedule, double step_duration_s) {
+            auto result = run_step(transcribers, corpus, schedule, step_duration_s, drain_s);
+
+            if (slo_ms > 0.0) {
+                result.passed = result.unserved == 0 &&
+                                result.latency.value_at_quantile(0.99) <= static_cast<uint64_t>(slo_ms * 1000.0);
+            }
+
+            print_row(result);
+            steps.push_back(std::move(result));
+
+            return steps.back().passed;
+        };
+
+        print_header();
+
+        if (args.has("--trace")) {
+            auto schedule = trace_schedule(args.get("--trace"), corpus);
+            double trace_s = schedule.empty() ? 1.0 : std::max(schedule.back().offset_s, 1.0);
+
+            evaluate(schedule, trace_s);
+        } else if (slo_ms <= 0.0) {
+            evaluate(poisson_schedule(rate, duration_s, corpus.size(), rng), duration_s);
+        } else {
+            // Double until the SLO is missed, then bisect between the last
+            // passing and the first failing rate.
+            double low = 0.0;
+            double high = rate;
+
+            while (evaluate(poisson_schedule(high, duration_s, corpus.size(), rng), duration_s)) {
+                low = high;
+                high *= 2.0;
+            }
+
+            for (int i = 0; i < search_steps; i++) {
+                double mid = (low + high) / 2.0;
+
+                if (evaluate(poisson_schedule(mid, duration_s, corpus.size(), rng), duration_s)) {
+                    low = mid;
+                } else {
+                    high = mid;
+                }
+            }
+
+            max_rate = low;
+            std::cout << "max sustainable rate at p99 <= " << slo_ms << " ms: "
+                      << std::setprecision(2) << max_rate << " req/s" << std::endl;
+        }
+
+        if (args.has("--json")) {
+            std::ofstream ofs(args.get("--json"), std::ios::trunc);
+
+            if (!ofs) {
+                throw std::runtime_error("Unable to open " + args.get("--json"));
+            }
+
+            write_json(ofs, steps, max_rate, slo_ms);
+        }
+
+        if (args.has("--metrics")) {
+            std::ofstream ofs(args.get("--metrics"), std::ios::trunc);
+
+            if (!ofs) {
+                throw std::runtime_error("Unable to open " + args.get("--metrics"));
+            }
+
+            ofs << Moonshine::Metrics::instance().render_prometheus();
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,392 @@
+/**
+ * @file microbenchmarks.cpp
+ * @brief Google Benchmark suite for the inference hot paths.
+ *
+ * Token selection, tensor cloning and KV cache updates run on synthetic
+ * tensors and need nothing else. Benchmarks that need model weights read them
+ * from the environment and are skipped when it is not set:
+ *
+ *   MOONSHINE_BENCH_MODEL      base or tiny (default: tiny)
+ *   MOONSHINE_BENCH_ENCODER    Encoder ONNX file
+ *   MOONSHINE_BENCH_DECODER    Decoder ONNX file
+ *   MOONSHINE_BENCH_TOKENIZER  Tokenizer JSON file
+ *   MOONSHINE_BENCH_THREADS    Intra-op threads (default: 1)
+ *
+ * MOONSHINE_BENCH_PERF_COUNTERS=1 adds hardware counters (IPC, cache, TLB
+ * and branch misses) to the token, encoder and decoder step benchmarks,
+ * normalized per token or per audio second. They cover the benchmark thread
+ * only, so keep MOONSHINE_BENCH_THREADS at 1 when reading them.
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "onnx_model_bench_access.h"
+#include "perf_counters.h"
+#include "tokenizers_cpp.h"
+
+
+namespace {
+    using Moonshine::OnnxModel;
+    using Moonshine::OnnxModelBenchAccess;
+
+    constexpr size_t sample_rate = 16000;   /**< Audio sample rate of the models */
+
+    /**
+     * @brief Gets an environment variable, empty if unset
+     */
+    std::string env_or_empty(const char *name) {
+        const char *value = std::getenv(name);
+
+        return value ? value : "";
+    }
+
+    /**
+     * @brief Gets the intra-op thread count for model benchmarks
+     */
+    int bench_threads() {
+        auto value = env_or_empty("MOONSHINE_BENCH_THREADS");
+
+        return value.empty() ? 1 : std::max(1, std::atoi(value.c_str()));
+    }
+
+    /**
+     * @brief Loads the model named by the environment once, null if not configured
+     */
+    OnnxModel *bench_model() {
+        static std::unique_ptr<OnnxModel> model = []() -> std::unique_ptr<OnnxModel> {
+            auto encoder = env_or_empty("MOONSHINE_BENCH_ENCODER");
+            auto decoder = env_or_empty("MOONSHINE_BENCH_DECODER");
+
+            if (encoder.empty() || decoder.empty()) {
+                return nullptr;
+            }
+
+            bool base = env_or_empty("MOONSHINE_BENCH_MODEL") == "base";
+
+            return std::make_unique<OnnxModel>(base ? OnnxModel::Base(encoder, decoder, bench_threads())
+                                                    : OnnxModel::Tiny(encoder, decoder, bench_threads()));
+        }();
+
+        return model.get();
+    }
+
+    /**
+     * @brief Gets the benchmark model or marks the benchmark as skipped
+     */
+    OnnxModel *require_model(benchmark::State &state) {
+        auto *model = bench_model();
+
+        if (!model) {
+            state.SkipWithError("set MOONSHINE_BENCH_ENCODER and MOONSHINE_BENCH_DECODER");
+        }
+
+        return model;
+    }
+
+    /**
+     * @brief Generates low level noise, deterministic across runs
+     */
+    std::vector<float> synthetic_audio(size_t seconds) {
+        std::mt19937 rng(42);
+        std::normal_distribution<float> noise(0.0f, 0.05f);
+        std::vector<float> audio(seconds * sample_rate);
+
+        for (auto &sample : audio) {
+            sample = noise(rng);
+        }
+
+        return audio;
+    }
+
+    /**
+     * @brief Creates a float tensor owning its data through the returned buffer
+     */
+    Ort::Value make_tensor(std::vector<float> &buffer, const std::vector<int64_t> &shape) {
+        static auto memory_info = default_memory_info();
+
+        return Ort::Value::CreateTensor<float>(memory_info, buffer.data(), buffer.size(),
+                                               shape.data(), shape.size());
+    }
+
+    /**
+     * @class PerfScope
+     * @brief Adds hardware counters of a benchmark loop to its reported counters
+     */
+    class PerfScope {
+    public:
+        /**
+         * @param state Benchmark whose loop is measured
+         * @param units_per_iteration Work per iteration the counts are divided by
+         * @param unit Name of the unit, used in the counter names
+         */
+        PerfScope(benchmark::State &state, double units_per_iteration, const std::string &unit)
+            : state(state), units_per_iteration(units_per_iteration), unit(unit)
+        {
+            if (counters()) {
+                counters()->start();
+            }
+        }
+
+        ~PerfScope() {
+            if (!counters()) {
+                return;
+            }
+
+            auto counts = counters()->stop();
+            double units = std::max(1.0, state.iterations() * units_per_iteration);
+
+            state.counters["IPC"] = counts.ipc();
+
+            for (size_t i = 0; i < MoonshineBench::PerfCounts::count; i++) {
+                if (counts.valid[i]) {
+                    state.counters[std::string(MoonshineBench::PerfCounts::names[i]) + "/" + unit] =
+                        counts.values[i] / units;
+                }
+            }
+        }
+
+    private:
+        /**
+         * @brief Opens the counters once, null unless enabled and available
+         */
+        static MoonshineBench::PerfCounters *counters() {
+            static std::unique_ptr<MoonshineBench::PerfCounters> instance = []() {
+                std::unique_ptr<MoonshineBench::PerfCounters> pc;
+
+                if (env_or_empty("MOONSHINE_BENCH_PERF_COUNTERS") == "1") {
+                    pc = std::make_unique<MoonshineBench::PerfCounters>();
+
+                    if (!pc->available()) {
+                        std::cerr << "Hardware counters unavailable: " << pc->error() << std::endl;
+                        pc.reset();
+                    }
+                }
+
+                return pc;
+            }();
+
+            return instance.get();
+        }
+
+        benchmark::State &state;        /**< Benchmark being measured */
+        double units_per_iteration;     /**< Divisor per iteration */
+        std::string unit;               /**< Unit name */
+    };
+
+    /**
+     * @brief Number of elements of a shape
+     */
+    size_t element_count(const std::vector<int64_t> &shape) {
+        size_t count = 1;
+
+        for (auto dim : shape) {
+            count *= static_cast<size_t>(dim);
+        }
+
+        return count;
+    }
+}
+
+
+/**
+ * @brief Greedy token selection over one logits row, arg: vocabulary size
+ */
+static void BM_GetNextToken(benchmark::State &state) {
+    std::vector<int64_t> shape{1, 1, state.range(0)};
+    std::vector<float> logits(element_count(shape));
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> dist(-10.0f, 10.0f);
+
+    for (auto &logit : logits) {
+        logit = dist(rng);
+    }
+
+    PerfScope perf(state, 1.0, "token");
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(OnnxModelBenchAccess::get_next_token(make_tensor(logits, shape)));
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GetNextToken)->Arg(32768)->Arg(51865)->Arg(128000);
+
+/**
+ * @brief Cloning one KV cache tensor into a decoder input, arg: cached tokens
+ */
+static void BM_CloneTensor(benchmark::State &state) {
+    auto memory_info = default_memory_info();
+    std::vector<int64_t> shape{1, 8, state.range(0), 52};
+    std::vector<float> buffer(element_count(shape), 0.5f);
+    auto tensor = make_tensor(buffer, shape);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(OnnxModelBenchAccess::clone_tensor(tensor, memory_info));
+    }
+
+    state.SetBytesProcessed(state.iterations() * buffer.size() * sizeof(float));
+}
+BENCHMARK(BM_CloneTensor)->Arg(1)->Arg(64)->Arg(256)->Arg(400);
+
+/**
+ * @brief Swapping a decoder step's present values into the cache, arg: cached tokens
+ *
+ * Uses the layer and head layout of the base model: 8 layers, each with
+ * decoder and encoder key and value tensors.
+ */
+static void BM_UpdateKvCache(benchmark::State &state) {
+    constexpr size_t kv_tensors = 8 * 4;
+    std::vector<int64_t> shape{1, 8, state.range(0), 52};
+    std::vector<std::vector<float>> buffers(2 * kv_tensors, std::vector<float>(element_count(shape), 0.5f));
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::vector<Ort::Value> cache;
+        std::vector<Ort::Value> present;
+
+        for (size_t i = 0; i < kv_tensors; i++) {
+            cache.emplace_back(make_tensor(buffers[i], shape));
+            present.emplace_back(make_tensor(buffers[kv_tensors + i], shape));
+        }
+        state.ResumeTiming();
+
+        OnnxModelBenchAccess::update_kv_cache(cache, present, true);
+        benchmark::DoNotOptimize(cache.data());
+    }
+}
+BENCHMARK(BM_UpdateKvCache)->Arg(1)->Arg(64)->Arg(256)->Arg(400);
+
+/**
+ * @brief Encoder forward pass, arg: seconds of audio
+ */
+static void BM_Encoder(benchmark::State &state) {
+    auto *model = require_model(state);
+
+    if (!model) {
+        return;
+    }
+
+    auto audio = synthetic_audio(static_cast<size_t>(state.range(0)));
+
+    PerfScope perf(state, static_cast<double>(state.range(0)), "audio_s");
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(OnnxModelBenchAccess::run_encoder(*model, audio));
+    }
+
+    state.counters["audio_s_per_s"] = benchmark::Counter(
+        static_cast<double>(state.range(0)) * state.iterations(), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_Encoder)->Arg(1)->Arg(5)->Arg(10)->Arg(30)->Arg(60)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/**
+ * @brief One cached decoder step, arg: tokens already in the decoder KV cache
+ *
+ * The cross attention cache is sized for 5 seconds of encoded audio, so the
+ * result isolates how step cost grows with the self attention cache.
+ */
+static void BM_DecoderStep(benchmark::State &state) {
+    auto *model = require_model(state);
+
+    if (!model) {
+        return;
+    }
+
+    auto audio = synthetic_audio(5);
+    auto encoded = OnnxModelBenchAccess::run_encoder(*model, audio);
+    auto &last_hidden_state = encoded.at(0);
+    int64_t frames = last_hidden_state.GetTensorTypeAndShapeInfo().GetShape().at(1);
+
+    int64_t heads = OnnxModelBenchAccess::num_kv_heads(*model);
+    int64_t head_dim = OnnxModelBenchAccess::head_dim(*model);
+    std::vector<int64_t> decoder_shape{1, heads, state.range(0), head_dim};
+    std::vector<int64_t> encoder_shape{1, heads, frames, head_dim};
+
+    std::vector<std::vector<float>> buffers;
+    std::vector<Ort::Value> past_key_values;
+
+    for (const auto *name : OnnxModelBenchAccess::decoder_input_names(*model)) {
+        std::string key(name);
+
+        if (key.find("past_key_values") == std::string::npos) {
+            continue;
+        }
+
+        const auto &shape = key.find("decoder") != std::string::npos ? decoder_shape : encoder_shape;
+        buffers.emplace_back(element_count(shape), 0.01f);
+        past_key_values.emplace_back(make_tensor(buffers.back(), shape));
+    }
+
+    std::vector<int64_t> cur_tokens{100};
+    PerfScope perf(state, 1.0, "token");
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(OnnxModelBenchAccess::decode_next_token(
+            *model, cur_tokens, last_hidden_state, past_key_values));
+    }
+}
+BENCHMARK(BM_DecoderStep)->Arg(1)->Arg(16)->Arg(64)->Arg(128)->Arg(256)->Arg(400)
+    ->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+/**
+ * @brief Detokenizing a transcript, arg: token count
+ */
+static void BM_TokenizerDecode(benchmark::State &state) {
+    auto path = env_or_empty("MOONSHINE_BENCH_TOKENIZER");
+
+    if (path.empty()) {
+        state.SkipWithError("set MOONSHINE_BENCH_TOKENIZER");
+        return;
+    }
+
+    std::ifstream ifs(path);
+    std::stringstream buffer;
+    buffer << ifs.rdbuf();
+    auto tokenizer = tokenizers::Tokenizer::FromBlobJSON(buffer.str());
+
+    std::vector<int> tokens(static_cast<size_t>(state.range(0)));
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int> dist(3, 30000);
+
+    for (auto &token : tokens) {
+        token = dist(rng);
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(tokenizer->Decode(tokens));
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TokenizerDecode)->Arg(8)->Arg(64)->Arg(360);
+
+/**
+ * @brief Creating both ORT sessions from the model files
+ */
+static void BM_SessionConstruction(benchmark::State &state) {
+    auto encoder = env_or_empty("MOONSHINE_BENCH_ENCODER");
+    auto decoder = env_or_empty("MOONSHINE_BENCH_DECODER");
+
+    if (encoder.empty() || decoder.empty()) {
+        state.SkipWithError("set MOONSHINE_BENCH_ENCODER and MOONSHINE_BENCH_DECODER");
+        return;
+    }
+
+    bool base = env_or_empty("MOONSHINE_BENCH_MODEL") == "base";
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(base ? OnnxModel::Base(encoder, decoder, bench_threads())
+                                      : OnnxModel::Tiny(encoder, decoder, bench_threads()));
+    }
+}
+BENCHMARK(BM_SessionConstruction)->Unit(benchmark::kMillisecond)->Iterations(5);
+
+BENCHMARK_MAIN();
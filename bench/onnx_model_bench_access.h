@@ -0,0 +1,70 @@
+#ifndef MOONSHINE_BENCH_ONNX_MODEL_BENCH_ACCESS_H__
+#define MOONSHINE_BENCH_ONNX_MODEL_BENCH_ACCESS_H__
+
+/**
+ * @file onnx_model_bench_access.h
+ * @brief Access to the decode internals of OnnxModel for the benchmark tools
+ */
+
+#ifndef MOONSHINE_BENCH_ACCESS
+#error "onnx_model_bench_access.h needs MOONSHINE_BENCH_ACCESS, set on the bench targets that use it"
+#endif
+
+#include <vector>
+#include "moonshine_onnx_model.h"
+
+
+namespace Moonshine {
+
+/**
+ * @struct OnnxModelBenchAccess
+ * @brief Exposes the private decode internals of OnnxModel to the benchmarks
+ */
+struct OnnxModelBenchAccess {
+    static int get_next_token(Ort::Value logits) {
+        return OnnxModel::get_next_token(std::move(logits));
+    }
+
+    static void update_kv_cache(std::vector<Ort::Value> &cache,
+                                std::vector<Ort::Value> &new_values,
+                                bool use_cache_branch)
+    {
+        OnnxModel::update_kv_cache(cache, new_values, use_cache_branch);
+    }
+
+    static Ort::Value clone_tensor(Ort::Value &tensor, Ort::MemoryInfo &mem_info) {
+        return OnnxModel::clone_tensor<float>(tensor, mem_info);
+    }
+
+    static std::vector<Ort::Value> run_encoder(OnnxModel &model, std::vector<float> &audio_data) {
+        return model.run_encoder(audio_data);
+    }
+
+    static std::vector<Ort::Value> decode_next_token(OnnxModel &model,
+                                                     std::vector<int64_t> &cur_tokens,
+                                                     Ort::Value &last_hidden_state,
+                                                     std::vector<Ort::Value> &past_key_values,
+                                                     bool use_cache_branch = true)
+    {
+        return model.decode_next_token(cur_tokens, last_hidden_state, past_key_values, use_cache_branch);
+    }
+
+    static std::vector<Ort::Value> initialize_past_key_values(OnnxModel &model) {
+        return model.initialize_past_key_values();
+    }
+
+    static const std::vector<const char *> &decoder_input_names(const OnnxModel &model) {
+        return model.decoder_input_names;
+    }
+
+    static int64_t num_kv_heads(const OnnxModel &model) { return model.num_kv_heads; }
+    static int64_t head_dim(const OnnxModel &model) { return model.head_dim; }
+
+    static constexpr int start_token = OnnxModel::start_token;
+    static constexpr int end_token = OnnxModel::end_token;
+    static constexpr size_t max_tokens_per_second = OnnxModel::max_tokens_per_second;
+};
+
+}
+
+#endif
@@ -0,0 +1,132 @@
+/**
+ * @file perf_counters.cpp
+ * @brief Hardware performance counters of the calling thread via Linux perf_event_open.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+#ifdef __linux__
+    /**
+     * @brief Builds the config of a hardware cache read miss event
+     */
+    constexpr uint64_t cache_read_miss(uint64_t cache) {
+        return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+
+    /**
+     * @brief Event type and config of each counter, in PerfCounts order
+     */
+    constexpr std::array<std::pair<uint32_t, uint64_t>, MoonshineBench::PerfCounts::count> events = {{
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HW_CACHE, cache_read_miss(PERF_COUNT_HW_CACHE_L1D)},
+        {PERF_TYPE_HW_CACHE, cache_read_miss(PERF_COUNT_HW_CACHE_LL)},
+        {PERF_TYPE_HW_CACHE, cache_read_miss(PERF_COUNT_HW_CACHE_DTLB)},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    }};
+
+    /**
+     * @brief Value layout for PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING
+     */
+    struct ReadFormat {
+        uint64_t value;
+        uint64_t time_enabled;
+        uint64_t time_running;
+    };
+
+    int open_event(uint32_t type, uint64_t config) {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+#endif
+}
+
+
+namespace MoonshineBench {
+
+PerfCounters::PerfCounters() {
+    fds.fill(-1);
+
+#ifdef __linux__
+    for (size_t i = 0; i < fds.size(); i++) {
+        fds[i] = open_event(events[i].first, events[i].second);
+
+        if (fds[i] < 0 && failure.empty()) {
+            failure = std::string("perf_event_open(") + PerfCounts::names[i] + "): " + std::strerror(errno) +
+                      " (check /proc/sys/kernel/perf_event_paranoid)";
+        }
+    }
+#else
+    failure = "perf_event_open is only available on Linux";
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+    for (int fd : fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+#endif
+}
+
+void PerfCounters::start() noexcept {
+#ifdef __linux__
+    for (int fd : fds) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+PerfCounts PerfCounters::stop() noexcept {
+    PerfCounts counts;
+
+#ifdef __linux__
+    for (int fd : fds) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+
+    for (size_t i = 0; i < fds.size(); i++) {
+        ReadFormat data{};
+
+        if (fds[i] < 0 || read(fds[i], &data, sizeof(data)) != static_cast<ssize_t>(sizeof(data))) {
+            continue;
+        }
+
+        // Scale up for the time the counter was multiplexed out
+        counts.values[i] = data.time_running
+            ? static_cast<double>(data.value) * data.time_enabled / data.time_running
+            : 0.0;
+        counts.valid[i] = true;
+    }
+#endif
+
+    return counts;
+}
+
+} // namespace MoonshineBench
@@ -0,0 +1,129 @@
+#ifndef MOONSHINE_BENCH_PERF_COUNTERS_H__
+#define MOONSHINE_BENCH_PERF_COUNTERS_H__
+
+/**
+ * @file perf_counters.h
+ * @brief Hardware performance counters of the calling thread via Linux perf_event_open
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+namespace MoonshineBench {
+
+/**
+ * @struct PerfCounts
+ * @brief Counter values accumulated over one or more measured regions
+ */
+struct PerfCounts {
+    static constexpr size_t count = 6;  /**< Number of counters */
+
+    /**
+     * @brief Names of the counters, in storage order
+     */
+    static constexpr std::array<const char *, count> names = {
+        "cycles", "instructions", "l1d_misses", "llc_misses", "dtlb_misses", "branch_misses"
+    };
+
+    std::array<double, count> values{};     /**< Values, scaled for multiplexing */
+    std::array<bool, count> valid{};        /**< Whether the counter could be opened */
+
+    double cycles() const noexcept { return values[0]; }
+    double instructions() const noexcept { return values[1]; }
+
+    /**
+     * @brief Gets instructions per cycle
+     * @return double IPC, 0 if cycles were not counted
+     */
+    double ipc() const noexcept { return cycles() > 0.0 ? instructions() / cycles() : 0.0; }
+
+    /**
+     * @brief Adds another set of counts
+     * @param other Counts to add
+     * @return PerfCounts& This
+     */
+    PerfCounts &operator+=(const PerfCounts &other) noexcept {
+        for (size_t i = 0; i < count; i++) {
+            values[i] += other.values[i];
+            valid[i] = valid[i] || other.valid[i];
+        }
+
+        return *this;
+    }
+};
+
+/**
+ * @class PerfCounters
+ * @brief Counts cycles, instructions, cache, TLB and branch misses of the calling thread
+ *
+ * Each counter is opened on its own so a CPU with few programmable counters
+ * multiplexes them instead of failing; values are scaled by the fraction of
+ * time each was running. Counters that cannot be opened (no PMU access in a
+ * container, perf_event_paranoid too high, non-Linux) are reported invalid.
+ * Only the thread that opened the counters is measured, so run ORT with one
+ * intra-op thread to attribute all of a stage's work.
+ */
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    /**
+     * @brief Checks whether at least cycles and instructions are counted
+     * @return bool True if usable
+     */
+    bool available() const noexcept { return fds[0] >= 0 && fds[1] >= 0; }
+
+    /**
+     * @brief Resets and starts all counters
+     */
+    void start() noexcept;
+
+    /**
+     * @brief Stops all counters and reads them
+     * @return PerfCounts Counts since start()
+     */
+    PerfCounts stop() noexcept;
+
+    /**
+     * @brief Explains why counters are unavailable
+     * @return std::string Reason, empty if available
+     */
+    std::string error() const { return failure; }
+
+private:
+    std::array<int, PerfCounts::count> fds;     /**< Event file descriptors, -1 if not opened */
+    std::string failure;                        /**< First open error */
+};
+
+/**
+ * @class ScopedPerfCounts
+ * @brief Adds the counts of its lifetime to an accumulator
+ */
+class ScopedPerfCounts {
+public:
+    ScopedPerfCounts(PerfCounters &counters, PerfCounts &total) noexcept
+        : counters(counters), total(total)
+    {
+        counters.start();
+    }
+
+    ~ScopedPerfCounts() { total += counters.stop(); }
+
+    ScopedPerfCounts(const ScopedPerfCounts &) = delete;
+    ScopedPerfCounts &operator=(const ScopedPerfCounts &) = delete;
+
+private:
+    PerfCounters &counters;     /**< Counters being read */
+    PerfCounts &total;          /**< Accumulator */
+};
+
+}
+
+#endif
@@ -0,0 +1,220 @@
+/**
+ * @file perf_gate.cpp
+ * @brief Performance regression gate comparing a fixed benchmark set to a stored baseline.
+ *
+ * Measures session startup, a short and a long utterance end to end, the
+ * median decoder step and peak RSS, then compares each against a baseline
+ * JSON with a relative tolerance per metric. Exits with 1 if any metric got
+ * worse than its tolerance allows, printing the comparison either way.
+ *
+ * Usage:
+ *   moonshine_perf_gate <model> <encoder.onnx> <decoder.onnx> <tok.json> <short.wav> <long.wav>
+ *       --baseline baseline.json [--repeat 5] [--threads 1]
+ *       [--write-baseline out.json] [--tolerance 0.10]
+ *
+ * --write-baseline records the current machine's numbers with the given
+ * tolerance instead of comparing; commit the result next to the CI config
+ * of the machine it was measured on. Baselines only hold on like hardware.
+ * bench/baselines/reference.json is the default baseline of the perf_gate
+ * ctest test, which runs this tool and counts exit code 77, returned when no
+ * model inputs are given, as skipped.
+ *
+ * Baseline format:
+ *   {"metrics": {"startup_ms": {"value": 850.0, "tolerance": 0.10}, ...}}
+ */
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include "bench_common.h"
+
+
+namespace {
+    using namespace MoonshineBench;
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int skip_exit_code = 77;  /**< SKIP_RETURN_CODE of the perf_gate test */
+
+    /**
+     * @struct Measurement
+     * @brief One gated metric, lower is better
+     */
+    struct Measurement {
+        std::string name;   /**< Metric name in the baseline */
+        double value;       /**< Measured value */
+    };
+
+    double elapsed_ms(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    /**
+     * @brief Runs the fixed benchmark set
+     */
+    std::vector<Measurement> measure(const ModelSpec &spec,
+                                     const Clip &short_clip,
+                                     const Clip &long_clip,
+                                     size_t repeat,
+                                     int threads)
+    {
+        std::vector<Measurement> results;
+        std::vector<double> startup;
+        std::unique_ptr<Moonshine::Transcriber> stt;
+
+        for (size_t i = 0; i < std::max<size_t>(repeat / 2, 1); i++) {
+            stt.reset();
+
+            auto start = Clock::now();
+            stt = spec.make_transcriber(threads);
+            startup.push_back(elapsed_ms(start));
+        }
+
+        results.push_back({"startup_ms", percentile(startup, 0.5)});
+
+        // One untimed pass of each so first-run allocations are not gated.
+        stt->transcribe(short_clip.samples);
+        stt->transcribe(long_clip.samples);
+
+        std::vector<double> short_ms;
+        std::vector<double> long_ms;
+        std::vector<double> step_ms;
+
+        for (size_t i = 0; i < repeat; i++) {
+            auto start = Clock::now();
+            stt->transcribe(short_clip.samples);
+            short_ms.push_back(elapsed_ms(start));
+
+            start = Clock::now();
+            auto result = stt->transcribe_detailed(long_clip.samples, true);
+            long_ms.push_back(elapsed_ms(start));
+
+            if (result.timings_collected) {
+                for (const auto &step : result.decode_step_timings) {
+                    step_ms.push_back(step.wall_ms);
+                }
+            }
+        }
+
+        results.push_back({"short_e2e_ms", percentile(short_ms, 0.5)});
+        results.push_back({"long_e2e_ms", percentile(long_ms, 0.5)});
+
+        if (!step_ms.empty()) {
+            results.push_back({"decoder_step_ms", percentile(step_ms, 0.5)});
+        } else {
+            std::cerr << "Decoder step timings unavailable (built with MOONSHINE_ENABLE_TIMINGS=OFF)\n";
+        }
+
+        results.push_back({"peak_rss_mb", peak_rss_bytes() / (1024.0 * 1024.0)});
+
+        return results;
+    }
+
+    void write_baseline(const std::string &path, const std::vector<Measurement> &results, double tolerance) {
+        std::ofstream ofs(path, std::ios::trunc);
+
+        if (!ofs) {
+            throw std::runtime_error("Unable to open " + path);
+        }
+
+        ofs << std::setprecision(6) << "{\n  \"metrics\": {";
+
+        for (size_t i = 0; i < results.size(); i++) {
+            ofs << (i ? "," : "") << "\n    " << json_string(results[i].name)
+                << ": {\"value\": " << results[i].value << ", \"tolerance\": " << tolerance << "}";
+        }
+
+        ofs << "\n  }\n}\n";
+    }
+
+    /**
+     * @brief Prints the comparison table
+     * @return bool True if no metric regressed
+     */
+    bool compare(const std::map<std::string, double> &baseline, const std::vector<Measurement> &results) {
+        bool passed = true;
+
+        std::cout << std::left << std::setw(18) << "metric"
+                  << std::right << std::setw(12) << "baseline" << std::setw(12) << "current"
+                  << std::setw(10) << "delta" << std::setw(10) << "limit" << "  status\n";
+
+        for (const auto &m : results) {
+            auto value = baseline.find("metrics." + m.name + ".value");
+            auto tolerance = baseline.find("metrics." + m.name + ".tolerance");
+
+            std::cout << std::left << std::setw(18) << m.name << std::right << std::fixed << std::setprecision(2);
+
+            if (value == baseline.end()) {
+                std::cout << std::setw(12) << "-" << std::setw(12) << m.value << "  not in baseline\n";
+                continue;
+            }
+
+            double tol = tolerance == baseline.end() ? 0.10 : tolerance->second;
+            double delta = value->second > 0.0 ? m.value / value->second - 1.0 : 0.0;
+            const char *status = "ok";
+
+            if (delta > tol) {
+                status = "REGRESSION";
+                passed = false;
+            } else if (delta < -tol) {
+                status = "improved, consider updating the baseline";
+            }
+
+            std::cout << std::setw(12) << value->second << std::setw(12) << m.value
+                      << std::setw(9) << std::showpos << delta * 100.0 << '%'
+                      << std::setw(9) << tol * 100.0 << '%' << std::noshowpos
+                      << "  " << status << '\n';
+        }
+
+        return passed;
+    }
+}
+
+
+int main(int argc, char *argv[]) {
+    try {
+        Args args(argc, argv);
+
+        if (args.positional().empty() && args.has("--baseline")) {
+            std::cout << "No model inputs given, skipping; set MOONSHINE_PERF_GATE_INPUTS to run the gate" << std::endl;
+
+            return skip_exit_code;
+        }
+
+        if (args.positional().size() != 6 || (!args.has("--baseline") && !args.has("--write-baseline"))) {
+            std::cerr << "Usage: " << argv[0]
+                      << " <model> <encoder.onnx> <decoder.onnx> <tok.json> <short.wav> <long.wav>"
+                      << " --baseline baseline.json [--repeat 5] [--threads 1]"
+                      << " [--write-baseline out.json] [--tolerance 0.10]" << std::endl;
+
+            return 2;
+        }
+
+        auto spec = ModelSpec::parse(args.positional());
+        auto short_clip = load_corpus(args.positional()[4]).front();
+        auto long_clip = load_corpus(args.positional()[5]).front();
+        auto repeat = static_cast<size_t>(std::max(1.0, args.get_number("--repeat", 5)));
+        auto threads = static_cast<int>(args.get_number("--threads", 1));
+
+        auto results = measure(spec, short_clip, long_clip, repeat, threads);
+
+        if (args.has("--write-baseline")) {
+            write_baseline(args.get("--write-baseline"), results, args.get_number("--tolerance", 0.10));
+            std::cout << "Wrote baseline " << args.get("--write-baseline") << std::endl;
+
+            return 0;
+        }
+
+        if (!compare(read_json_numbers(args.get("--baseline")), results)) {
+            std::cout << "Performance regression against " << args.get("--baseline") << std::endl;
+
+            return 1;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+
+        return 2;
+    }
+
+    return 0;
+}
@@ -0,0 +1,349 @@
+/**
+ * @file replay.cpp
+ * @brief Re-issues captured traffic with its original inter-arrival timing.
+ *
+ * Reads a log written by Moonshine::TrafficRecorder and sends every request
+ * whose audio was stored to a pool of worker Transcribers at the captured
+ * offsets, scaled by --speed. Like the load generator this is open loop:
+ * latency runs from the scheduled arrival, so queueing behind slow requests
+ * is counted. Each replayed stage is compared with the captured timings, and
+ * requests whose token count differs from the capture are reported.
+ *
+ * The model configuration logged with each request (OnnxModel::get_config())
+ * is compared with the replay model's before sending anything, and every
+ * difference is reported; --strict-config makes a difference fatal. The
+ * compaction, shortlist and bucket flags recreate a captured configuration;
+ * the first four mirror the moonshine_eval config keys.
+ *
+ * Requests logged without audio keep their place in the timeline but are not
+ * sent; they are counted as skipped.
+ *
+ * Usage:
+ *   moonshine_replay <model> <encoder.onnx> <decoder.onnx> <tok.json> <capture.bin>
+ *       [--workers 1] [--threads 1] [--speed 1] [--json out.json] [--strict-config]
+ *       [--compact-pause-ms 1000] [--shortlist-decoder <onnx> --shortlist-tokens <txt>
+ *       [--shortlist-min-logit 0]] [--buckets 80000,160000]
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include "bench_common.h"
+#include "latency_histogram.h"
+#include "moonshine_capture.h"
+
+
+namespace {
+    using namespace MoonshineBench;
+    using Clock = std::chrono::steady_clock;
+
+    enum StageIndex { InputPrep, Encode, Decode, Detokenize, Total, StageCount };
+
+    constexpr const char *stage_names[StageCount] = {"input_prep", "encode", "decode", "detokenize", "total"};
+
+    /**
+     * @struct StageComparison
+     * @brief Captured against replayed wall time of one stage
+     */
+    struct StageComparison {
+        std::vector<double> captured_ms;    /**< Captured time of each replayed request */
+        std::vector<double> replayed_ms;    /**< Replayed time of each replayed request */
+    };
+
+    /**
+     * @struct ReplayResult
+     * @brief Outcome of a replay
+     */
+    struct ReplayResult {
+        size_t logged = 0;                  /**< Requests in the capture */
+        size_t skipped = 0;                 /**< Requests captured without audio */
+        size_t token_mismatches = 0;        /**< Replays whose token count differed from the capture */
+        size_t config_mismatches = 0;       /**< Replayed requests captured with another model configuration */
+        double span_s = 0.0;                /**< Replayed timeline length */
+        LatencyHistogram latency;           /**< Scheduled arrival to completion */
+        std::array<StageComparison, StageCount> stages;  /**< Per-stage comparison */
+    };
+
+    /**
+     * @brief Gets the OnnxModel::get_config() part of a logged configuration
+     * @return std::string Empty for captures that only logged model and tokenizer identity
+     */
+    std::string model_config(const std::string &config) {
+        auto model_end = config.find('|');
+        auto tokenizer_end = model_end == std::string::npos ? model_end : config.find('|', model_end + 1);
+
+        return tokenizer_end == std::string::npos ? std::string() : config.substr(tokenizer_end + 1);
+    }
+
+    /**
+     * @brief Builds the model options from the configuration flags
+     */
+    Moonshine::ModelOptions parse_options(const Args &args) {
+        Moonshine::ModelOptions options;
+        options.num_threads = static_cast<int>(args.get_number("--threads", 1));
+
+        if (args.has("--compact-pause-ms")) {
+            options.silence_compaction = Moonshine::SilenceCompaction{};
+            options.silence_compaction->min_pause_ms = static_cast<size_t>(args.get_number("--compact-pause-ms", 1000));
+        }
+
+        if (args.has("--shortlist-decoder")) {
+            options.shortlist = Moonshine::VocabShortlist::from_files(
+                args.get("--shortlist-decoder"), args.get("--shortlist-tokens"),
+                static_cast<float>(args.get_number("--shortlist-min-logit", 0.0)));
+        }
+
+        std::stringstream buckets(args.get("--buckets"));
+
+        for (std::string bucket; std::getline(buckets, bucket, ',');) {
+            options.encoder_buckets.push_back(std::stoul(bucket));
+        }
+
+        return options;
+    }
+
+    /**
+     * @brief Counts and reports requests captured with another model configuration
+     * @return size_t Number of such requests
+     */
+    size_t check_configs(const std::vector<Moonshine::CapturedRequest> &requests, const std::string &replay_config) {
+        std::map<std::string, size_t> mismatched;
+        size_t count = 0;
+
+        for (const auto &request : requests) {
+            auto captured = model_config(request.config);
+
+            if (captured != replay_config) {
+                mismatched[captured]++;
+                count++;
+            }
+        }
+
+        for (const auto &entry : mismatched) {
+            std::cerr << "Configuration mismatch: " << entry.second << " requests captured with '"
+                      << (entry.first.empty() ? "unknown, not logged" : entry.first)
+                      << "', replaying with '" << replay_config << "'\n";
+        }
+
+        return count;
+    }
+
+    uint64_t to_us(Clock::duration d) {
+        return static_cast<uint64_t>(std::max<int64_t>(0,
+            std::chrono::duration_cast<std::chrono::microseconds>(d).count()));
+    }
+
+    std::array<double, StageCount> captured_stages(const Moonshine::CapturedRequest &request) {
+        return {request.input_prep_ms, request.encode_ms, request.decode_ms,
+                request.detokenize_ms, request.total_ms};
+    }
+
+    std::array<double, StageCount> replayed_stages(const Moonshine::TranscriptionResult &result) {
+        return {result.input_prep.wall_ms, result.encode.wall_ms, result.decode.wall_ms,
+                result.detokenize.wall_ms, result.total.wall_ms};
+    }
+
+    /**
+     * @brief Sends the requests at their scaled offsets
+     *
+     * An idle worker claims the next request in arrival order and sleeps
+     * until it is due, so no dispatcher thread sits between the schedule and
+     * the workers. When every worker is busy as a request falls due it starts
+     * late, and the delay is measured.
+     */
+    ReplayResult replay(std::vector<std::unique_ptr<Moonshine::Transcriber>> &transcribers,
+                        const std::vector<Moonshine::CapturedRequest> &requests,
+                        double speed)
+    {
+        ReplayResult result;
+        std::mutex mutex;
+        std::atomic<size_t> next{0};
+
+        const uint64_t first_ns = requests.empty() ? 0 : requests.front().arrival_ns;
+        auto start = Clock::now() + std::chrono::milliseconds(10);
+
+        auto scheduled = [&](const Moonshine::CapturedRequest &request) {
+            return start + std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>((request.arrival_ns - first_ns) / 1e9 / speed));
+        };
+
+        std::vector<std::thread> workers;
+
+        for (size_t w = 0; w < transcribers.size(); w++) {
+            workers.emplace_back([&, w]() {
+                for (size_t i = next++; i < requests.size(); i = next++) {
+                    const auto &request = requests[i];
+                    auto intended = scheduled(request);
+
+                    std::this_thread::sleep_until(intended);
+
+                    auto replayed = transcribers[w]->transcribe_detailed(request.samples);
+                    auto done = Clock::now();
+                    auto captured = captured_stages(request);
+                    auto measured = replayed_stages(replayed);
+
+                    std::lock_guard<std::mutex> lock(mutex);
+                    result.latency.record(to_us(done - intended));
+
+                    for (size_t s = 0; s < StageCount; s++) {
+                        result.stages[s].captured_ms.push_back(captured[s]);
+                        result.stages[s].replayed_ms.push_back(measured[s]);
+                    }
+
+                    if (replayed.tokens.size() != request.token_count) {
+                        result.token_mismatches++;
+                    }
+                }
+            });
+        }
+
+        for (auto &worker : workers) {
+            worker.join();
+        }
+
+        if (!requests.empty()) {
+            result.span_s = (requests.back().arrival_ns - first_ns) / 1e9 / speed;
+        }
+
+        return result;
+    }
+
+    void print_result(ReplayResult &r) {
+        std::cout << r.logged << " logged, " << r.latency.count() << " replayed, " << r.skipped
+                  << " skipped without audio, " << r.config_mismatches << " configuration mismatches, "
+                  << r.token_mismatches << " token count mismatches over "
+                  << std::fixed << std::setprecision(1) << r.span_s << " s\n";
+
+        std::cout << "latency_ms p50 " << r.latency.value_at_quantile(0.5) / 1000.0
+                  << " p99 " << r.latency.value_at_quantile(0.99) / 1000.0
+                  << " max " << r.latency.max() / 1000.0 << "\n\n";
+
+        std::cout << std::left << std::setw(12) << "stage" << std::right
+                  << std::setw(14) << "capt_p50_ms" << std::setw(14) << "repl_p50_ms"
+                  << std::setw(14) << "capt_p99_ms" << std::setw(14) << "repl_p99_ms"
+                  << std::setw(10) << "delta" << '\n';
+
+        for (size_t s = 0; s < StageCount; s++) {
+            auto &stage = r.stages[s];
+            double captured_p50 = percentile(stage.captured_ms, 0.5);
+            double replayed_p50 = percentile(stage.replayed_ms, 0.5);
+            double delta = captured_p50 > 0.0 ? 100.0 * (replayed_p50 - captured_p50) / captured_p50 : 0.0;
+
+            std::cout << std::left << std::setw(12) << stage_names[s] << std::right << std::setprecision(2)
+                      << std::setw(14) << captured_p50 << std::setw(14) << replayed_p50
+                      << std::setw(14) << percentile(stage.captured_ms, 0.99)
+                      << std::setw(14) << percentile(stage.replayed_ms, 0.99)
+                      << std::setprecision(1) << std::setw(9) << delta << "%\n";
+        }
+    }
+
+    void write_json(std::ostream &out, ReplayResult &r) {
+        out << std::setprecision(6) << "{\n"
+            << "  \"logged\": " << r.logged << ",\n"
+            << "  \"replayed\": " << r.latency.count() << ",\n"
+            << "  \"skipped\": " << r.skipped << ",\n"
+            << "  \"config_mismatches\": " << r.config_mismatches << ",\n"
+            << "  \"token_mismatches\": " << r.token_mismatches << ",\n"
+            << "  \"latency_ms\": {\"p50\": " << r.latency.value_at_quantile(0.5) / 1000.0
+            << ", \"p99\": " << r.latency.value_at_quantile(0.99) / 1000.0
+            << ", \"max\": " << r.latency.max() / 1000.0 << "},\n"
+            << "  \"stages\": {";
+
+        for (size_t s = 0; s < StageCount; s++) {
+            auto &stage = r.stages[s];
+
+            out << (s ? "," : "") << "\n    " << json_string(stage_names[s])
+                << ": {\"captured_p50_ms\": " << percentile(stage.captured_ms, 0.5)
+                << ", \"replayed_p50_ms\": " << percentile(stage.replayed_ms, 0.5)
+                << ", \"captured_p99_ms\": " << percentile(stage.captured_ms, 0.99)
+                << ", \"replayed_p99_ms\": " << percentile(stage.replayed_ms, 0.99) << "}";
+        }
+
+        out << "\n  }\n}\n";
+    }
+}
+
+
+int main(int argc, char *argv[]) {
+    try {
+        Args args(argc, argv, {"--strict-config"});
+
+        if (args.positional().size() != 5) {
+            std::cerr << "Usage: " << argv[0]
+                      << " <model> <encoder.onnx> <decoder.onnx> <tok.json> <capture.bin>"
+                      << " [--workers 1] [--threads 1] [--speed 1] [--json out.json] [--strict-config]"
+                      << " [--compact-pause-ms 1000] [--shortlist-decoder <onnx> --shortlist-tokens <txt>"
+                      << " [--shortlist-min-logit 0]] [--buckets 80000,160000]" << std::endl;
+
+            return 1;
+        }
+
+        auto spec = ModelSpec::parse(args.positional());
+        auto workers = static_cast<int>(args.get_number("--workers", 1));
+        auto options = parse_options(args);
+        double speed = args.get_number("--speed", 1.0);
+
+        if (speed <= 0.0) {
+            throw std::runtime_error("--speed must be positive");
+        }
+
+        Moonshine::CaptureReader reader(args.positional()[4]);
+        std::vector<Moonshine::CapturedRequest> requests;
+        Moonshine::CapturedRequest request;
+        size_t logged = 0;
+
+        while (reader.next(request)) {
+            logged++;
+
+            if (!request.samples.empty()) {
+                requests.push_back(std::move(request));
+            }
+        }
+
+        if (requests.empty()) {
+            throw std::runtime_error("Capture holds no requests with audio");
+        }
+
+        std::vector<std::unique_ptr<Moonshine::Transcriber>> transcribers;
+
+        for (int i = 0; i < std::max(workers, 1); i++) {
+            transcribers.push_back(spec.make_transcriber(options));
+        }
+
+        size_t config_mismatches = check_configs(requests, model_config(transcribers.front()->get_config()));
+
+        if (config_mismatches > 0 && args.has("--strict-config")) {
+            throw std::runtime_error("Replay model configuration differs from the capture");
+        }
+
+        for (auto &transcriber : transcribers) {
+            transcriber->transcribe(requests.front().samples);
+        }
+
+        auto result = replay(transcribers, requests, speed);
+        result.config_mismatches = config_mismatches;
+        result.logged = logged;
+        result.skipped = logged - requests.size();
+
+        print_result(result);
+
+        if (args.has("--json")) {
+            std::ofstream out(args.get("--json"));
+            write_json(out, result);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,250 @@
+/**
+ * @file rtf_bench.cpp
+ * @brief End-to-end throughput and latency benchmark over a corpus.
+ *
+ * For every combination of worker count and intra-op threads, one Transcriber
+ * per worker is created and warmed up, then the workers drain a shared queue
+ * holding the corpus `repeat` times. Each request's wall time and real time
+ * factor are recorded; throughput is audio seconds transcribed per wall second.
+ * Peak RSS is the process high-water mark, so list settings smallest first.
+ *
+ * Usage:
+ *   moonshine_rtf_bench <model> <encoder.onnx> <decoder.onnx> <tok.json> <corpus>
+ *       [--concurrency 1,2,4] [--threads 1,4] [--warmup 2] [--repeat 3] [--json out.json]
+ */
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include "bench_common.h"
+
+
+namespace {
+    using namespace MoonshineBench;
+
+    /**
+     * @struct RunStats
+     * @brief Measurements of one concurrency and thread setting
+     */
+    struct RunStats {
+        int concurrency = 1;            /**< Parallel workers */
+        int threads = 1;                /**< Intra-op threads per session */
+        double wall_s = 0.0;            /**< Wall time of the measured phase */
+        double audio_s = 0.0;           /**< Audio transcribed in the measured phase */
+        std::vector<double> latency_ms; /**< Per-request wall time */
+        std::vector<double> rtf;        /**< Per-request real time factor */
+        size_t peak_rss = 0;            /**< Process peak RSS after the run */
+    };
+
+    /**
+     * @brief Runs `count` requests over the corpus on one worker per transcriber
+     *
+     * @param record Receives the clip index and latency of each request, may be empty
+     */
+    template<typename Record>
+    void drain(std::vector<std::unique_ptr<Moonshine::Transcriber>> &transcribers,
+               const std::vector<Clip> &corpus,
+               size_t count,
+               Record record)
+    {
+        std::atomic<size_t> next{0};
+        std::vector<std::thread> workers;
+
+        for (auto &transcriber : transcribers) {
+            workers.emplace_back([&, stt = transcriber.get()]() {
+                for (size_t i = next++; i < count; i = next++) {
+                    const auto &clip = corpus[i % corpus.size()];
+                    auto start = std::chrono::steady_clock::now();
+
+                    stt->transcribe(clip.samples);
+
+                    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+                    record(i % corpus.size(), elapsed.count());
+                }
+            });
+        }
+
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    /**
+     * @brief Benchmarks one setting
+     */
+    RunStats run(const ModelSpec &spec,
+                 const std::vector<Clip> &corpus,
+                 int concurrency,
+                 int threads,
+                 size_t warmup,
+                 size_t repeat)
+    {
+        RunStats stats;
+        stats.concurrency = concurrency;
+        stats.threads = threads;
+
+        std::vector<std::unique_ptr<Moonshine::Transcriber>> transcribers;
+
+        for (int i = 0; i < concurrency; i++) {
+            transcribers.push_back(spec.make_transcriber(threads));
+        }
+
+        // Warm-up requests absorb session initialization, allocator growth and
+        // cold caches, none of which a long running service pays per request.
+        drain(transcribers, corpus, warmup * concurrency, [](size_t, double) {});
+
+        size_t count = corpus.size() * repeat;
+        std::vector<double> latency_ms(count);
+        std::vector<size_t> clip_index(count);
+        std::atomic<size_t> slot{0};
+
+        auto start = std::chrono::steady_clock::now();
+
+        drain(transcribers, corpus, count, [&](size_t clip, double ms) {
+            size_t i = slot++;
+            latency_ms[i] = ms;
+            clip_index[i] = clip;
+        });
+
+        stats.wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        for (size_t i = 0; i < count; i++) {
+            double seconds = corpus[clip_index[i]].seconds();
+            stats.audio_s += seconds;
+            stats.rtf.push_back(latency_ms[i] / 1000.0 / seconds);
+        }
+
+        stats.latency_ms = std::move(latency_ms);
+        stats.peak_rss = peak_rss_bytes();
+
+        return stats;
+    }
+
+    /**
+     * @brief Prints one table row per setting
+     */
+    void print_table(std::vector<RunStats> &runs) {
+        std::cout << std::left << std::setw(6) << "conc" << std::setw(8) << "threads"
+                  << std::right << std::setw(10) << "requests" << std::setw(12) << "audio_s/s"
+                  << std::setw(10) << "p50_ms" << std::setw(10) << "p90_ms"
+                  << std::setw(10) << "p99_ms" << std::setw(10) << "p999_ms"
+                  << std::setw(10) << "rtf_p50" << std::setw(10) << "rtf_p99"
+                  << std::setw(10) << "rss_mb" << '\n';
+
+        for (auto &r : runs) {
+            std::cout << std::left << std::setw(6) << r.concurrency << std::setw(8) << r.threads
+                      << std::right << std::setw(10) << r.latency_ms.size()
+                      << std::fixed << std::setprecision(2)
+                      << std::setw(12) << r.audio_s / r.wall_s
+                      << std::setprecision(1)
+                      << std::setw(10) << percentile(r.latency_ms, 0.5)
+                      << std::setw(10) << percentile(r.latency_ms, 0.9)
+                      << std::setw(10) << percentile(r.latency_ms, 0.99)
+                      << std::setw(10) << percentile(r.latency_ms, 0.999)
+                      << std::setprecision(3)
+                      << std::setw(10) << percentile(r.rtf, 0.5)
+                      << std::setw(10) << percentile(r.rtf, 0.99)
+                      << std::setprecision(1)
+                      << std::setw(10) << r.peak_rss / (1024.0 * 1024.0) << '\n';
+        }
+    }
+
+    /**
+     * @brief Writes all settings as JSON
+     */
+    void write_json(std::ostream &out,
+                    const std::string &corpus_path,
+                    const std::vector<Clip> &corpus,
+                    std::vector<RunStats> &runs)
+    {
+        double corpus_s = 0.0;
+
+        for (const auto &clip : corpus) {
+            corpus_s += clip.seconds();
+        }
+
+        out << std::setprecision(6) << "{\n"
+            << "  \"corpus\": " << json_string(corpus_path) << ",\n"
+            << "  \"clips\": " << corpus.size() << ",\n"
+            << "  \"corpus_seconds\": " << corpus_s << ",\n"
+            << "  \"runs\": [";
+
+        for (size_t i = 0; i < runs.size(); i++) {
+            auto &r = runs[i];
+
+            out << (i ? "," : "") << "\n    {"
+                << "\"concurrency\": " << r.concurrency
+                << ", \"threads\": " << r.threads
+                << ", \"requests\": " << r.latency_ms.size()
+                << ", \"wall_s\": " << r.wall_s
+                << ", \"throughput_audio_s_per_s\": " << r.audio_s / r.wall_s
+                << ", \"latency_ms\": {\"mean\": " << mean(r.latency_ms)
+                << ", \"p50\": " << percentile(r.latency_ms, 0.5)
+                << ", \"p90\": " << percentile(r.latency_ms, 0.9)
+                << ", \"p99\": " << percentile(r.latency_ms, 0.99)
+                << ", \"p999\": " << percentile(r.latency_ms, 0.999)
+                << ", \"max\": " << percentile(r.latency_ms, 1.0) << "}"
+                << ", \"rtf\": {\"mean\": " << mean(r.rtf)
+                << ", \"p50\": " << percentile(r.rtf, 0.5)
+                << ", \"p90\": " << percentile(r.rtf, 0.9)
+                << ", \"p99\": " << percentile(r.rtf, 0.99)
+                << ", \"max\": " << percentile(r.rtf, 1.0) << "}"
+                << ", \"peak_rss_bytes\": " << r.peak_rss << "}";
+        }
+
+        out << "\n  ]\n}\n";
+    }
+}
+
+
+int main(int argc, char *argv[]) {
+    try {
+        Args args(argc, argv);
+
+        if (args.positional().size() != 5) {
+            std::cerr << "Usage: " << argv[0]
+                      << " <model> <encoder.onnx> <decoder.onnx> <tok.json> <corpus>"
+                      << " [--concurrency 1,2,4] [--threads 1,4] [--warmup 2] [--repeat 3] [--json out.json]"
+                      << std::endl;
+
+            return 1;
+        }
+
+        auto spec = ModelSpec::parse(args.positional());
+        auto corpus = load_corpus(args.positional()[4]);
+        auto concurrencies = parse_int_list(args.get("--concurrency", "1"));
+        auto thread_counts = parse_int_list(args.get("--threads", "1"));
+        auto warmup = static_cast<size_t>(args.get_number("--warmup", 2));
+        auto repeat = static_cast<size_t>(std::max(1.0, args.get_number("--repeat", 3)));
+
+        std::vector<RunStats> runs;
+
+        for (int concurrency : concurrencies) {
+            for (int threads : thread_counts) {
+                std::cerr << "Running concurrency " << concurrency << ", threads " << threads << "..." << std::endl;
+                runs.push_back(run(spec, corpus, concurrency, threads, warmup, repeat));
+            }
+        }
+
+        print_table(runs);
+
+        if (args.has("--json")) {
+            std::ofstream ofs(args.get("--json"), std::ios::trunc);
+
+            if (!ofs) {
+                throw std::runtime_error("Unable to open " + args.get("--json"));
+            }
+
+            write_json(ofs, args.positional()[4], corpus, runs);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+
+        return 1;
+    }
+
+    return 0;
+}
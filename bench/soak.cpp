@@ -0,0 +1,342 @@
+/**
+ * @file soak.cpp
+ * @brief Long running soak test that watches for memory growth and heap fragmentation.
+ *
+ * Worker Transcribers transcribe clips drawn from a length mix for a fixed
+ * time while a sampler records RSS and, on glibc, the malloc heap statistics
+ * from mallinfo2. After a warm-up share of the run is discarded, the RSS
+ * trend is fitted and the run is flagged if memory keeps rising (a steady
+ * slope above the limit with window peaks that rarely go down) or if a large
+ * and growing share of the heap is free but not returned (fragmentation).
+ * The exit status is 1 when either is flagged.
+ *
+ * Usage:
+ *   moonshine_soak <model> <encoder.onnx> <decoder.onnx> <tok.json> <corpus>
+ *       [--minutes 60] [--workers 2] [--threads 1] [--interval 10] [--arena]
+ *       [--length-mix 0.5:1-5,0.35:5-15,0.15:15-30] [--max-growth-mb-per-hour 5]
+ *       [--max-free-ratio 0.5] [--warmup-fraction 0.2] [--csv samples.csv]
+ *
+ * --arena turns ORT's CPU arena allocator on, so runs with and without it can
+ * be compared. ORT 1.20 has no public call for arena statistics; its effect
+ * shows up in RSS and, when the arena is off, in the malloc heap.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <thread>
+#include "bench_common.h"
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define MOONSHINE_HAVE_MALLINFO2 1
+#else
+#define MOONSHINE_HAVE_MALLINFO2 0
+#endif
+
+
+namespace {
+    using namespace MoonshineBench;
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @struct LengthBucket
+     * @brief Share of requests with a length in a range
+     */
+    struct LengthBucket {
+        double weight;      /**< Relative share */
+        double min_s;       /**< Shortest clip */
+        double max_s;       /**< Longest clip */
+    };
+
+    /**
+     * @struct Sample
+     * @brief Memory state at one point in time
+     */
+    struct Sample {
+        double minutes = 0.0;       /**< Time since start */
+        uint64_t requests = 0;      /**< Requests completed so far */
+        size_t rss = 0;             /**< Resident set size */
+        size_t heap_arena = 0;      /**< Heap bytes obtained with brk */
+        size_t heap_mmap = 0;       /**< Heap bytes in mmapped chunks */
+        size_t heap_used = 0;       /**< Heap bytes allocated */
+        size_t heap_free = 0;       /**< Heap bytes free but kept */
+    };
+
+    std::vector<LengthBucket> parse_length_mix(const std::string &mix) {
+        std::vector<LengthBucket> buckets;
+        std::stringstream ss(mix);
+        std::string item;
+
+        while (std::getline(ss, item, ',')) {
+            LengthBucket bucket{};
+            char colon = 0;
+            char dash = 0;
+            std::istringstream fields(item);
+
+            if (!(fields >> bucket.weight >> colon >> bucket.min_s >> dash >> bucket.max_s) ||
+                colon != ':' || dash != '-' || bucket.min_s <= 0.0 || bucket.max_s < bucket.min_s)
+            {
+                throw std::runtime_error("Invalid length mix entry, expected weight:min-max: " + item);
+            }
+
+            buckets.push_back(bucket);
+        }
+
+        return buckets;
+    }
+
+    /**
+     * @brief Builds clips of the mixed lengths by cropping and tiling corpus audio
+     *
+     * The pool is built up front so the soak's own allocations stay out of
+     * the measurement.
+     */
+    std::vector<std::vector<float>> build_pool(const std::vector<Clip> &corpus,
+                                               const std::vector<LengthBucket> &mix,
+                                               size_t size,
+                                               std::mt19937_64 &rng)
+    {
+        std::vector<double> weights;
+
+        for (const auto &bucket : mix) {
+            weights.push_back(bucket.weight);
+        }
+
+        std::discrete_distribution<size_t> pick_bucket(weights.begin(), weights.end());
+        std::uniform_int_distribution<size_t> pick_clip(0, corpus.size() - 1);
+        std::vector<std::vector<float>> pool;
+
+        for (size_t i = 0; i < size; i++) {
+            const auto &bucket = mix[pick_bucket(rng)];
+            std::uniform_real_distribution<double> length(bucket.min_s, bucket.max_s);
+            const auto &source = corpus[pick_clip(rng)].samples;
+            auto samples = static_cast<size_t>(length(rng) * sample_rate);
+            size_t offset = std::uniform_int_distribution<size_t>(0, source.size() - 1)(rng);
+
+            std::vector<float> clip(samples);
+
+            for (size_t s = 0; s < samples; s++) {
+                clip[s] = source[(offset + s) % source.size()];
+            }
+
+            pool.push_back(std::move(clip));
+        }
+
+        return pool;
+    }
+
+    Sample take_sample(Clock::time_point start, uint64_t requests) {
+        Sample sample;
+        sample.minutes = std::chrono::duration<double, std::ratio<60>>(Clock::now() - start).count();
+        sample.requests = requests;
+        sample.rss = current_rss_bytes();
+
+#if MOONSHINE_HAVE_MALLINFO2
+        auto info = mallinfo2();
+        sample.heap_arena = info.arena;
+        sample.heap_mmap = info.hblkhd;
+        sample.heap_used = info.uordblks;
+        sample.heap_free = info.fordblks;
+#endif
+
+        return sample;
+    }
+
+    double mb(size_t bytes) {
+        return bytes / (1024.0 * 1024.0);
+    }
+
+    double free_ratio(const Sample &s) {
+        return s.heap_arena ? static_cast<double>(s.heap_free) / s.heap_arena : 0.0;
+    }
+
+    /**
+     * @brief Least squares slope of RSS in MB per hour
+     */
+    double rss_slope_mb_per_hour(const std::vector<Sample> &samples) {
+        double n = static_cast<double>(samples.size());
+        double sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+
+        for (const auto &s : samples) {
+            double x = s.minutes / 60.0;
+            double y = mb(s.rss);
+
+            sx += x;
+            sy += y;
+            sxx += x * x;
+            sxy += x * y;
+        }
+
+        double denom = n * sxx - sx * sx;
+
+        return denom > 0.0 ? (n * sxy - sx * sy) / denom : 0.0;
+    }
+
+    /**
+     * @brief Share of consecutive windows whose peak RSS did not go down
+     */
+    double rising_window_share(const std::vector<Sample> &samples, size_t windows) {
+        windows = std::min(windows, samples.size() / 2);
+
+        if (windows < 2) {
+            return 0.0;
+        }
+
+        std::vector<size_t> peaks(windows, 0);
+
+        for (size_t i = 0; i < samples.size(); i++) {
+            auto &peak = peaks[i * windows / samples.size()];
+            peak = std::max(peak, samples[i].rss);
+        }
+
+        size_t rising = 0;
+
+        for (size_t w = 1; w < windows; w++) {
+            rising += peaks[w] >= peaks[w - 1];
+        }
+
+        return static_cast<double>(rising) / (windows - 1);
+    }
+
+    void write_csv(const std::string &path, const std::vector<Sample> &samples) {
+        std::ofstream ofs(path, std::ios::trunc);
+
+        if (!ofs) {
+            throw std::runtime_error("Unable to open " + path);
+        }
+
+        ofs << "minutes,requests,rss_mb,heap_arena_mb,heap_mmap_mb,heap_used_mb,heap_free_mb\n";
+
+        for (const auto &s : samples) {
+            ofs << s.minutes << ',' << s.requests << ',' << mb(s.rss) << ',' << mb(s.heap_arena) << ','
+                << mb(s.heap_mmap) << ',' << mb(s.heap_used) << ',' << mb(s.heap_free) << '\n';
+        }
+    }
+}
+
+
+int main(int argc, char *argv[]) {
+    try {
+        Args args(argc, argv, {"--arena"});
+
+        if (args.positional().size() != 5) {
+            std::cerr << "Usage: " << argv[0]
+                      << " <model> <encoder.onnx> <decoder.onnx> <tok.json> <corpus>"
+                      << " [--minutes 60] [--workers 2] [--threads 1] [--interval 10] [--arena]"
+                      << " [--length-mix 0.5:1-5,0.35:5-15,0.15:15-30] [--max-growth-mb-per-hour 5]"
+                      << " [--max-free-ratio 0.5] [--warmup-fraction 0.2] [--csv samples.csv]" << std::endl;
+
+            return 2;
+        }
+
+        auto spec = ModelSpec::parse(args.positional());
+        auto corpus = load_corpus(args.positional()[4]);
+        auto mix = parse_length_mix(args.get("--length-mix", "0.5:1-5,0.35:5-15,0.15:15-30"));
+        double minutes = args.get_number("--minutes", 60.0);
+        auto workers = std::max(1, static_cast<int>(args.get_number("--workers", 2)));
+        auto interval = std::chrono::duration<double>(std::max(0.1, args.get_number("--interval", 10.0)));
+        double max_growth = args.get_number("--max-growth-mb-per-hour", 5.0);
+        double max_free_ratio = args.get_number("--max-free-ratio", 0.5);
+        double warmup_fraction = std::clamp(args.get_number("--warmup-fraction", 0.2), 0.0, 0.9);
+
+        std::mt19937_64 rng(1);
+        auto pool = build_pool(corpus, mix, 64, rng);
+
+        Moonshine::ModelOptions options;
+        options.num_threads = static_cast<int>(args.get_number("--threads", 1));
+        options.cpu_mem_arena = args.has("--arena");
+
+        std::vector<std::unique_ptr<Moonshine::Transcriber>> transcribers;
+
+        for (int i = 0; i < workers; i++) {
+            transcribers.push_back(spec.make_transcriber(options));
+        }
+
+        auto start = Clock::now();
+        auto end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::ratio<60>>(minutes));
+        std::atomic<uint64_t> requests{0};
+        std::vector<std::thread> threads;
+
+        for (int w = 0; w < workers; w++) {
+            threads.emplace_back([&, w]() {
+                size_t next = static_cast<size_t>(w) * 7;
+
+                while (Clock::now() < end) {
+                    transcribers[w]->transcribe(pool[next++ % pool.size()]);
+                    requests++;
+                }
+            });
+        }
+
+        std::vector<Sample> samples;
+
+        while (Clock::now() < end) {
+            std::this_thread::sleep_for(std::min<Clock::duration>(
+                std::chrono::duration_cast<Clock::duration>(interval), end - Clock::now()));
+
+            samples.push_back(take_sample(start, requests));
+
+            const auto &s = samples.back();
+            std::cerr << std::fixed << std::setprecision(1) << s.minutes << " min, "
+                      << s.requests << " requests, rss " << mb(s.rss) << " MB, heap used "
+                      << mb(s.heap_used) << " MB, heap free " << mb(s.heap_free) << " MB" << std::endl;
+        }
+
+        for (auto &thread : threads) {
+            thread.join();
+        }
+
+        if (args.has("--csv")) {
+            write_csv(args.get("--csv"), samples);
+        }
+
+        auto first = samples.begin() + static_cast<ptrdiff_t>(samples.size() * warmup_fraction);
+        std::vector<Sample> steady(first, samples.end());
+
+        if (steady.size() < 4) {
+            std::cerr << "Too few samples after warm-up to judge growth; lengthen the run or shorten --interval" << std::endl;
+
+            return 2;
+        }
+
+        double slope = rss_slope_mb_per_hour(steady);
+        double rising = rising_window_share(steady, 10);
+        bool growth = slope > max_growth && rising >= 0.8;
+        bool fragmented = MOONSHINE_HAVE_MALLINFO2 &&
+                          free_ratio(steady.back()) > max_free_ratio &&
+                          free_ratio(steady.back()) > free_ratio(steady.front());
+
+        std::cout << std::fixed << std::setprecision(2)
+                  << "requests:            " << requests.load() << '\n'
+                  << "rss:                 " << mb(steady.front().rss) << " -> " << mb(steady.back().rss) << " MB\n"
+                  << "rss slope:           " << slope << " MB/hour (limit " << max_growth << ")\n"
+                  << "rising windows:      " << rising * 100.0 << "%\n";
+
+        if (MOONSHINE_HAVE_MALLINFO2) {
+            std::cout << "heap free/arena:     " << free_ratio(steady.front()) << " -> " << free_ratio(steady.back())
+                      << " (limit " << max_free_ratio << ")\n";
+        } else {
+            std::cout << "heap statistics:     unavailable (needs glibc 2.33 mallinfo2)\n";
+        }
+
+        if (growth) {
+            std::cout << "FLAG: RSS grows steadily\n";
+        }
+
+        if (fragmented) {
+            std::cout << "FLAG: heap fragmentation, free memory is not returned to the system\n";
+        }
+
+        return growth || fragmented ? 1 : 0;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+
+        return 2;
+    }
+}
@@ -0,0 +1,220 @@
+/**
+ * @file stage_counters.cpp
+ * @brief Hardware counters for each inference stage, normalized per audio second and per token.
+ *
+ * Runs the encoder, the decoder loop and the tokenizer the same way the
+ * Transcriber does, with perf_event_open counters around each stage:
+ * encode, decoder step (the ORT run in decode_next_token), argmax, KV cache
+ * update and detokenize. The encoder is normalized per audio second, the
+ * other stages per generated token. LLC misses per thousand instructions
+ * (MPKI) together with IPC show whether a stage is memory bound.
+ *
+ * Counters cover the calling thread only, so sessions use one intra-op thread.
+ *
+ * Usage:
+ *   moonshine_stage_counters <model> <encoder.onnx> <decoder.onnx> <tok.json> <corpus> [--repeat 1]
+ */
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include "bench_common.h"
+#include "onnx_model_bench_access.h"
+#include "perf_counters.h"
+
+
+namespace {
+    using namespace MoonshineBench;
+    using Moonshine::OnnxModel;
+    using Moonshine::OnnxModelBenchAccess;
+
+    /**
+     * @struct Stage
+     * @brief Accumulated counts of one stage
+     */
+    struct Stage {
+        Stage(const char *name, const char *unit) : name(name), unit(unit) {}
+
+        const char *name;       /**< Stage name */
+        const char *unit;       /**< What the counts are normalized by */
+        size_t calls = 0;       /**< Measured regions */
+        PerfCounts counts;      /**< Accumulated counts */
+    };
+
+    enum StageIndex { Encode, DecoderStep, Argmax, KvUpdate, Detokenize };
+
+    /**
+     * @brief Transcribes one clip, counting each stage
+     * @return size_t Number of tokens generated
+     */
+    size_t run_clip(OnnxModel &model,
+                    tokenizers::Tokenizer &tokenizer,
+                    PerfCounters &counters,
+                    std::vector<Stage> &stages,
+                    std::vector<float> audio)
+    {
+        std::vector<Ort::Value> encoded;
+
+        {
+            ScopedPerfCounts scope(counters, stages[Encode].counts);
+            encoded = OnnxModelBenchAccess::run_encoder(model, audio);
+        }
+
+        stages[Encode].calls++;
+
+        auto past_key_values = OnnxModelBenchAccess::initialize_past_key_values(model);
+        std::vector<int64_t> cur_tokens{OnnxModelBenchAccess::start_token};
+        std::vector<int> tokens;
+        size_t max_tokens = std::max<size_t>(
+            1, audio.size() * OnnxModelBenchAccess::max_tokens_per_second / sample_rate);
+
+        for (size_t i = 0; i < max_tokens; i++) {
+            bool use_cache_branch = i > 0;
+            std::vector<Ort::Value> output;
+            int next_token;
+
+            {
+                ScopedPerfCounts scope(counters, stages[DecoderStep].counts);
+                output = OnnxModelBenchAccess::decode_next_token(
+                    model, cur_tokens, encoded.at(0), past_key_values, use_cache_branch);
+            }
+
+            {
+                ScopedPerfCounts scope(counters, stages[Argmax].counts);
+                next_token = OnnxModelBenchAccess::get_next_token(std::move(output.at(0)));
+            }
+
+            stages[DecoderStep].calls++;
+            stages[Argmax].calls++;
+
+            if (next_token == OnnxModelBenchAccess::end_token) {
+                break;
+            }
+
+            tokens.push_back(next_token);
+            cur_tokens.assign(1, next_token);
+
+            std::vector<Ort::Value> present_kv;
+
+            for (auto it = output.begin() + 1; it != output.end(); ++it) {
+                present_kv.emplace_back(std::move(*it));
+            }
+
+            {
+                ScopedPerfCounts scope(counters, stages[KvUpdate].counts);
+                OnnxModelBenchAccess::update_kv_cache(past_key_values, present_kv, use_cache_branch);
+            }
+
+            stages[KvUpdate].calls++;
+        }
+
+        {
+            ScopedPerfCounts scope(counters, stages[Detokenize].counts);
+            tokenizer.Decode(tokens);
+        }
+
+        stages[Detokenize].calls++;
+
+        return tokens.size();
+    }
+
+    void print_stages(const std::vector<Stage> &stages, double audio_s, size_t tokens) {
+        std::cout << std::left << std::setw(14) << "stage" << std::setw(9) << "per"
+                  << std::right << std::setw(8) << "calls" << std::setw(6) << "IPC" << std::setw(8) << "LLC_MPKI";
+
+        for (auto *name : PerfCounts::names) {
+            std::cout << std::setw(15) << name;
+        }
+
+        std::cout << '\n';
+
+        for (const auto &stage : stages) {
+            double units = std::string(stage.unit) == "audio_s" ? audio_s : static_cast<double>(std::max<size_t>(tokens, 1));
+            double instructions = stage.counts.instructions();
+            double mpki = instructions > 0.0 ? 1000.0 * stage.counts.values[3] / instructions : 0.0;
+
+            std::cout << std::left << std::setw(14) << stage.name << std::setw(9) << stage.unit
+                      << std::right << std::setw(8) << stage.calls << std::fixed
+                      << std::setprecision(2) << std::setw(6) << stage.counts.ipc()
+                      << std::setw(8) << mpki << std::setprecision(0);
+
+            for (size_t i = 0; i < PerfCounts::count; i++) {
+                if (stage.counts.valid[i]) {
+                    std::cout << std::setw(15) << stage.counts.values[i] / units;
+                } else {
+                    std::cout << std::setw(15) << "n/a";
+                }
+            }
+
+            std::cout << '\n';
+        }
+
+        std::cout << std::setprecision(2) << audio_s << " audio seconds, " << tokens << " tokens\n";
+    }
+}
+
+
+int main(int argc, char *argv[]) {
+    try {
+        Args args(argc, argv);
+
+        if (args.positional().size() != 5) {
+            std::cerr << "Usage: " << argv[0]
+                      << " <model> <encoder.onnx> <decoder.onnx> <tok.json> <corpus> [--repeat 1]" << std::endl;
+
+            return 1;
+        }
+
+        PerfCounters counters;
+
+        if (!counters.available()) {
+            std::cerr << "Hardware counters unavailable: " << counters.error() << std::endl;
+
+            return 1;
+        }
+
+        auto spec = ModelSpec::parse(args.positional());
+        auto corpus = load_corpus(args.positional()[4]);
+        auto repeat = static_cast<size_t>(std::max(1.0, args.get_number("--repeat", 1)));
+
+        auto model = spec.type == Moonshine::ModelType::Base
+            ? OnnxModel::Base(spec.encoder, spec.decoder, 1)
+            : OnnxModel::Tiny(spec.encoder, spec.decoder, 1);
+
+        std::ifstream ifs(spec.tokenizer);
+        std::stringstream blob;
+        blob << ifs.rdbuf();
+        auto tokenizer = tokenizers::Tokenizer::FromBlobJSON(blob.str());
+
+        std::vector<Stage> stages{
+            {"encode", "audio_s"},
+            {"decoder_step", "token"},
+            {"argmax", "token"},
+            {"kv_update", "token"},
+            {"detokenize", "token"},
+        };
+
+        // Untimed pass so session initialization is not counted
+        std::vector<Stage> warmup = stages;
+        run_clip(model, *tokenizer, counters, warmup, corpus.front().samples);
+
+        double audio_s = 0.0;
+        size_t tokens = 0;
+
+        for (size_t r = 0; r < repeat; r++) {
+            for (const auto &clip : corpus) {
+                tokens += run_clip(model, *tokenizer, counters, stages, clip.samples);
+                audio_s += clip.seconds();
+            }
+        }
+
+        print_stages(stages, audio_s, tokens);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,107 @@
+/**
+ * @file token_freq.cpp
+ * @brief Builds a vocabulary shortlist from the tokens a model emits on a corpus.
+ *
+ * Transcribes every clip, counts the emitted tokens and writes the top N
+ * token ids, most frequent first, for use with Moonshine::VocabShortlist.
+ * The end token is always included since every utterance emits it. The
+ * share of emitted tokens the shortlist covers is printed for a few sizes
+ * to help choose N.
+ *
+ * Usage:
+ *   moonshine_token_freq <model> <encoder.onnx> <decoder.onnx> <tok.json> <corpus> [--top 2048] [--threads 4] [--out shortlist.txt]
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include "bench_common.h"
+
+
+namespace {
+    using namespace MoonshineBench;
+    using Moonshine::VocabShortlist;
+}
+
+
+int main(int argc, char *argv[]) {
+    try {
+        Args args(argc, argv);
+
+        if (args.positional().size() != 5) {
+            std::cerr << "Usage: " << argv[0]
+                      << " <model> <encoder.onnx> <decoder.onnx> <tok.json> <corpus> [--top 2048] [--threads 4] [--out shortlist.txt]"
+                      << std::endl;
+
+            return 1;
+        }
+
+        auto spec = ModelSpec::parse(args.positional());
+        auto corpus = load_corpus(args.positional()[4]);
+        auto top = static_cast<size_t>(std::max(1.0, args.get_number("--top", 2048)));
+        auto stt = spec.make_transcriber(static_cast<int>(args.get_number("--threads", 4)));
+
+        std::map<int, size_t> counts;
+        size_t total = 0;
+
+        for (const auto &clip : corpus) {
+            auto result = stt->transcribe_detailed(clip.samples, false);
+
+            for (int token : result.tokens) {
+                counts[token]++;
+            }
+
+            total += result.tokens.size();
+        }
+
+        std::vector<std::pair<int, size_t>> ranked(counts.begin(), counts.end());
+        std::stable_sort(ranked.begin(), ranked.end(),
+                         [](const auto &a, const auto &b) { return a.second > b.second; });
+
+        std::vector<int> shortlist{VocabShortlist::end_token};
+
+        for (const auto &entry : ranked) {
+            if (shortlist.size() >= top) {
+                break;
+            }
+
+            if (entry.first != VocabShortlist::end_token) {
+                shortlist.push_back(entry.first);
+            }
+        }
+
+        std::cout << corpus.size() << " clips, " << total << " tokens, " << ranked.size() << " distinct\n";
+        std::cout << std::setw(8) << "size" << std::setw(12) << "coverage" << '\n';
+
+        size_t covered = 0;
+        size_t next_report = 64;
+
+        for (size_t i = 0; i < ranked.size(); i++) {
+            covered += ranked[i].second;
+
+            if (i + 1 == next_report || i + 1 == ranked.size()) {
+                std::cout << std::setw(8) << i + 1 << std::fixed << std::setprecision(2)
+                          << std::setw(11) << 100.0 * covered / std::max<size_t>(total, 1) << "%\n";
+                next_report *= 2;
+            }
+        }
+
+        if (args.has("--out")) {
+            std::ofstream out(args.get("--out"));
+
+            for (int token : shortlist) {
+                out << token << '\n';
+            }
+
+            std::cout << "Wrote " << shortlist.size() << " token ids to " << args.get("--out") << '\n';
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+
+        return 1;
+    }
+
+    return 0;
+}
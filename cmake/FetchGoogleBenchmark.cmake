@@ -0,0 +1,20 @@
+# Fetch Google Benchmark from GitHub
+include(FetchContent)
+
+message(STATUS "Fetching benchmark @ https://github.com/google/benchmark.git")
+
+set(FETCHCONTENT_QUIET FALSE)
+set(GoogleBenchmarkVersion "v1.8.3")
+
+set(BENCHMARK_ENABLE_TESTING OFF CACHE BOOL "" FORCE)
+set(BENCHMARK_ENABLE_GTEST_TESTS OFF CACHE BOOL "" FORCE)
+set(BENCHMARK_ENABLE_INSTALL OFF CACHE BOOL "" FORCE)
+
+FetchContent_Declare(
+    googlebenchmark
+    GIT_REPOSITORY  https://github.com/google/benchmark.git
+    GIT_TAG         ${GoogleBenchmarkVersion}
+    GIT_PROGRESS    TRUE
+)
+
+FetchContent_MakeAvailable(googlebenchmark)
@@ -7,9 +7,11 @@ std::vector<float> read_wav_file(const std::string& path);
 
 
 int main(int argc, char* argv[]) {
-    if (argc != 6) {
+    bool profile = argc == 7 && std::string(argv[6]) == "--profile";
+
+    if (argc != 6 && !profile) {
         std::cerr << "Usage: " << argv[0]
-                  << " <model> <encoder.onnx> <decoder.onnx> <tok.json> <wav_f_path>" << std::endl;
+                  << " <model> <encoder.onnx> <decoder.onnx> <tok.json> <wav_f_path> [--profile]" << std::endl;
 
         return 1;
     }
@@ -21,10 +23,20 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    auto stt = Moonshine::Transcriber(*model_type, argv[2], argv[3], argv[4]);
+    Moonshine::ModelOptions options;
+
+    if (profile) {
+        options.profiling = Moonshine::ProfilingOptions{};
+    }
+
+    auto stt = Moonshine::Transcriber(*model_type, argv[2], argv[3], argv[4], options);
 
     transcribe_all(stt, argv[5]);
 
+    if (profile) {
+        std::cerr << stt.get_profile_summary().to_string();
+    }
+
     return 0;
 }
 
@@ -17,6 +17,10 @@
 
 namespace Moonshine {
 
+class ModelRegistry;
+class TranscriptCache;
+class TrafficRecorder;
+
 /**
  * @class ModelType
  * @brief Represents the available speech recognition model types
@@ -103,13 +107,50 @@ public:
      * @param encoder_path Path to the encoder ONNX model file
      * @param decoder_path Path to the decoder ONNX model file
      * @param tokenizer_path Path to the tokenizer model (JSON) file
-     * @param num_threads Number of threads to use for inference (default: 4)
+     * @param num_threads Number of threads to use for inference, 0 to derive it from the CPU budget (default: 0)
      */
     Transcriber(const ModelType model_type,
                 const f_path &encoder_path,
                 const f_path &decoder_path,
                 const f_path &tokenizer_path,
-                const int num_threads = 4);
+                const int num_threads = 0);
+
+    /**
+     * @brief Construct a new Transcriber object with explicit session options
+     *
+     * @param model_type The type of model to use (Base or Tiny)
+     * @param encoder_path Path to the encoder ONNX model file
+     * @param decoder_path Path to the decoder ONNX model file
+     * @param tokenizer_path Path to the tokenizer model (JSON) file
+     * @param options Session configuration (threads, profiling)
+     */
+    Transcriber(const ModelType model_type,
+                const f_path &encoder_path,
+                const f_path &decoder_path,
+                const f_path &tokenizer_path,
+                const ModelOptions &options);
+
+    /**
+     * @brief Construct a new Transcriber object backed by a model registry
+     *
+     * The model files are registered but not loaded; they are loaded by the
+     * registry on first use and shared with every other Transcriber that uses
+     * identical files. Between calls to transcribe() the registry may evict
+     * the model if it is idle and over the registry's memory budget.
+     *
+     * @param registry The registry that owns the loaded model and tokenizer
+     * @param model_type The type of model to use (Base or Tiny)
+     * @param encoder_path Path to the encoder ONNX model file
+     * @param decoder_path Path to the decoder ONNX model file
+     * @param tokenizer_path Path to the tokenizer model (JSON) file
+     * @param num_threads Number of threads to use for inference, 0 to derive it from the CPU budget (default: 0)
+     */
+    Transcriber(ModelRegistry &registry,
+                const ModelType model_type,
+                const f_path &encoder_path,
+                const f_path &decoder_path,
+                const f_path &tokenizer_path,
+                const int num_threads = 0);
 
     /**
      * @brief Transcribe audio data to text
@@ -129,9 +170,100 @@ public:
      */
     std::string operator()(const std::vector<float> &audio_data) noexcept;
 
+    /**
+     * @brief Transcribe audio data and report how the transcript was produced
+     *
+     * Always runs inference, bypassing any transcript cache, since cached
+     * entries do not keep tokens or timings.
+     *
+     * @param audio_data Vector of float audio samples (assumed to be 16kHz mono)
+     * @param collect_timings Whether to measure per-stage timings (default: true)
+     * @return TranscriptionResult Text, tokens, stop reason and timings
+     */
+    TranscriptionResult transcribe_detailed(const std::vector<float> &audio_data,
+                                            bool collect_timings = true) noexcept;
+
+    /**
+     * @brief Serve repeated audio from a transcript cache
+     *
+     * The cache may be shared between Transcribers; entries are keyed by the
+     * model and tokenizer files, the model's settings that change transcripts
+     * as of each request (OnnxModel::get_output_identity(): silence
+     * compaction, shortlist, encoder buckets) and the audio, so Transcribers
+     * using different models or settings never see each other's transcripts.
+     *
+     * @param transcript_cache Cache to use, or nullptr to disable caching
+     */
+    void set_cache(std::shared_ptr<TranscriptCache> transcript_cache) noexcept;
+
+    /**
+     * @brief Log every inferred request to a traffic capture
+     *
+     * Forces per-stage timings on so they can be logged. The recorder may be
+     * shared between Transcribers. Requests answered from the transcript
+     * cache are not logged.
+     *
+     * @param traffic_recorder Recorder to use, or nullptr to stop capturing
+     */
+    void set_recorder(std::shared_ptr<TrafficRecorder> traffic_recorder) noexcept;
+
+    /**
+     * @brief Describes the Transcriber the way a TrafficRecorder logs it
+     *
+     * @return std::string Model id, tokenizer id and OnnxModel::get_config(), separated by '|'
+     * @throws std::runtime_error If a registry fails to reload an evicted model
+     */
+    std::string get_config();
+
+    /**
+     * @brief Summarizes ORT profiling of the model by operator
+     *
+     * @return ProfileSummary Operator costs of the encoder and a decoder step
+     * @throws std::runtime_error If the model was not created with profiling enabled
+     */
+    ProfileSummary get_profile_summary();
+
+    /**
+     * @brief Gets the time and memory spent constructing the Transcriber
+     *
+     * For a registry backed Transcriber this is the report of the shared
+     * model, loading it if needed, without tokenizer phases.
+     *
+     * @return StartupReport Per-phase wall time, bytes read and memory growth
+     */
+    StartupReport get_startup_report();
+
 private:
+    /**
+     * @brief Runs the model and tokenizer, bypassing the cache
+     *
+     * Failures, including reloading a model or tokenizer the registry
+     * evicted, are reported as StopReason::Error with an empty transcript.
+     *
+     * @param audio_data Vector of float audio samples (assumed to be 16kHz mono)
+     * @param collect_timings Whether to measure per-stage timings
+     * @return TranscriptionResult The transcription and its details
+     */
+    TranscriptionResult infer(const std::vector<float> &audio_data, bool collect_timings);
+
+    /**
+     * @brief Records a finished request in the process-wide metrics
+     *
+     * @param result The finished transcription
+     * @param sample_count Number of audio samples transcribed
+     */
+    static void record(const TranscriptionResult &result, size_t sample_count) noexcept;
+
     std::unique_ptr<OnnxModel> model;       /**< The ONNX model for inference */
     std::unique_ptr<tokenizers::Tokenizer> tokenizer;  /**< The tokenizer for text processing */
+
+    ModelRegistry *registry = nullptr;  /**< Registry owning the model, if not owned directly */
+    std::string model_id;               /**< Registry id, or file identity, of the model */
+    std::string tokenizer_id;           /**< Registry id, or file identity, of the tokenizer */
+
+    std::shared_ptr<TranscriptCache> cache;  /**< Optional transcript cache */
+    std::shared_ptr<TrafficRecorder> recorder;  /**< Optional traffic capture */
+    StartupReport startup;              /**< Cost of construction, empty when backed by a registry */
 };
 
 }
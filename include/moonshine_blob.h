@@ -0,0 +1,239 @@
+#ifndef MOONSHINE_BLOB_H__
+#define MOONSHINE_BLOB_H__
+
+/**
+ * @file moonshine_blob.h
+ * @brief Minimal binary writer and reader for the library's serialized formats
+ *
+ * Values are stored in host byte order, so blobs move between workers of
+ * the same architecture, not across endianness.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+
+namespace Moonshine {
+
+/**
+ * @class BlobWriter
+ * @brief Appends fixed size values, byte ranges and strings to a buffer
+ */
+class BlobWriter {
+public:
+    /**
+     * @brief Appends a trivially copyable value
+     * @param value Value to append
+     */
+    template<typename T>
+    void put(T value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be written");
+        buffer.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    /**
+     * @brief Appends raw bytes
+     *
+     * @param data Bytes to append
+     * @param size Number of bytes
+     */
+    void put_bytes(const void *data, size_t size) {
+        buffer.append(static_cast<const char *>(data), size);
+    }
+
+    /**
+     * @brief Appends a string prefixed with its 32-bit length
+     * @param str String to append
+     */
+    void put_string(const std::string &str) {
+        put<uint32_t>(static_cast<uint32_t>(str.size()));
+        buffer.append(str);
+    }
+
+    /**
+     * @brief Appends audio samples as 16-bit PCM, clipping to [-1, 1]
+     *
+     * @param samples Float samples
+     * @param count Number of samples
+     */
+    void put_pcm16(const float *samples, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            put<int16_t>(static_cast<int16_t>(std::round(std::clamp(samples[i], -1.0f, 1.0f) * 32767.0f)));
+        }
+    }
+
+    /**
+     * @brief Gets the written bytes
+     * @return std::string& The buffer, which may be moved out
+     */
+    std::string &data() noexcept { return buffer; }
+
+private:
+    std::string buffer;     /**< Written bytes */
+};
+
+/**
+ * @class BlobReader
+ * @brief Reads back what a BlobWriter wrote, checking every read against the end
+ */
+class BlobReader {
+public:
+    /**
+     * @brief Construct a new BlobReader
+     * @param blob Bytes to read, must outlive the reader
+     */
+    explicit BlobReader(const std::string &blob) noexcept : blob(blob) {}
+
+    /**
+     * @brief Reads a trivially copyable value
+     * @return T The value
+     * @throws std::runtime_error If the blob is truncated
+     */
+    template<typename T>
+    T take() {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be read");
+        T value;
+        take_bytes(&value, sizeof(value));
+
+        return value;
+    }
+
+    /**
+     * @brief Reads raw bytes
+     *
+     * @param data Receives the bytes
+     * @param size Number of bytes
+     * @throws std::runtime_error If the blob is truncated
+     */
+    void take_bytes(void *data, size_t size) {
+        if (size > blob.size() - offset) {
+            throw std::runtime_error("Blob is truncated");
+        }
+
+        std::memcpy(data, blob.data() + offset, size);
+        offset += size;
+    }
+
+    /**
+     * @brief Reads a string written by BlobWriter::put_string()
+     * @return std::string The string
+     * @throws std::runtime_error If the blob is truncated
+     */
+    std::string take_string() {
+        auto size = take<uint32_t>();
+
+        if (size > blob.size() - offset) {
+            throw std::runtime_error("Blob is truncated");
+        }
+
+        std::string str = blob.substr(offset, size);
+        offset += size;
+
+        return str;
+    }
+
+    /**
+     * @brief Reads samples written by BlobWriter::put_pcm16()
+     *
+     * @param samples Receives the samples, replacing its contents
+     * @param count Number of samples
+     * @throws std::runtime_error If the blob is truncated
+     */
+    void take_pcm16(std::vector<float> &samples, size_t count) {
+        if (count > remaining() / sizeof(int16_t)) {
+            throw std::runtime_error("Blob is truncated");
+        }
+
+        samples.resize(count);
+
+        for (auto &sample : samples) {
+            sample = take<int16_t>() / 32767.0f;
+        }
+    }
+
+    /**
+     * @brief Reads an enum stored as its underlying value
+     *
+     * @param last Last enumerator; enumerators must run from 0 to it without gaps
+     * @return E The enumerator
+     * @throws std::runtime_error If the blob is truncated or the value is past last
+     */
+    template<typename E>
+    E take_enum(E last) {
+        static_assert(std::is_enum<E>::value, "Only enums can be read with take_enum");
+        using Underlying = typename std::underlying_type<E>::type;
+        auto value = take<Underlying>();
+
+        // Negative values of a signed type wrap past last
+        if (static_cast<uint64_t>(value) > static_cast<uint64_t>(last)) {
+            throw std::runtime_error("Blob holds an invalid enum value");
+        }
+
+        return static_cast<E>(value);
+    }
+
+    /**
+     * @brief Reads a tensor shape written as a 32-bit rank and 64-bit dimensions
+     *
+     * Checks the rank, every dimension and the element count against
+     * overflow and the unread bytes before the caller allocates from them.
+     *
+     * @param element_size Bytes per element stored after the shape
+     * @param count Receives the number of elements
+     * @return std::vector<int64_t> The dimensions
+     * @throws std::runtime_error If the shape is invalid or its elements are not in the blob
+     */
+    std::vector<int64_t> take_shape(size_t element_size, size_t &count) {
+        auto rank = take<uint32_t>();
+
+        if (rank > max_rank || rank > remaining() / sizeof(int64_t)) {
+            throw std::runtime_error("Blob holds an invalid tensor rank");
+        }
+
+        std::vector<int64_t> shape(rank);
+        count = 1;
+
+        for (auto &dim : shape) {
+            dim = take<int64_t>();
+
+            if (dim < 0) {
+                throw std::runtime_error("Blob holds a negative tensor dimension");
+            }
+
+            if (count != 0 && static_cast<uint64_t>(dim) > std::numeric_limits<size_t>::max() / count) {
+                throw std::runtime_error("Blob holds a tensor too large to address");
+            }
+
+            count *= static_cast<size_t>(dim);
+        }
+
+        if (count > remaining() / element_size) {
+            throw std::runtime_error("Blob is truncated");
+        }
+
+        return shape;
+    }
+
+    static constexpr uint32_t max_rank = 8;     /**< Highest tensor rank take_shape() accepts */
+
+    /**
+     * @brief Gets the number of unread bytes
+     * @return size_t Remaining bytes
+     */
+    size_t remaining() const noexcept { return blob.size() - offset; }
+
+private:
+    const std::string &blob;    /**< Bytes being read */
+    size_t offset = 0;          /**< Read position */
+};
+
+}
+
+#endif
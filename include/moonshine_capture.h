@@ -0,0 +1,145 @@
+#ifndef MOONSHINE_CAPTURE_H__
+#define MOONSHINE_CAPTURE_H__
+
+/**
+ * @file moonshine_capture.h
+ * @brief Opt-in capture of transcription traffic to a compact binary log for offline replay
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "moonshine_onnx_model.h"
+
+
+namespace Moonshine {
+
+/**
+ * @struct CaptureOptions
+ * @brief Where and how much traffic a TrafficRecorder keeps
+ */
+struct CaptureOptions {
+    f_path path;                        /**< Log file, truncated on open */
+    double audio_fraction = 1.0;        /**< Share of requests whose samples are stored, in [0, 1] */
+    uint64_t max_bytes = 1ull << 30;    /**< Recording stops once the log reaches this size */
+};
+
+/**
+ * @struct CapturedRequest
+ * @brief One request read back from a capture log
+ */
+struct CapturedRequest {
+    uint64_t arrival_ns = 0;        /**< Arrival time since the recorder was created */
+    uint64_t audio_hash = 0;        /**< hash_samples() of the audio */
+    uint32_t sample_count = 0;      /**< Number of audio samples */
+    std::string config;             /**< Model and tokenizer identity and OnnxModel::get_config() of the Transcriber */
+    StopReason stop_reason = StopReason::EndToken;  /**< Why decoding stopped */
+    uint32_t token_count = 0;       /**< Tokens generated */
+    uint32_t decode_steps = 0;      /**< Decoder steps run */
+    float input_prep_ms = 0.0f;     /**< Input preparation wall time, including silence compaction */
+    float encode_ms = 0.0f;         /**< Encoder wall time */
+    float decode_ms = 0.0f;         /**< Decoder loop wall time */
+    float detokenize_ms = 0.0f;     /**< Tokenizer wall time */
+    float total_ms = 0.0f;          /**< Request wall time */
+    std::vector<float> samples;     /**< Audio, empty when it was not sampled */
+};
+
+/**
+ * @class TrafficRecorder
+ * @brief Appends each transcription request to a binary capture log
+ *
+ * Every request is logged with its arrival time, audio hash, configuration
+ * and per-stage timings. The audio itself, stored as 16-bit PCM, is kept for
+ * a deterministic subset of requests chosen by audio hash, so the same clip
+ * is either always or never stored. Attach one recorder to any number of
+ * Transcribers with Transcriber::set_recorder(); writes are serialized.
+ * Requests served from a transcript cache do not run inference and are not
+ * logged.
+ */
+class TrafficRecorder {
+public:
+    /**
+     * @brief Opens the capture log
+     *
+     * @param options Log path and sampling
+     * @throws std::runtime_error If the log cannot be created
+     */
+    explicit TrafficRecorder(CaptureOptions options);
+
+    /**
+     * @brief Gets the time used for arrival stamps
+     * @return uint64_t Nanoseconds since the recorder was created
+     */
+    uint64_t now_ns() const noexcept {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - epoch).count());
+    }
+
+    /**
+     * @brief Logs a finished request
+     *
+     * @param arrival_ns Arrival time from now_ns()
+     * @param audio_data Audio samples of the request
+     * @param config Model and tokenizer identity and effective model configuration
+     * @param result The finished transcription
+     */
+    void record(uint64_t arrival_ns,
+                const std::vector<float> &audio_data,
+                const std::string &config,
+                const TranscriptionResult &result) noexcept;
+
+    /**
+     * @brief Gets the number of requests logged
+     * @return uint64_t Logged requests
+     */
+    uint64_t get_recorded() const;
+
+    /**
+     * @brief Gets the size of the log
+     * @return uint64_t Bytes written, including the header
+     */
+    uint64_t get_bytes_written() const;
+
+private:
+    CaptureOptions options;                         /**< Log path and sampling */
+    std::chrono::steady_clock::time_point epoch;    /**< Zero of arrival time */
+
+    mutable std::mutex mutex;   /**< Serializes writes */
+    std::ofstream out;          /**< Open log */
+    uint64_t recorded = 0;      /**< Requests logged */
+    uint64_t bytes = 0;         /**< Bytes written */
+};
+
+/**
+ * @class CaptureReader
+ * @brief Reads requests back from a capture log in the order they were logged
+ */
+class CaptureReader {
+public:
+    /**
+     * @brief Opens a capture log
+     *
+     * @param path Log written by a TrafficRecorder
+     * @throws std::runtime_error If the file is missing or not a capture log
+     */
+    explicit CaptureReader(const f_path &path);
+
+    /**
+     * @brief Reads the next request
+     *
+     * @param request Receives the request
+     * @return bool False at the end of the log
+     * @throws std::runtime_error If the log is truncated mid-record
+     */
+    bool next(CapturedRequest &request);
+
+private:
+    std::ifstream in;   /**< Open log */
+};
+
+}
+
+#endif
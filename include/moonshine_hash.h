@@ -0,0 +1,55 @@
+#ifndef MOONSHINE_HASH_H__
+#define MOONSHINE_HASH_H__
+
+/**
+ * @file moonshine_hash.h
+ * @brief Fast non-cryptographic hashing of audio buffers
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace Moonshine {
+
+/**
+ * @brief Hashes a block of memory
+ *
+ * Uses 8 independent 64-bit lanes with 32x32->64 bit multiplies per 64 byte
+ * stripe, scrambled every 1KiB, in the style of XXH3. The SSE2 path and the
+ * portable path produce identical results, so hashes may be persisted.
+ *
+ * @param data Pointer to the bytes to hash
+ * @param size Number of bytes to hash
+ * @param seed Seed mixed into the result (default: 0)
+ * @return uint64_t The hash value
+ */
+uint64_t hash_bytes(const void *data, size_t size, uint64_t seed = 0) noexcept;
+
+/**
+ * @brief Hashes a buffer of audio samples
+ *
+ * @param audio_data Vector of float audio samples
+ * @param seed Seed mixed into the result (default: 0)
+ * @return uint64_t The hash value
+ */
+inline uint64_t hash_samples(const std::vector<float> &audio_data, uint64_t seed = 0) noexcept {
+    return hash_bytes(audio_data.data(), audio_data.size() * sizeof(float), seed);
+}
+
+/**
+ * @brief Hashes a string
+ *
+ * @param str String to hash
+ * @param seed Seed mixed into the result (default: 0)
+ * @return uint64_t The hash value
+ */
+inline uint64_t hash_string(const std::string &str, uint64_t seed = 0) noexcept {
+    return hash_bytes(str.data(), str.size(), seed);
+}
+
+}
+
+#endif
@@ -0,0 +1,173 @@
+#ifndef MOONSHINE_MEMORY_H__
+#define MOONSHINE_MEMORY_H__
+
+/**
+ * @file moonshine_memory.h
+ * @brief Tracking allocators that attribute ORT and host memory to the request being served
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "onnxruntime_cxx_api.h"
+
+
+namespace Moonshine {
+
+/**
+ * @class MemoryScope
+ * @brief Collects the tracked allocations made by one thread while it is alive
+ *
+ * Constructing a scope makes it the calling thread's current scope until it
+ * is destroyed. Tracked allocations made by that thread are charged to it,
+ * and freeing them again on the same thread while the scope is current
+ * credits it back. Blocks freed elsewhere, or after the scope ended, are
+ * not credited. Scopes are not thread safe and must not outlive the thread.
+ */
+class MemoryScope {
+public:
+    MemoryScope() noexcept;
+    ~MemoryScope();
+
+    MemoryScope(const MemoryScope &) = delete;
+    MemoryScope &operator=(const MemoryScope &) = delete;
+
+    /**
+     * @brief Gets the calling thread's current scope
+     * @return MemoryScope* The scope, or nullptr outside any scope
+     */
+    static MemoryScope *current() noexcept;
+
+    /**
+     * @brief Gets the bytes charged and not yet released
+     * @return size_t Live bytes
+     */
+    size_t get_live_bytes() const noexcept { return live; }
+
+    /**
+     * @brief Gets the highest live size since construction or reset_peak()
+     * @return size_t Peak bytes
+     */
+    size_t get_peak_bytes() const noexcept { return peak; }
+
+    /**
+     * @brief Gets the highest live size since construction
+     * @return size_t Peak bytes, unaffected by reset_peak()
+     */
+    size_t get_max_bytes() const noexcept { return max; }
+
+    /**
+     * @brief Gets the highest live size of host containers using TrackingAllocator
+     * @return size_t Peak host bytes since construction
+     */
+    size_t get_host_peak_bytes() const noexcept { return host_peak; }
+
+    /**
+     * @brief Restarts get_peak_bytes() from the current live size
+     */
+    void reset_peak() noexcept { peak = live; }
+
+    /**
+     * @brief Gets the identity tracked blocks are tagged with
+     * @return uint64_t Process-unique, non-zero id
+     */
+    uint64_t get_id() const noexcept { return id; }
+
+    /**
+     * @brief Charges an allocation
+     *
+     * @param bytes Size of the allocation
+     * @param host Whether it is a host container rather than an ORT buffer
+     */
+    void charge(size_t bytes, bool host) noexcept;
+
+    /**
+     * @brief Credits a freed allocation
+     *
+     * @param bytes Size of the allocation
+     * @param host Whether it is a host container rather than an ORT buffer
+     */
+    void release(size_t bytes, bool host) noexcept;
+
+private:
+    uint64_t id;                /**< Tag of blocks charged here */
+    MemoryScope *previous;      /**< Scope current before this one */
+    size_t live = 0;            /**< Live bytes */
+    size_t peak = 0;            /**< Peak since reset_peak() */
+    size_t max = 0;             /**< Peak since construction */
+    size_t host_live = 0;       /**< Live host container bytes */
+    size_t host_peak = 0;       /**< Peak host container bytes */
+};
+
+/**
+ * @class TrackingAllocator
+ * @brief Standard allocator charging the current MemoryScope
+ *
+ * Meant for short-lived buffers that are allocated and freed within the
+ * same scope, such as scratch copies made during inference.
+ *
+ * @tparam T Element type
+ */
+template<typename T>
+class TrackingAllocator {
+public:
+    using value_type = T;
+
+    TrackingAllocator() noexcept = default;
+
+    template<typename U>
+    TrackingAllocator(const TrackingAllocator<U> &) noexcept {}
+
+    T *allocate(size_t n) {
+        T *p = std::allocator<T>().allocate(n);
+
+        if (auto *scope = MemoryScope::current()) {
+            scope->charge(n * sizeof(T), true);
+        }
+
+        return p;
+    }
+
+    void deallocate(T *p, size_t n) noexcept {
+        if (auto *scope = MemoryScope::current()) {
+            scope->release(n * sizeof(T), true);
+        }
+
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    template<typename U>
+    bool operator==(const TrackingAllocator<U> &) const noexcept { return true; }
+
+    template<typename U>
+    bool operator!=(const TrackingAllocator<U> &) const noexcept { return false; }
+};
+
+/**
+ * @brief Registers the tracking CPU allocator with an ORT environment
+ *
+ * Sessions created with the "session.use_env_allocators" config entry then
+ * allocate weights, activations and outputs through it, and allocations
+ * made while a MemoryScope is current are charged to that scope. The ORT
+ * environment is shared process-wide, so registering again is a no-op.
+ *
+ * @param env Environment the sessions are created in
+ * @throws Ort::Exception If ORT rejects the allocator
+ */
+void register_tracking_allocator(Ort::Env &env);
+
+/**
+ * @brief Gets the bytes currently allocated through the tracking allocator
+ * @return size_t Live bytes across all sessions and threads, including weights
+ */
+size_t get_tracked_live_bytes() noexcept;
+
+/**
+ * @brief Gets the most bytes ever allocated at once through the tracking allocator
+ * @return size_t Peak bytes across all sessions and threads, including weights
+ */
+size_t get_tracked_peak_bytes() noexcept;
+
+}
+
+#endif
@@ -0,0 +1,233 @@
+#ifndef MOONSHINE_METRICS_H__
+#define MOONSHINE_METRICS_H__
+
+/**
+ * @file moonshine_metrics.h
+ * @brief Low overhead counters and latency histograms with a Prometheus text exporter
+ */
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace Moonshine {
+
+/**
+ * @brief Number of per-thread shards used by counters and histograms
+ */
+constexpr size_t metric_shards = 16;
+
+/**
+ * @brief Gets the shard used by the calling thread
+ * @return size_t Shard index in [0, metric_shards)
+ */
+size_t metric_shard_index() noexcept;
+
+/**
+ * @class Counter
+ * @brief Monotonic counter sharded across threads to avoid cache line contention
+ */
+class Counter {
+public:
+    /**
+     * @brief Adds to the counter
+     * @param value Amount to add (default: 1)
+     */
+    void add(uint64_t value = 1) noexcept {
+        shards[metric_shard_index()].value.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Gets the sum over all shards
+     * @return uint64_t Current value
+     */
+    uint64_t value() const noexcept;
+
+    /**
+     * @brief Sets the counter back to zero
+     */
+    void reset() noexcept;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+
+    std::array<Shard, metric_shards> shards;    /**< Per-thread partial sums */
+};
+
+/**
+ * @class Gauge
+ * @brief Value that can go up and down, e.g. in-flight requests
+ */
+class Gauge {
+public:
+    /**
+     * @brief Increases the gauge
+     * @param value Amount to add
+     */
+    void add(int64_t value) noexcept { current.fetch_add(value, std::memory_order_relaxed); }
+
+    /**
+     * @brief Decreases the gauge
+     * @param value Amount to subtract
+     */
+    void sub(int64_t value) noexcept { current.fetch_sub(value, std::memory_order_relaxed); }
+
+    /**
+     * @brief Gets the current value
+     * @return int64_t Current value
+     */
+    int64_t value() const noexcept { return current.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Sets the gauge back to zero
+     */
+    void reset() noexcept { current.store(0, std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> current{0};    /**< Current value */
+};
+
+/**
+ * @struct HistogramSnapshot
+ * @brief Point in time copy of a histogram
+ */
+struct HistogramSnapshot {
+    std::vector<double> bounds;     /**< Inclusive upper bound of each bucket */
+    std::vector<uint64_t> counts;   /**< Per bucket counts, with one extra overflow bucket */
+    double sum = 0.0;               /**< Sum of observed values */
+    uint64_t count = 0;             /**< Number of observed values */
+
+    /**
+     * @brief Estimates a quantile by linear interpolation within buckets
+     * @param q Quantile in [0, 1]
+     * @return double Estimated value, or 0 if empty
+     */
+    double quantile(double q) const noexcept;
+};
+
+/**
+ * @class Histogram
+ * @brief Fixed bucket histogram sharded across threads
+ */
+class Histogram {
+public:
+    /**
+     * @brief Construct a new Histogram
+     * @param bounds Ascending inclusive upper bounds of the buckets
+     */
+    explicit Histogram(std::vector<double> bounds);
+
+    /**
+     * @brief Records a value
+     * @param value Observed value
+     */
+    void observe(double value) noexcept;
+
+    /**
+     * @brief Gets a copy of the current counts
+     * @return HistogramSnapshot Summed over all shards
+     */
+    HistogramSnapshot snapshot() const;
+
+    /**
+     * @brief Clears all buckets
+     */
+    void reset() noexcept;
+
+    /**
+     * @brief Gets exponentially spaced bucket bounds
+     *
+     * @param start First bound
+     * @param factor Ratio between consecutive bounds
+     * @param count Number of bounds
+     * @return std::vector<double> The bounds
+     */
+    static std::vector<double> exponential_bounds(double start, double factor, size_t count);
+
+private:
+    struct alignas(64) Shard {
+        std::vector<std::atomic<uint64_t>> counts;  /**< Per bucket counts plus overflow */
+        std::atomic<uint64_t> sum_bits{0};          /**< Bit pattern of the double sum */
+        std::atomic<uint64_t> count{0};             /**< Number of observations */
+    };
+
+    std::vector<double> bounds;                 /**< Bucket upper bounds */
+    std::array<Shard, metric_shards> shards;    /**< Per-thread partial histograms */
+};
+
+/**
+ * @class Metrics
+ * @brief Process-wide inference metrics
+ *
+ * Recording is disabled by default. When enabled, every Transcriber feeds
+ * request, encoder and decoder measurements in here; this forces per-stage
+ * timing on for each request, which costs a few clock reads per decoder step.
+ * The library has no request queue of its own, so queue_wait is only fed by
+ * callers that queue requests before transcribing. Latency metrics read the
+ * stage timings, so they stay empty when built with MOONSHINE_ENABLE_TIMINGS=OFF.
+ */
+class Metrics {
+public:
+    /**
+     * @brief Gets the process-wide metrics
+     * @return Metrics& The shared instance
+     */
+    static Metrics &instance();
+
+    /**
+     * @brief Enables or disables recording by the library
+     * @param enable Whether Transcribers record metrics
+     */
+    void set_enabled(bool enable) noexcept { enabled.store(enable, std::memory_order_relaxed); }
+
+    /**
+     * @brief Checks whether recording is enabled
+     * @return bool True if enabled
+     */
+    bool is_enabled() const noexcept { return enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Renders all metrics in the Prometheus text exposition format
+     * @return std::string The rendered metrics
+     */
+    std::string render_prometheus() const;
+
+    /**
+     * @brief Resets every counter and histogram to zero
+     *
+     * The in_flight gauge is left alone: it tracks requests still running,
+     * which would decrement it below zero when they finish.
+     */
+    void reset() noexcept;
+
+    Counter requests;                   /**< Completed requests */
+    Counter failed_requests;            /**< Requests where inference failed */
+    Counter audio_milliseconds;         /**< Milliseconds of audio transcribed */
+    Counter tokens;                     /**< Tokens generated */
+    Gauge in_flight;                    /**< Requests currently being transcribed */
+    Histogram request_latency;          /**< Request wall time in seconds */
+    Histogram real_time_factor;         /**< Request wall time divided by audio duration */
+    Histogram encoder_latency_per_audio_second;  /**< Encoder seconds per second of audio */
+    Histogram decoder_step_latency;     /**< Single decoder step in seconds */
+    Histogram tokens_per_request;       /**< Tokens generated per request */
+    Histogram queue_wait;               /**< Seconds spent queued before transcription */
+    Histogram request_peak_memory;      /**< Peak bytes allocated by a request, from models tracking memory */
+    Histogram kv_cache_memory;          /**< Largest KV cache of a request in bytes, from models tracking memory */
+    Counter spin_runs;                  /**< Session runs routed to spinning sessions by adaptive spin */
+    Counter spin_switches;              /**< Times adaptive spin switched between spinning and blocking sessions */
+    Counter spin_idle_cpu_microseconds; /**< CPU time of the spinning sessions' intra-op workers while they had no run in flight */
+
+private:
+    Metrics();
+
+    std::atomic<bool> enabled{false};   /**< Whether the library records */
+};
+
+}
+
+#endif
@@ -0,0 +1,205 @@
+#ifndef MOONSHINE_MODEL_REGISTRY_H__
+#define MOONSHINE_MODEL_REGISTRY_H__
+
+/**
+ * @file moonshine_model_registry.h
+ * @brief Process-wide registry of lazily loaded, shared models and tokenizers
+ */
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "moonshine.h"
+
+
+namespace Moonshine {
+
+/**
+ * @class SharedTokenizer
+ * @brief A tokenizer that may be used by several Transcriber handles at once
+ *
+ * tokenizers-cpp keeps the result of the last decode inside the tokenizer
+ * handle, so concurrent calls must be serialized.
+ */
+class SharedTokenizer {
+public:
+    /**
+     * @brief Construct a new SharedTokenizer from a tokenizer JSON blob
+     * @param json_blob Contents of the tokenizer JSON file
+     */
+    explicit SharedTokenizer(const std::string &json_blob);
+
+    /**
+     * @brief Decode token ids into text
+     * @param tokens Token ids produced by the model
+     * @return std::string The decoded text
+     */
+    std::string decode(const std::vector<int> &tokens);
+
+private:
+    std::unique_ptr<tokenizers::Tokenizer> tokenizer;  /**< The wrapped tokenizer */
+    std::mutex decode_mutex;                           /**< Serializes calls to Decode */
+};
+
+/**
+ * @class ModelRegistry
+ * @brief Loads models and tokenizers on first use and shares them between Transcribers
+ *
+ * Files are identified by a fingerprint of their content, so the same encoder,
+ * decoder or tokenizer registered from different paths is only loaded once.
+ * Loaded entries are kept in least-recently-used order; when the estimated
+ * resident size exceeds the memory budget, idle entries (those not currently
+ * held by any caller) are evicted, oldest first. Evicted entries are reloaded
+ * transparently on their next use.
+ */
+class ModelRegistry {
+public:
+    /**
+     * @brief Construct an empty registry with an unlimited memory budget
+     */
+    ModelRegistry() = default;
+
+    ModelRegistry(const ModelRegistry &) = delete;
+    ModelRegistry &operator=(const ModelRegistry &) = delete;
+
+    /**
+     * @brief Gets the process-wide registry
+     * @return ModelRegistry& The shared registry instance
+     */
+    static ModelRegistry &instance();
+
+    /**
+     * @brief Registers an encoder/decoder pair without loading it
+     *
+     * @param model_type The type of model (Base or Tiny)
+     * @param encoder_path Path to the encoder ONNX model file
+     * @param decoder_path Path to the decoder ONNX model file
+     * @param num_threads Number of threads to use for inference
+     * @return std::string Identifier used to acquire the model
+     */
+    std::string register_model(const ModelType model_type,
+                               const f_path &encoder_path,
+                               const f_path &decoder_path,
+                               const int num_threads);
+
+    /**
+     * @brief Registers a tokenizer JSON file without loading it
+     *
+     * @param tokenizer_path Path to the tokenizer model (JSON) file
+     * @return std::string Identifier used to acquire the tokenizer
+     */
+    std::string register_tokenizer(const f_path &tokenizer_path);
+
+    /**
+     * @brief Gets a registered model, loading it if it is not resident
+     *
+     * The model is considered in use (and will not be evicted) for as long as
+     * the returned pointer, or a copy of it, is alive.
+     *
+     * @param model_id Identifier returned by register_model()
+     * @return std::shared_ptr<OnnxModel> The loaded model
+     */
+    std::shared_ptr<OnnxModel> acquire_model(const std::string &model_id);
+
+    /**
+     * @brief Gets a registered tokenizer, loading it if it is not resident
+     *
+     * @param tokenizer_id Identifier returned by register_tokenizer()
+     * @return std::shared_ptr<SharedTokenizer> The loaded tokenizer
+     */
+    std::shared_ptr<SharedTokenizer> acquire_tokenizer(const std::string &tokenizer_id);
+
+    /**
+     * @brief Sets the memory budget and evicts idle entries to honour it
+     * @param bytes Estimated resident bytes allowed across all entries
+     */
+    void set_memory_budget(size_t bytes);
+
+    /**
+     * @brief Gets the current memory budget
+     * @return size_t Budget in bytes
+     */
+    size_t get_memory_budget() const;
+
+    /**
+     * @brief Gets the estimated size of all resident entries
+     * @return size_t Resident size in bytes
+     */
+    size_t get_resident_bytes() const;
+
+    /**
+     * @brief Evicts idle entries, oldest first, until within the memory budget
+     * @return size_t Number of entries evicted
+     */
+    size_t trim();
+
+    /**
+     * @brief Evicts every idle entry regardless of the memory budget
+     * @return size_t Number of entries evicted
+     */
+    size_t evict_idle();
+
+private:
+    /**
+     * @struct Entry
+     * @brief A registered model or tokenizer and its residency state
+     */
+    struct Entry {
+        std::function<std::shared_ptr<void>()> load;  /**< Loads the entry from disk */
+        size_t footprint = 0;                         /**< Estimated resident size in bytes */
+        std::shared_ptr<void> resident;               /**< Loaded value, null when evicted */
+        std::list<std::string>::iterator lru_pos;     /**< Position in lru, valid when resident */
+        std::shared_ptr<std::mutex> load_mutex = std::make_shared<std::mutex>();  /**< Serializes loading */
+    };
+
+    /**
+     * @struct Fingerprint
+     * @brief Cached content fingerprint of a file
+     */
+    struct Fingerprint {
+        uintmax_t size;                             /**< File size when hashed */
+        std::filesystem::file_time_type mtime;      /**< Modification time when hashed */
+        uint64_t hash;                              /**< Content hash */
+    };
+
+    /**
+     * @brief Gets the content fingerprint of a file, hashing it if needed
+     * @param path File to fingerprint
+     * @return std::string Hex encoded content hash
+     */
+    std::string fingerprint(const f_path &path);
+
+    /**
+     * @brief Adds an entry if no entry with the same id exists
+     */
+    void add_entry(const std::string &id, size_t footprint,
+                   std::function<std::shared_ptr<void>()> load);
+
+    /**
+     * @brief Gets an entry, loading it if it is not resident
+     */
+    std::shared_ptr<void> acquire(const std::string &id);
+
+    /**
+     * @brief Evicts idle entries until resident bytes are within limit
+     * @note Caller must hold mutex
+     */
+    size_t evict_until(size_t limit, const std::string &keep = {});
+
+    mutable std::mutex mutex;                                   /**< Guards all members below */
+    std::unordered_map<std::string, Entry> entries;             /**< Registered entries by id */
+    std::unordered_map<std::string, Fingerprint> fingerprints;  /**< Fingerprints by canonical path */
+    std::list<std::string> lru;                                 /**< Resident ids, most recent first */
+    size_t memory_budget = std::numeric_limits<size_t>::max();  /**< Allowed resident bytes */
+    size_t resident_bytes = 0;                                  /**< Current resident bytes */
+};
+
+}
+
+#endif
@@ -7,8 +7,17 @@
  */
 
 #include <filesystem>
+#include <memory>
 #include <optional>
+#include <string>
+#include <utility>
+#include <vector>
 #include "onnxruntime_cxx_api.h"
+#include "moonshine_profiling.h"
+#include "moonshine_resources.h"
+#include "moonshine_result.h"
+#include "moonshine_silence.h"
+#include "moonshine_startup.h"
 
 
 namespace {
@@ -35,6 +44,222 @@ namespace Moonshine {
 
 using f_path = std::filesystem::path;
 
+/**
+ * @class EncodedAudio
+ * @brief Encoder output for one audio clip, reusable across decode passes
+ *
+ * Stored either as float or, to halve the memory held by the encoder cache,
+ * as IEEE half precision which is widened again for each decode.
+ */
+class EncodedAudio {
+public:
+    /**
+     * @brief Gets the number of audio samples that were encoded
+     * @return size_t Sample count of the source audio
+     */
+    size_t get_sample_count() const noexcept { return sample_count; }
+
+    /**
+     * @brief Gets the memory used to store the hidden state
+     * @return size_t Size in bytes
+     */
+    size_t get_size_bytes() const noexcept {
+        return data.size() * sizeof(float) + half_data.size() * sizeof(uint16_t);
+    }
+
+    /**
+     * @brief Checks whether the hidden state is stored as half precision
+     * @return bool True if stored as fp16
+     */
+    bool is_half_precision() const noexcept { return !half_data.empty(); }
+
+private:
+    friend class OnnxModel;
+
+    std::vector<int64_t> shape;         /**< Shape of last_hidden_state */
+    std::vector<float> data;            /**< Hidden state when stored as fp32 */
+    std::vector<uint16_t> half_data;    /**< Hidden state when stored as fp16 */
+    size_t sample_count = 0;            /**< Number of audio samples encoded */
+};
+
+/**
+ * @brief Shared, immutable handle to an encoder output
+ */
+using EncodedAudioHandle = std::shared_ptr<const EncodedAudio>;
+
+/**
+ * @class DecoderState
+ * @brief A decode in progress that can be advanced in slices, saved and restored
+ *
+ * Holds the encoder output, the KV cache and the tokens generated so far.
+ * A serialized state can be restored and continued by any OnnxModel loaded
+ * from the same model files, so a long decode can be preempted, or an idle
+ * stream's decoder evicted, without rerunning any step.
+ */
+class DecoderState {
+public:
+    /**
+     * @brief Checks whether decoding has stopped
+     * @return bool True once the end token was emitted or the budget ran out
+     */
+    bool is_finished() const noexcept { return finished; }
+
+    /**
+     * @brief Gets the tokens generated so far
+     * @return const std::vector<int>& Token ids, excluding the end token
+     */
+    const std::vector<int> &get_tokens() const noexcept { return tokens; }
+
+    /**
+     * @brief Gets why decoding stopped
+     * @return StopReason Only meaningful once finished
+     */
+    StopReason get_stop_reason() const noexcept { return stop_reason; }
+
+    /**
+     * @brief Gets the number of decoder steps run so far
+     * @return size_t Decoder steps
+     */
+    size_t get_steps() const noexcept { return steps; }
+
+    /**
+     * @brief Gets the memory held by the encoder output and KV cache
+     * @return size_t Size in bytes
+     */
+    size_t get_tensor_bytes() const;
+
+    /**
+     * @brief Serializes the state
+     *
+     * @param half_precision Store the encoder output and KV cache as fp16,
+     *                       halving the blob at a small cost in accuracy (default: false)
+     * @return std::string The blob
+     */
+    std::string serialize(bool half_precision = false) const;
+
+    /**
+     * @brief Restores a state from serialize()
+     *
+     * @param blob The blob
+     * @return DecoderState The restored state
+     * @throws std::runtime_error If the blob is not a decoder state
+     */
+    static DecoderState deserialize(const std::string &blob);
+
+    DecoderState(DecoderState &&) noexcept;
+    DecoderState &operator=(DecoderState &&) noexcept;
+    ~DecoderState();
+
+private:
+    friend class OnnxModel;
+
+    DecoderState();
+
+    std::vector<Ort::Value> encoder_output;     /**< last_hidden_state first; any later entries own the buffer it views */
+    std::vector<Ort::Value> past_key_values;    /**< KV cache as maintained by update_kv_cache() */
+    std::vector<int> tokens;                    /**< Tokens generated so far */
+    int64_t next_input = 1;                     /**< Decoder input of the next step, the start token at first */
+    size_t max_len = 0;                         /**< Token budget */
+    size_t steps = 0;                           /**< Decoder steps run */
+    bool finished = false;                      /**< Whether decoding has stopped */
+    StopReason stop_reason = StopReason::TokenBudget;  /**< Why decoding stopped */
+};
+
+/**
+ * @struct DecodeOptions
+ * @brief Per-call decoding parameters
+ */
+struct DecodeOptions {
+    std::optional<size_t> max_tokens;   /**< Token budget; derived from audio duration when unset */
+    double max_tokens_per_second = 6;   /**< Tokens per second of audio used to derive the budget */
+};
+
+/**
+ * @struct VocabShortlist
+ * @brief A decoder export whose output projection only covers frequent tokens
+ *
+ * The shortlisted decoder is the regular decoder exported with its final
+ * vocabulary projection restricted to token_ids, in that order, so its
+ * logits output has token_ids.size() entries. Input and output names must
+ * match the full decoder; the KV cache outputs are identical.
+ */
+struct VocabShortlist {
+    f_path decoder_path;            /**< Shortlisted decoder ONNX file */
+    std::vector<int> token_ids;     /**< Token id of each shortlisted logit, must include end_token */
+    float min_logit = 0.0f;         /**< Steps whose best shortlisted logit is lower rerun on the full decoder */
+
+    static constexpr int end_token = 2;     /**< Token ID representing sequence end */
+
+    /**
+     * @brief Checks that the shortlist can end a decode
+     *
+     * Without end_token every shortlisted step would either fall back to the
+     * full decoder at the end of the utterance or run to the token budget.
+     *
+     * @throws std::runtime_error If token_ids is empty or lacks end_token
+     */
+    void validate() const;
+
+    /**
+     * @brief Maps the best logit of a shortlisted step to a token
+     *
+     * @param index Index of the logit in the shortlisted decoder's output
+     * @param logit Its value
+     * @return std::optional<int> The token id, or std::nullopt if the logit is
+     *                            below min_logit and the step must be rerun on the full decoder
+     * @throws std::out_of_range If index is not below token_ids.size()
+     */
+    std::optional<int> select(size_t index, float logit) const;
+
+    /**
+     * @brief Reads the token ids from a file
+     *
+     * @param decoder_path Shortlisted decoder ONNX file
+     * @param token_list_path Whitespace separated token ids in logit order
+     * @param min_logit Fallback threshold (default: 0)
+     * @return VocabShortlist The shortlist
+     * @throws std::runtime_error If the token list cannot be read or fails validate()
+     */
+    static VocabShortlist from_files(const f_path &decoder_path,
+                                     const f_path &token_list_path,
+                                     float min_logit = 0.0f);
+};
+
+/**
+ * @struct AdaptiveSpin
+ * @brief When an OnnxModel routes runs to its spinning sessions
+ *
+ * Spinning intra-op workers pick up the next parallel section without a
+ * wake-up, which shortens decoder steps, but keep burning CPU after every
+ * run. Runs go to the spinning sessions once the recent request rate reaches
+ * spin_above_rps and back to the blocking ones when it falls below
+ * idle_below_rps. The rate counts OnnxModel::note_request() calls, which
+ * Transcriber makes once per transcription; code running the model directly
+ * makes them itself.
+ */
+struct AdaptiveSpin {
+    double spin_above_rps = 2.0;    /**< Request rate at which runs switch to the spinning sessions */
+    double idle_below_rps = 1.0;    /**< Request rate below which runs switch back */
+    double window_s = 5.0;          /**< Time constant of the decaying request rate */
+};
+
+/**
+ * @struct ModelOptions
+ * @brief Session configuration for an OnnxModel
+ */
+struct ModelOptions {
+    int num_threads = 0;                        /**< Intra-op threads per session, 0 for ResourceLimits::get_default_threads() */
+    std::optional<ProfilingOptions> profiling;  /**< ORT session profiling, disabled when unset */
+    bool cpu_mem_arena = false;                 /**< Use ORT's CPU arena instead of returning memory to the system */
+    bool track_memory = false;                  /**< Allocate through the tracking allocator and fill TranscriptionResult::memory */
+    std::optional<SilenceCompaction> silence_compaction{};  /**< Shorten long pauses before encoding, disabled when unset */
+    std::optional<VocabShortlist> shortlist{};  /**< Decode with a shortlisted vocabulary, disabled when unset */
+    std::optional<AdaptiveSpin> adaptive_spin{};  /**< Keep spinning and blocking sessions and pick by load; otherwise ORT's default spinning */
+    std::vector<size_t> encoder_buckets{};      /**< Passed to set_encoder_buckets() once created, disabled when empty */
+    bool split_startup = false;                 /**< Measure session load, optimization and prepacking separately, approximately and with a warm page cache; builds each session four times */
+    bool log_startup = false;                   /**< Write the Transcriber's StartupReport to std::clog once constructed */
+};
+
 /**
  * @class OnnxModel
  * @brief Encapsulates the speech recognition model using ONNX Runtime
@@ -50,24 +275,48 @@ public:
      *
      * @param encoder_path Path to the encoder ONNX model file
      * @param decoder_path Path to the decoder ONNX model file
-     * @param num_threads Number of threads to use for inference (default: 4)
+     * @param num_threads Number of threads to use for inference, 0 to derive it from the CPU budget (default: 0)
+     * @return OnnxModel Configured Base model instance
+     */
+    static OnnxModel Base(const f_path &encoder_path,
+                          const f_path &decoder_path,
+                          const int num_threads = 0);
+
+    /**
+     * @brief Creates a Base model instance with explicit session options
+     *
+     * @param encoder_path Path to the encoder ONNX model file
+     * @param decoder_path Path to the decoder ONNX model file
+     * @param options Session configuration
      * @return OnnxModel Configured Base model instance
      */
     static OnnxModel Base(const f_path &encoder_path,
                           const f_path &decoder_path,
-                          const int num_threads = 4);
+                          const ModelOptions &options);
 
     /**
      * @brief Creates a Tiny model instance
      *
      * @param encoder_path Path to the encoder ONNX model file
      * @param decoder_path Path to the decoder ONNX model file
-     * @param num_threads Number of threads to use for inference (default: 4)
+     * @param num_threads Number of threads to use for inference, 0 to derive it from the CPU budget (default: 0)
      * @return OnnxModel Configured Tiny model instance
      */
     static OnnxModel Tiny(const f_path &encoder_path,
                           const f_path &decoder_path,
-                          const int num_threads = 4);
+                          const int num_threads = 0);
+
+    /**
+     * @brief Creates a Tiny model instance with explicit session options
+     *
+     * @param encoder_path Path to the encoder ONNX model file
+     * @param decoder_path Path to the decoder ONNX model file
+     * @param options Session configuration
+     * @return OnnxModel Configured Tiny model instance
+     */
+    static OnnxModel Tiny(const f_path &encoder_path,
+                          const f_path &decoder_path,
+                          const ModelOptions &options);
 
     /**
      * @brief Runs inference on audio data to produce token indices
@@ -80,13 +329,202 @@ public:
      */
     std::vector<int> run(std::vector<float> &audio_data) noexcept;
 
+    /**
+     * @brief Runs inference and records how the tokens were produced
+     *
+     * Fills the tokens, stop reason and decode step count of the result and,
+     * when requested, the input preparation, encoder and per-step decoder
+     * timings. If inference fails the stop reason is StopReason::Error.
+     *
+     * @param audio_data Vector of float audio samples (assumed to be 16kHz mono)
+     * @param result Result to fill
+     * @param collect_timings Whether to measure stage timings
+     */
+    void run(std::vector<float> &audio_data, TranscriptionResult &result, bool collect_timings) noexcept;
+
+    /**
+     * @brief Encodes audio into a handle that can be decoded repeatedly
+     *
+     * When the encoder cache is enabled, encoding audio that is already cached
+     * returns the cached handle without running the encoder.
+     *
+     * @param audio_data Vector of float audio samples (assumed to be 16kHz mono)
+     * @return EncodedAudioHandle The encoder output
+     */
+    EncodedAudioHandle encode(const std::vector<float> &audio_data);
+
+    /**
+     * @brief Decodes a previously encoded clip into token indices
+     *
+     * @param encoded Handle returned by encode()
+     * @param options Decoding parameters (default: duration based budget)
+     * @return std::vector<int> Vector of decoded token indices
+     */
+    std::vector<int> decode(const EncodedAudioHandle &encoded, const DecodeOptions &options = {});
+
+    /**
+     * @brief Encodes audio and prepares a decode that can be run in slices
+     *
+     * @param audio_data Vector of float audio samples (assumed to be 16kHz mono)
+     * @param options Decoding parameters (default: duration based budget)
+     * @return DecoderState The decode, before its first step
+     */
+    DecoderState start_decode(const std::vector<float> &audio_data, const DecodeOptions &options = {});
+
+    /**
+     * @brief Runs decoder steps of a decode started by start_decode() or restored
+     *
+     * @param state The decode to advance
+     * @param max_steps Most decoder steps to run before returning
+     * @return bool True once the decode has finished
+     * @throws std::runtime_error If the state does not fit this model
+     */
+    bool continue_decode(DecoderState &state, size_t max_steps);
+
+    /**
+     * @brief Enables or disables the encoder output cache
+     *
+     * Cached entries are evicted in least-recently-used order once their
+     * total size exceeds max_bytes. Passing 0 disables and clears the cache.
+     * Configuration only: must not be called concurrently with inference.
+     *
+     * @param max_bytes Memory budget for cached encoder outputs
+     * @param half_precision Store cached outputs as fp16 (default: false)
+     */
+    void set_encoder_cache(size_t max_bytes, bool half_precision = false);
+
+    /**
+     * @brief Pads encoder inputs to a fixed set of lengths
+     *
+     * Audio is zero padded up to the smallest bucket that fits it, so the
+     * encoder only ever sees a handful of input shapes and ORT can reuse the
+     * memory plan it caches per shape (memory patterns are on by default).
+     * Frames produced by the padding are trimmed from last_hidden_state
+     * before decoding, but the encoder attends over the whole padded input,
+     * so bucketing changes the encoder output for the real frames as well;
+     * use check_encoder_buckets() to confirm transcripts are unaffected.
+     * Audio longer than the largest bucket is encoded at its own length.
+     * Passing an empty list disables bucketing. Clears the encoder cache,
+     * whose entries were computed with the old padding. Must not be called
+     * concurrently with inference.
+     *
+     * @param bucket_sizes Bucket lengths in samples
+     * @param warm_up Run the encoder once per bucket now to build its plan (default: true)
+     */
+    void set_encoder_buckets(std::vector<size_t> bucket_sizes, bool warm_up = true);
+
+    /**
+     * @brief Shortens long pauses before encoding
+     *
+     * Applies compact_silence() to the audio given to run() and encode(), so
+     * the encoder sees a shorter sequence and the duration based token budget
+     * shrinks with it. Clears the encoder cache. Must not be called
+     * concurrently with inference.
+     *
+     * @param compaction Pause length and gap, or std::nullopt to disable
+     */
+    void set_silence_compaction(std::optional<SilenceCompaction> compaction);
+
+    /**
+     * @brief Checks that bucketed encoding does not change a transcript
+     *
+     * Decodes the audio with and without the configured buckets and compares
+     * the tokens. Must not be called concurrently with other inference.
+     *
+     * @param audio_data Vector of float audio samples (assumed to be 16kHz mono)
+     * @return bool True if both passes produce identical tokens
+     */
+    bool check_encoder_buckets(const std::vector<float> &audio_data);
+
+    /**
+     * @brief Stops any active profiling and summarizes the ORT profiles by operator
+     *
+     * @return ProfileSummary Operator costs of the encoder and a decoder step
+     * @throws std::runtime_error If the model was not created with profiling enabled
+     */
+    ProfileSummary get_profile_summary();
+
+    /**
+     * @brief Checks whether runs currently go to the spinning sessions
+     * @return bool True if adaptive spin is enabled and the request rate is high
+     */
+    bool is_spinning() const noexcept;
+
+    /**
+     * @brief Counts a request towards the rate adaptive spin is based on
+     *
+     * Call once per request before its runs, however many encoder and
+     * decoder runs it takes. Does nothing without adaptive spin.
+     */
+    void note_request();
+
+    /**
+     * @brief Describes the configuration the model actually runs with
+     *
+     * Space separated key=value pairs: intra-op threads as resolved from the
+     * CPU budget, silence compaction, shortlist, encoder buckets and adaptive
+     * spin, each "off" when disabled. Reflects later set_encoder_buckets() and
+     * set_silence_compaction() calls.
+     *
+     * @return std::string e.g. "threads=4 compaction=off shortlist=off buckets=16000,32000 spin=off"
+     */
+    std::string get_config() const;
+
+    /**
+     * @brief Identifies the current settings that change transcripts
+     *
+     * Digests of silence compaction, the shortlist (decoder file, token ids
+     * and threshold) and encoder buckets, so a transcript cache keyed on it
+     * never mixes outputs of differently configured models. Updated by
+     * set_encoder_buckets() and set_silence_compaction().
+     *
+     * @return const std::string& Empty when none of them is set
+     */
+    const std::string &get_output_identity() const noexcept { return output_identity; }
+
+    /**
+     * @brief Gets the time and memory spent creating the model
+     * @return const StartupReport& Environment, sessions and I/O names; tokenizer phases are empty
+     */
+    const StartupReport &get_startup_report() const noexcept { return startup; }
+
     /**
      * @brief Gets the required sample rate for the model
      * @return size_t Sample rate in Hz (16000)
      */
     constexpr inline static size_t get_sample_rate() noexcept { return sample_rate; }
 
+    OnnxModel(OnnxModel &&) noexcept;
+    OnnxModel &operator=(OnnxModel &&) noexcept;
+    ~OnnxModel();
+
 private:
+#ifdef MOONSHINE_BENCH_ACCESS
+    friend struct OnnxModelBenchAccess;  /**< Lets bench/ time the decode internals directly, only in bench builds */
+#endif
+
+    struct EncoderCache;
+    struct ProfilingState;
+    struct SpinState;
+
+    /**
+     * @brief Creates the ORT environment and the model, timing both
+     *
+     * @param encoder_path Path to the encoder ONNX model file
+     * @param decoder_path Path to the decoder ONNX model file
+     * @param num_layers Number of layers in the model
+     * @param num_kv_heads Number of key-value heads in the model
+     * @param head_dim Dimension of each attention head
+     * @param options Session configuration
+     * @return OnnxModel The model, with its startup report filled in
+     */
+    static OnnxModel create(const f_path &encoder_path,
+                            const f_path &decoder_path,
+                            const int64_t num_layers,
+                            const int64_t num_kv_heads,
+                            const int64_t head_dim,
+                            const ModelOptions &options);
+
     /**
      * @brief Constructs a new OnnxModel instance
      *
@@ -95,7 +533,7 @@ private:
      * @param num_layers Number of layers in the model
      * @param num_kv_heads Number of key-value heads in the model
      * @param head_dim Dimension of each attention head
-     * @param num_threads Number of threads to use for inference
+     * @param options Session configuration
      * @param env ONNX runtime environment (default: Ort::Env{ORT_LOGGING_LEVEL_WARNING, "Moonshine::OnnxModel"})
      * @param memory_info Memory information (default: Ort::MemoryInfo::CreateCpu(OrtAllocatorType::OrtDeviceAllocator, OrtMemType::OrtMemTypeCPU))
      */
@@ -104,7 +542,7 @@ private:
               const int64_t num_layers,
               const int64_t num_kv_heads,
               const int64_t head_dim,
-              const int num_threads,
+              const ModelOptions &options,
               Ort::Env env = default_env(),
               Ort::MemoryInfo memory_info = default_memory_info());
 
@@ -114,21 +552,41 @@ private:
     void initialize_model_io_names();
 
     /**
-     * @brief Encodes audio data into latent space representations
+     * @brief Counts a profiled session run and stops profiling at the run limit
+     *
+     * @param is_encoder Whether the run was on the encoder session
+     */
+    void count_profiled_run(bool is_encoder);
+
+    /**
+     * @brief Stops profiling a session and records its profile file
+     *
+     * @param is_encoder Whether to stop the encoder or the decoder session
+     * @note Caller must hold the profiling mutex
+     */
+    void end_profiling(bool is_encoder);
+
+    /**
+     * @brief Runs the encoder on audio data
      *
      * @param audio_data Vector of float audio samples
+     * @param result Adds to its input preparation and sets its encoder timings, if not null
      * @return std::vector<Ort::Value> Encoder output tensors
      */
-    std::vector<Ort::Value> encode(std::vector<float> &audio_data);
+    std::vector<Ort::Value> run_encoder(std::vector<float> &audio_data,
+                                        TranscriptionResult *result = nullptr);
 
     /**
      * @brief Decodes encoder output into token indices
      *
      * @param last_hidden_state Encoder's hidden state output
      * @param max_len Maximum length of the output sequence
+     * @param result Receives stop reason, step count and step timings, if not null
      * @return std::vector<int> Vector of decoded token indices
      */
-    std::vector<int> decode(Ort::Value last_hidden_state, size_t max_len);
+    std::vector<int> decode(Ort::Value last_hidden_state,
+                            size_t max_len,
+                            TranscriptionResult *result = nullptr);
 
     /**
      * @brief Generate a zero filled key-value cache for decoding
@@ -145,7 +603,38 @@ private:
      * @param logits Logits tensor from the decoder
      * @return int The index of the next token
      */
-    int get_next_token(Ort::Value logits);
+    static int get_next_token(Ort::Value logits);
+
+    /**
+     * @brief Finds the largest logit without copying the logits
+     *
+     * @param logits Logits tensor from the decoder, shaped [1, 1, n]
+     * @return std::pair<size_t, float> Index and value of the largest logit
+     */
+    static std::pair<size_t, float> best_logit(Ort::Value &logits);
+
+    /**
+     * @brief Picks the next token from the outputs of a decoder step
+     *
+     * Without a shortlist this is get_next_token(). With one, the best
+     * shortlisted logit is mapped to its token id, or the step is rerun on
+     * the full decoder when that logit is below the threshold, replacing
+     * the outputs.
+     *
+     * @param output Outputs of the step, logits first
+     * @param cur_tokens Inputs of the step
+     * @param last_hidden_state Current hidden state
+     * @param past_key_values Current key-value cache
+     * @param use_cache_branch Whether the step used the caching branch
+     * @param fell_back Set to true if the step was rerun on the full decoder
+     * @return int The next token
+     */
+    int select_token(std::vector<Ort::Value> &output,
+                     std::vector<int64_t> &cur_tokens,
+                     Ort::Value &last_hidden_state,
+                     std::vector<Ort::Value> &past_key_values,
+                     bool use_cache_branch,
+                     bool &fell_back);
 
     /**
      * @brief Performs one decoding step to get the next token
@@ -154,12 +643,24 @@ private:
      * @param last_hidden_state Current hidden state
      * @param past_key_values Current key-value cache
      * @param use_cache_branch Whether to use the caching branch of the model
+     * @param shortlisted Whether to run the shortlisted decoder (default: false)
      * @return std::vector<Ort::Value> Decoder outputs including new logits and key-value cache
      */
     std::vector<Ort::Value> decode_next_token(std::vector<int64_t> &cur_tokens,
                                               Ort::Value &last_hidden_state,
                                               std::vector<Ort::Value> &past_key_values,
-                                              bool use_cache_branch);
+                                              bool use_cache_branch,
+                                              bool shortlisted = false);
+
+    /**
+     * @brief Drops every cached encoder output, keeping the cache enabled
+     */
+    void clear_encoder_cache();
+
+    /**
+     * @brief Recomputes output_identity from the current settings
+     */
+    void update_output_identity();
 
     /**
      * @brief Updates the key-value cache with new values
@@ -168,9 +669,34 @@ private:
      * @param new_values New values to add to the cache
      * @param use_cache_branch Whether the cache branch of the model is being used
      */
-    void update_kv_cache(std::vector<Ort::Value> &cache,
-                         std::vector<Ort::Value> &new_values,
-                         bool use_cache_branch);
+    static void update_kv_cache(std::vector<Ort::Value> &cache,
+                                std::vector<Ort::Value> &new_values,
+                                bool use_cache_branch);
+
+    /**
+     * @brief Clones an existing tensor.
+     *
+     * The Ort::Value tensors are treated similar to unique_pointers in that they are move only.
+     * This presents a challenge for the decoder where the auto-regressive nature of the model
+     * requires that previous iteration tensor values be passed in future iterations (i.e. the
+     * key-value cache and encoder hidden states). This function allows for the cloning of these
+     * tensors to ensure that the original values are not modified.
+     *
+     * @tparam T The data type of the tensor elements.
+     * @param tensor The tensor to be cloned.
+     * @param mem_info The memory information for the new tensor.
+     * @return Ort::Value A new tensor that is a clone of the input tensor.
+     */
+    template<typename T>
+    static Ort::Value clone_tensor(Ort::Value &tensor, Ort::MemoryInfo &mem_info) {
+        return Ort::Value::CreateTensor<T>(
+            mem_info,
+            tensor.GetTensorMutableData<T>(),
+            tensor.GetTensorTypeAndShapeInfo().GetElementCount(),
+            tensor.GetTensorTypeAndShapeInfo().GetShape().data(),
+            tensor.GetTensorTypeAndShapeInfo().GetShape().size()
+        );
+    }
 
     int64_t num_layers;
     int64_t num_kv_heads;
@@ -178,8 +704,10 @@ private:
 
     Ort::Env env;         /**< ONNX runtime environment */
     Ort::MemoryInfo memory_info;    /**< Memory allocation information */
+    std::shared_ptr<Ort::PrepackedWeightsContainer> prepacked_weights;  /**< Shared by blocking and spinning sessions, null without adaptive spin */
     Ort::Session encoder; /**< ONNX runtime session for the encoder */
     Ort::Session decoder; /**< ONNX runtime session for the decoder */
+    Ort::Session shortlist_decoder; /**< Decoder restricted to the shortlist, null when disabled */
 
     Ort::AllocatorWithDefaultOptions model_name_allocator; /**< Allocator for model I/O names */
     std::vector<Ort::AllocatedStringPtr> model_io_names;   /**< Storage for allocated string pointers */
@@ -190,8 +718,19 @@ private:
     std::vector<const char *> decoder_input_names;  /**< Input names for the decoder */
     std::vector<const char *> decoder_output_names; /**< Output names for the decoder */
 
+    std::unique_ptr<EncoderCache> encoder_cache;    /**< Cached encoder outputs, null when disabled */
+    std::vector<size_t> encoder_buckets;            /**< Sorted encoder input lengths, empty when disabled */
+    std::unique_ptr<ProfilingState> profiling;      /**< Session profiling state, null when disabled */
+    std::unique_ptr<SpinState> spin;                /**< Spinning sessions and request rate, null without adaptive spin */
+    int intra_op_threads = 1;                       /**< Intra-op threads of each session */
+    bool track_memory = false;                      /**< Whether run() measures memory per request */
+    std::optional<SilenceCompaction> silence_compaction;  /**< Pause shortening, disabled when unset */
+    std::optional<VocabShortlist> shortlist;        /**< Shortlisted token ids and threshold, unset when disabled */
+    StartupReport startup;                          /**< Cost of creating the model */
+    std::string output_identity;                    /**< See get_output_identity() */
+
     static constexpr int start_token = 1;           /**< Token ID representing sequence start */
-    static constexpr int end_token = 2;             /**< Token ID representing sequence end */
+    static constexpr int end_token = VocabShortlist::end_token;  /**< Token ID representing sequence end */
     static constexpr size_t sample_rate = 16000;    /**< Expected audio sample rate in Hz */
     static constexpr size_t max_tokens_per_second = 6;  /**< Maximum tokens per second of audio */
     static constexpr size_t min_token_count = 1;    /**< Minimum number of tokens to generate */
@@ -0,0 +1,81 @@
+#ifndef MOONSHINE_PROFILING_H__
+#define MOONSHINE_PROFILING_H__
+
+/**
+ * @file moonshine_profiling.h
+ * @brief Per-operator cost summaries built from ONNX Runtime session profiles
+ */
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+
+namespace Moonshine {
+
+/**
+ * @struct ProfilingOptions
+ * @brief Enables ORT session profiling for a bounded number of runs
+ *
+ * Profiling stops on its own once a session reaches its run limit, so it can
+ * be left on for a warm-up period without unbounded trace files. Profiled runs
+ * are slower than normal ones; use it for diagnosis, not for latency numbers.
+ */
+struct ProfilingOptions {
+    std::filesystem::path output_prefix = "moonshine_profile";  /**< Prefix of the ORT JSON files */
+    size_t max_encoder_runs = 20;       /**< Encoder runs to profile */
+    size_t max_decoder_runs = 1000;     /**< Decoder steps to profile */
+};
+
+/**
+ * @struct OperatorCost
+ * @brief Time spent in one operator type
+ */
+struct OperatorCost {
+    std::string op_type;        /**< ONNX operator type, e.g. MatMul */
+    double total_ms = 0.0;      /**< Kernel time summed over all profiled runs */
+    double per_run_ms = 0.0;    /**< Kernel time per profiled run */
+    size_t calls = 0;           /**< Kernel invocations */
+    double percent = 0.0;       /**< Share of the session's kernel time */
+};
+
+/**
+ * @struct SessionProfile
+ * @brief Operator costs for one session, most expensive first
+ */
+struct SessionProfile {
+    std::filesystem::path file;         /**< ORT profile JSON the summary was built from */
+    size_t runs = 0;                    /**< Profiled session runs */
+    double total_ms = 0.0;              /**< Kernel time over all profiled runs */
+    std::vector<OperatorCost> operators;  /**< Costs by operator type */
+};
+
+/**
+ * @struct ProfileSummary
+ * @brief Operator costs for the encoder and for a single decoder step
+ */
+struct ProfileSummary {
+    SessionProfile encoder;     /**< Encoder runs */
+    SessionProfile decoder;     /**< Decoder steps */
+
+    /**
+     * @brief Formats the most expensive operators of both sessions as a table
+     * @param top_n Operators listed per session (default: 10)
+     * @return std::string The formatted table
+     */
+    std::string to_string(size_t top_n = 10) const;
+};
+
+/**
+ * @brief Aggregates an ORT profile JSON file by operator type
+ *
+ * @param file Profile written by an ORT session with profiling enabled
+ * @param runs Number of session runs the profile covers
+ * @return SessionProfile The aggregated costs
+ */
+SessionProfile summarize_ort_profile(const std::filesystem::path &file, size_t runs);
+
+}
+
+#endif
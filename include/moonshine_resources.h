@@ -0,0 +1,98 @@
+#ifndef MOONSHINE_RESOURCES_H__
+#define MOONSHINE_RESOURCES_H__
+
+/**
+ * @file moonshine_resources.h
+ * @brief Detection of the CPU and memory actually available to the process
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace Moonshine {
+
+/**
+ * @struct ResourceLimits
+ * @brief CPU and memory budget of the process and the defaults derived from it
+ *
+ * A container usually sees every CPU and all of the host's memory while its
+ * cgroup only lets it use a fraction. Sizing thread pools from the host's
+ * counts oversubscribes the quota, and the kernel throttles the whole cgroup
+ * for the rest of each period, which hurts latency far more than running
+ * fewer threads would.
+ */
+struct ResourceLimits {
+    size_t online_cpus = 1;             /**< CPUs the host reports */
+    size_t affinity_cpus = 1;           /**< CPUs in the scheduler affinity mask */
+    size_t physical_cores = 1;          /**< Distinct cores among the affinity CPUs, SMT siblings counted once */
+    double cpu_quota = 0.0;             /**< CPUs allowed by cgroup cpu.max, 0 when unlimited */
+    uint64_t physical_memory_bytes = 0; /**< Memory of the host, 0 if unknown */
+    uint64_t memory_limit_bytes = 0;    /**< Limit from cgroup memory.max, 0 when unlimited */
+
+    /**
+     * @brief Gets the CPUs the process can keep busy
+     * @return double The affinity CPU count, reduced to the cgroup quota if lower
+     */
+    double get_cpu_budget() const noexcept;
+
+    /**
+     * @brief Gets the memory the process can use
+     * @return uint64_t The cgroup limit if set, else the host's memory, 0 if neither is known
+     */
+    uint64_t get_memory_budget() const noexcept;
+
+    /**
+     * @brief Gets the default intra-op thread count of a session
+     *
+     * The whole CPU budget rounded down, so a 2.5 CPU quota gives 2 threads,
+     * and no more than the physical cores, since SMT siblings gain little on
+     * the GEMM heavy encoder and decoder.
+     *
+     * @return int At least 1
+     */
+    int get_default_threads() const noexcept;
+
+    /**
+     * @brief Gets how many models running in parallel fit in the CPU budget
+     *
+     * @param threads_per_model Intra-op threads of each model
+     * @return size_t Number of Transcribers or worker processes, at least 1
+     */
+    size_t get_default_workers(int threads_per_model) const noexcept;
+
+    /**
+     * @brief Gets how many requests may be in flight within the memory budget
+     *
+     * @param bytes_per_request Peak memory of one request, e.g. from MemoryBreakdown::peak_bytes
+     * @param reserved_bytes Memory held regardless of load, e.g. loaded models (default: 0)
+     * @return size_t At least 1, or SIZE_MAX if the budget is unknown
+     */
+    size_t get_max_in_flight(uint64_t bytes_per_request, uint64_t reserved_bytes = 0) const noexcept;
+
+    /**
+     * @brief Reads the limits from the system
+     *
+     * On Linux reads the affinity mask, the SMT topology under
+     * /sys/devices/system/cpu and the cgroup v2 cpu.max and memory.max of the
+     * process's cgroup and every ancestor, taking the tightest. Elsewhere only
+     * the CPU count is known.
+     *
+     * @return ResourceLimits The detected limits
+     */
+    static ResourceLimits detect();
+};
+
+/**
+ * @brief Gets the limits detected once per process
+ *
+ * Used for ModelOptions::num_threads = 0. Limits changed after the first
+ * call, e.g. by a resized pod, are not picked up.
+ *
+ * @return const ResourceLimits& The cached limits
+ */
+const ResourceLimits &get_resource_limits();
+
+}
+
+#endif
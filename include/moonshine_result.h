@@ -0,0 +1,146 @@
+#ifndef MOONSHINE_RESULT_H__
+#define MOONSHINE_RESULT_H__
+
+/**
+ * @file moonshine_result.h
+ * @brief Detailed transcription results with per-stage timings
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Timing collection is compiled in by default; build with
+ * MOONSHINE_ENABLE_TIMINGS=0 to turn every StageTimer into a no-op.
+ */
+#ifndef MOONSHINE_ENABLE_TIMINGS
+#define MOONSHINE_ENABLE_TIMINGS 1
+#endif
+
+
+namespace Moonshine {
+
+/**
+ * @enum StopReason
+ * @brief Why the decoder stopped generating tokens
+ *
+ * Decoder states and capture logs store it by value and reject values past
+ * Error; new reasons go last and move that bound.
+ */
+enum class StopReason : uint8_t {
+    EndToken,       /** The decoder emitted the end token */
+    TokenBudget,    /** The duration based token budget was exhausted */
+    Error           /** Inference failed */
+};
+
+/**
+ * @struct StageTiming
+ * @brief Wall clock and calling thread CPU time spent in one stage
+ */
+struct StageTiming {
+    double wall_ms = 0.0;   /**< Elapsed wall clock time in milliseconds */
+    double cpu_ms = 0.0;    /**< CPU time of the calling thread in milliseconds */
+};
+
+/**
+ * @struct MemoryBreakdown
+ * @brief Memory a request allocated through the tracking allocators, by stage
+ *
+ * Sizes are measured from the allocations charged to the request's
+ * MemoryScope, not estimated from tensor shapes. Model weights are loaded
+ * before the request and are not included.
+ */
+struct MemoryBreakdown {
+    size_t encoder_peak_bytes = 0;      /**< Encoder input copy, activations and outputs at their peak */
+    size_t encoder_output_bytes = 0;    /**< Encoder outputs held while decoding, mainly last_hidden_state */
+    size_t kv_cache_bytes = 0;          /**< Decoder KV cache at its largest, measured between steps */
+    size_t decoder_step_peak_bytes = 0; /**< Most any decoder run added on top of what was held */
+    size_t logits_bytes = 0;            /**< Logits output of one decoder step */
+    size_t transient_peak_bytes = 0;    /**< Host scratch copies made by the library at their peak */
+    size_t peak_bytes = 0;              /**< Whole request at its peak */
+};
+
+/**
+ * @struct TranscriptionResult
+ * @brief Transcript together with how it was produced
+ *
+ * Timing fields are only populated when timings_collected is true. Thread
+ * CPU time covers the calling thread only; work done by ORT's intra-op pool
+ * threads shows up as wall time but not as CPU time here.
+ */
+struct TranscriptionResult {
+    std::string text;                           /**< Decoded text */
+    std::vector<int> tokens;                    /**< Token ids, excluding the end token */
+    StopReason stop_reason = StopReason::EndToken;  /**< Why decoding stopped */
+    size_t decode_steps = 0;                    /**< Decoder invocations, including the one emitting the end token */
+    size_t compacted_samples = 0;               /**< Samples removed by silence compaction before encoding */
+    size_t shortlist_fallbacks = 0;             /**< Decoder steps rerun on the full vocabulary */
+
+    bool timings_collected = false;             /**< Whether the timings below are valid */
+    StageTiming input_prep;                     /**< Silence compaction, budget computation, padding and input tensor creation */
+    StageTiming encode;                         /**< Encoder session run */
+    std::vector<StageTiming> decode_step_timings;  /**< One entry per decoder step */
+    StageTiming decode;                         /**< All decoder steps */
+    StageTiming detokenize;                     /**< Tokenizer decode */
+    StageTiming total;                          /**< Whole transcription */
+    double time_to_first_token_ms = 0.0;        /**< Wall time until the first decoder step completed */
+
+    bool memory_collected = false;              /**< Whether memory is valid, see ModelOptions::track_memory */
+    MemoryBreakdown memory;                     /**< Memory allocated per stage */
+};
+
+/**
+ * @brief Gets the CPU time consumed by the calling thread
+ * @return double CPU time in milliseconds, or 0 where unsupported
+ */
+double thread_cpu_time_ms() noexcept;
+
+/**
+ * @class StageTimer
+ * @brief Measures wall and thread CPU time from construction or the last restart
+ */
+class StageTimer {
+public:
+    /**
+     * @brief Construct a new StageTimer and start timing
+     * @param enabled Whether to read the clocks at all (default: true)
+     */
+    explicit StageTimer(bool enabled = true) noexcept : enabled(enabled && MOONSHINE_ENABLE_TIMINGS) {
+        restart();
+    }
+
+    /**
+     * @brief Restarts timing from now
+     */
+    void restart() noexcept {
+        if (enabled) {
+            wall_start = std::chrono::steady_clock::now();
+            cpu_start = thread_cpu_time_ms();
+        }
+    }
+
+    /**
+     * @brief Gets the time since construction or the last restart
+     * @return StageTiming Elapsed wall and CPU time, zero when disabled
+     */
+    StageTiming elapsed() const noexcept {
+        if (!enabled) {
+            return {};
+        }
+
+        std::chrono::duration<double, std::milli> wall = std::chrono::steady_clock::now() - wall_start;
+        return {wall.count(), thread_cpu_time_ms() - cpu_start};
+    }
+
+private:
+    bool enabled;                                       /**< Whether the clocks are read */
+    std::chrono::steady_clock::time_point wall_start;   /**< Wall clock at start */
+    double cpu_start = 0.0;                             /**< Thread CPU time at start */
+};
+
+}
+
+#endif
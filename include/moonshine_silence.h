@@ -0,0 +1,44 @@
+#ifndef MOONSHINE_SILENCE_H__
+#define MOONSHINE_SILENCE_H__
+
+/**
+ * @file moonshine_silence.h
+ * @brief Shortening of long pauses in audio before encoding
+ */
+
+#include <cstddef>
+#include <vector>
+
+
+namespace Moonshine {
+
+/**
+ * @struct SilenceCompaction
+ * @brief Which pauses compact_silence() shortens and to what
+ */
+struct SilenceCompaction {
+    float silence_rms = 0.01f;      /**< 10ms frames with lower RMS count as silence */
+    size_t min_pause_ms = 1000;     /**< Pauses at least this long are shortened */
+    size_t kept_gap_ms = 200;       /**< Silence left in place of a shortened pause */
+    bool trim_edges = true;         /**< Also shorten leading and trailing silence */
+};
+
+/**
+ * @brief Shortens long pauses to a fixed gap
+ *
+ * Audio is split into 10ms frames classified by RMS. Every run of silent
+ * frames of at least min_pause_ms between speech keeps kept_gap_ms of its
+ * samples, half next to the speech before it and half next to the speech
+ * after it; leading and trailing runs keep kept_gap_ms next to the speech
+ * when trim_edges is set. Speech is copied unchanged. Audio without any
+ * speech is cut to kept_gap_ms when trim_edges is set.
+ *
+ * @param audio_data Vector of float audio samples (assumed to be 16kHz mono)
+ * @param options Pause length and gap
+ * @return std::vector<float> The compacted audio
+ */
+std::vector<float> compact_silence(const std::vector<float> &audio_data, const SilenceCompaction &options);
+
+}
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef MOONSHINE_STARTUP_H__
+#define MOONSHINE_STARTUP_H__
+
+/**
+ * @file moonshine_startup.h
+ * @brief Per-phase wall time, bytes read and memory growth of model and tokenizer loading
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+
+namespace Moonshine {
+
+/**
+ * @struct StartupPhase
+ * @brief Cost of one startup phase
+ *
+ * Bytes come from process-wide counters, so they include anything other
+ * threads did during the phase. Both are 0 where the counters are not
+ * available (outside Linux).
+ */
+struct StartupPhase {
+    double wall_ms = 0.0;           /**< Wall time in milliseconds */
+    uint64_t bytes_read = 0;        /**< Bytes read through read calls (rchar of /proc/self/io) */
+    int64_t rss_growth_bytes = 0;   /**< Growth of the resident set, negative if memory was returned */
+
+    /**
+     * @brief Gets the part of this phase not covered by another
+     *
+     * @param other An earlier, cheaper build of the same thing
+     * @return StartupPhase Field-wise difference, times and bytes read clamped at 0
+     */
+    StartupPhase minus(const StartupPhase &other) const noexcept;
+};
+
+/**
+ * @struct SessionStartup
+ * @brief Cost of creating one ORT session
+ *
+ * ORT builds a session in a single call, so graph_load, optimization and
+ * prepacking are only filled in with ModelOptions::split_startup, which
+ * first builds three throwaway sessions: an untimed one with graph
+ * optimization and prepacking disabled that pulls the file into the page
+ * cache, the same again (graph_load), then one with optimization only.
+ * optimization and prepacking are the differences between those builds and
+ * the real one. Every timed build therefore runs against a warm page cache,
+ * total included, and the split is an approximation from differences of
+ * separate builds; expect noise on small models. Without split_startup,
+ * total is the cost of the first, possibly cold, build.
+ */
+struct SessionStartup {
+    StartupPhase total;             /**< Creation of the session that is used */
+    StartupPhase graph_load;        /**< Parsing the model and creating kernels and initializers */
+    StartupPhase optimization;      /**< Graph transformations */
+    StartupPhase prepacking;        /**< Repacking weights for the CPU kernels */
+};
+
+/**
+ * @struct StartupReport
+ * @brief Breakdown of Transcriber construction
+ */
+struct StartupReport {
+    StartupPhase env;               /**< Ort::Env creation, costly only for the first environment of a process */
+    SessionStartup encoder;         /**< Encoder session */
+    SessionStartup decoder;         /**< Decoder session */
+    StartupPhase io_names;          /**< Reading model input and output names */
+    StartupPhase tokenizer_read;    /**< Reading the tokenizer JSON file */
+    StartupPhase tokenizer_parse;   /**< Building the tokenizer from the JSON */
+    StartupPhase total;             /**< Everything above and the rest of construction */
+    bool sessions_split = false;    /**< Whether the session phases were measured */
+
+    /**
+     * @brief Formats the report as an aligned table, one phase per line
+     * @return std::string The table
+     */
+    std::string to_string() const;
+};
+
+/**
+ * @class StartupTimer
+ * @brief Measures a StartupPhase from construction or the last restart
+ */
+class StartupTimer {
+public:
+    StartupTimer() noexcept { restart(); }
+
+    /**
+     * @brief Restarts measuring from now
+     */
+    void restart() noexcept;
+
+    /**
+     * @brief Gets the cost since construction or the last restart
+     * @return StartupPhase The elapsed phase
+     */
+    StartupPhase elapsed() const noexcept;
+
+private:
+    std::chrono::steady_clock::time_point wall_start;  /**< Wall clock at start */
+    uint64_t read_start = 0;                            /**< Process read bytes at start */
+    int64_t resident_start = 0;                         /**< Resident set size at start */
+};
+
+}
+
+#endif
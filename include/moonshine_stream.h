@@ -0,0 +1,148 @@
+#ifndef MOONSHINE_STREAM_H__
+#define MOONSHINE_STREAM_H__
+
+/**
+ * @file moonshine_stream.h
+ * @brief Live audio transcription with partial results and utterance endpointing
+ */
+
+#include <optional>
+#include <string>
+#include <vector>
+#include "moonshine.h"
+
+
+namespace Moonshine {
+
+/**
+ * @struct EndpointOptions
+ * @brief When a StreamTranscriber re-decodes and when it finalizes an utterance
+ */
+struct EndpointOptions {
+    float silence_rms = 0.01f;          /**< 10ms frames with lower RMS count as silence */
+    size_t trailing_silence_ms = 600;   /**< Silence after speech needed to end an utterance */
+    size_t stable_decodes = 2;          /**< Consecutive identical partials ending in the end token needed to end an utterance */
+    size_t partial_interval_ms = 300;   /**< Audio between partial decodes */
+    size_t leading_silence_ms = 300;    /**< Silence kept in front of the first speech */
+    size_t max_utterance_ms = 30000;    /**< Utterances are finalized at this length regardless */
+};
+
+/**
+ * @struct StreamUpdate
+ * @brief A partial or final transcript of the current utterance
+ */
+struct StreamUpdate {
+    std::string text;       /**< Transcript of the utterance so far */
+    bool is_final = false;  /**< Whether the utterance has ended and will not change */
+    double start_s = 0.0;   /**< Utterance start in seconds from the start of the stream */
+    double end_s = 0.0;     /**< End of the audio the transcript covers */
+};
+
+/**
+ * @class StreamTranscriber
+ * @brief Transcribes a live stream one utterance at a time
+ *
+ * Audio is pushed in chunks of any size. Every partial_interval_ms the
+ * current utterance is decoded again and reported as a partial. An
+ * utterance is finalized as soon as it has trailing_silence_ms of silence
+ * after speech and the last stable_decodes partials stopped on the end token
+ * with identical tokens; the audio and hypothesis are then released and a
+ * new utterance starts, so the decoded window does not keep growing. The
+ * final transcript is the stable partial, so endpointing adds no decode.
+ *
+ * Not thread safe; use one StreamTranscriber per stream. The Transcriber
+ * may be shared with other streams.
+ */
+class StreamTranscriber {
+public:
+    /**
+     * @brief Construct a new StreamTranscriber
+     *
+     * @param transcriber Transcriber used for every decode, must outlive the stream
+     * @param options Endpointing parameters (default: EndpointOptions{})
+     */
+    explicit StreamTranscriber(Transcriber &transcriber, EndpointOptions options = {});
+
+    /**
+     * @brief Appends audio and decodes when due
+     *
+     * @param chunk Vector of float audio samples (assumed to be 16kHz mono)
+     * @return std::vector<StreamUpdate> Partials and finals produced by this chunk, in order
+     */
+    std::vector<StreamUpdate> push(const std::vector<float> &chunk);
+
+    /**
+     * @brief Ends the stream, finalizing any buffered speech
+     * @return std::optional<StreamUpdate> Final transcript of the last utterance, if it had speech
+     */
+    std::optional<StreamUpdate> finish();
+
+    /**
+     * @brief Gets the audio buffered for the current utterance
+     * @return size_t Number of samples
+     */
+    size_t get_buffered_samples() const noexcept { return utterance.size(); }
+
+    /**
+     * @brief Serializes the stream so it can be evicted and resumed elsewhere
+     *
+     * Captures the buffered utterance, the endpointing counters and the last
+     * partial's tokens and text, but not the options. A stream resumed from
+     * an uncompressed blob produces the same updates as one that was never
+     * saved. Compression is lossy: the restored audio is quantized, so later
+     * partials and the final transcript can differ slightly.
+     *
+     * @param compress Store the audio as 16-bit PCM, halving the blob but losing precision (default: false)
+     * @return std::string The blob
+     */
+    std::string save_state(bool compress = false) const;
+
+    /**
+     * @brief Replaces the stream's state with one from save_state()
+     *
+     * @param blob The blob, possibly saved by another process on another worker
+     * @throws std::runtime_error If the blob is not a stream state
+     */
+    void restore_state(const std::string &blob);
+
+private:
+    /**
+     * @brief Classifies complete 10ms frames not yet seen as speech or silence
+     */
+    void analyze_frames();
+
+    /**
+     * @brief Decodes the utterance and updates hypothesis stability
+     * @return StreamUpdate The partial transcript
+     */
+    StreamUpdate decode_partial();
+
+    /**
+     * @brief Emits the final transcript and starts a new utterance
+     * @return StreamUpdate The final transcript
+     */
+    StreamUpdate finalize();
+
+    /**
+     * @brief Converts milliseconds to samples
+     */
+    static size_t to_samples(size_t ms) noexcept { return ms * OnnxModel::get_sample_rate() / 1000; }
+
+    Transcriber &transcriber;       /**< Runs the decodes */
+    EndpointOptions options;        /**< Endpointing parameters */
+
+    std::vector<float> utterance;   /**< Audio of the current utterance */
+    size_t utterance_start = 0;     /**< Stream position of utterance[0] in samples */
+    size_t analyzed = 0;            /**< Samples of utterance already classified */
+    size_t speech_end = 0;          /**< End of the last speech frame, 0 before any speech */
+    size_t trailing_silence = 0;    /**< Silent samples since the last speech frame */
+    size_t decoded = 0;             /**< Samples covered by the last partial */
+
+    std::vector<int> hypothesis;    /**< Tokens of the last partial */
+    std::string hypothesis_text;    /**< Text of the last partial */
+    size_t stable_count = 0;        /**< Consecutive partials ending in the end token with these tokens */
+};
+
+}
+
+#endif
@@ -0,0 +1,209 @@
+#ifndef MOONSHINE_TRACE_H__
+#define MOONSHINE_TRACE_H__
+
+/**
+ * @file moonshine_trace.h
+ * @brief Opt-in span tracing into a ring buffer, exportable as Chrome trace JSON
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+namespace Moonshine {
+
+/**
+ * @struct TraceEvent
+ * @brief A completed span
+ */
+struct TraceEvent {
+    const char *name = nullptr;     /**< Span name, must have static storage duration */
+    uint64_t request_id = 0;        /**< Request the span belongs to, 0 if none */
+    uint32_t thread_id = 0;         /**< Small integer id of the recording thread */
+    int64_t start_ns = 0;           /**< Start time relative to the tracer epoch */
+    int64_t duration_ns = 0;        /**< Span duration */
+};
+
+/**
+ * @class Tracer
+ * @brief Process-wide span recorder
+ *
+ * Tracing is disabled by default; a disabled span costs one relaxed atomic
+ * load. When enabled, completed spans are written to a fixed size ring buffer
+ * that keeps the most recent events. The buffer can be dumped at any time in
+ * the Chrome trace event format, which chrome://tracing and Perfetto open.
+ */
+class Tracer {
+public:
+    /**
+     * @brief Gets the process-wide tracer
+     * @return Tracer& The shared instance
+     */
+    static Tracer &instance();
+
+    /**
+     * @brief Enables or disables span recording
+     * @param enable Whether spans are recorded
+     */
+    void set_enabled(bool enable) noexcept { enabled.store(enable, std::memory_order_relaxed); }
+
+    /**
+     * @brief Checks whether span recording is enabled
+     * @return bool True if enabled
+     */
+    bool is_enabled() const noexcept { return enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Resizes the ring buffer, discarding recorded events
+     * @param events Maximum number of events kept
+     */
+    void set_capacity(size_t events);
+
+    /**
+     * @brief Records a completed span
+     * @param event The span to record
+     */
+    void record(const TraceEvent &event) noexcept;
+
+    /**
+     * @brief Gets the recorded events, oldest first
+     * @return std::vector<TraceEvent> Copy of the ring buffer contents
+     */
+    std::vector<TraceEvent> events() const;
+
+    /**
+     * @brief Discards all recorded events
+     */
+    void clear() noexcept;
+
+    /**
+     * @brief Renders the recorded events as Chrome trace JSON
+     * @return std::string The JSON document
+     */
+    std::string dump_chrome_trace() const;
+
+    /**
+     * @brief Writes the recorded events as Chrome trace JSON
+     * @param path Output file
+     */
+    void write_chrome_trace(const std::filesystem::path &path) const;
+
+    /**
+     * @brief Gets nanoseconds since the tracer epoch
+     * @return int64_t Current trace time
+     */
+    int64_t now_ns() const noexcept {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    /**
+     * @brief Allocates a new request id
+     * @return uint64_t Unique, non-zero request id
+     */
+    uint64_t next_request_id() noexcept { return request_ids.fetch_add(1, std::memory_order_relaxed); }
+
+    /**
+     * @brief Gets the request id of the calling thread
+     * @return uint64_t Current request id, 0 if none
+     */
+    static uint64_t current_request_id() noexcept;
+
+    /**
+     * @brief Sets the request id of the calling thread
+     * @param request_id Request id, 0 to clear
+     */
+    static void set_current_request_id(uint64_t request_id) noexcept;
+
+    /**
+     * @brief Gets the small integer id of the calling thread
+     * @return uint32_t Thread id, stable for the thread's lifetime
+     */
+    static uint32_t current_thread_id() noexcept;
+
+private:
+    Tracer();
+
+    std::atomic<bool> enabled{false};               /**< Whether spans are recorded */
+    std::atomic<uint64_t> request_ids{1};           /**< Next request id */
+    std::chrono::steady_clock::time_point epoch;    /**< Zero of trace time */
+
+    mutable std::mutex mutex;           /**< Guards the ring buffer */
+    std::vector<TraceEvent> ring;       /**< Recorded events */
+    size_t next = 0;                    /**< Slot the next event goes to */
+    bool wrapped = false;               /**< Whether the buffer has been filled once */
+};
+
+/**
+ * @class TraceSpan
+ * @brief Records a span covering its own lifetime
+ */
+class TraceSpan {
+public:
+    /**
+     * @brief Starts a span if tracing is enabled
+     * @param name Span name, must have static storage duration
+     */
+    explicit TraceSpan(const char *name) noexcept
+        : name(Tracer::instance().is_enabled() ? name : nullptr),
+          start_ns(this->name ? Tracer::instance().now_ns() : 0)
+    {}
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+    /**
+     * @brief Ends the span and records it
+     */
+    ~TraceSpan() {
+        if (name) {
+            auto &tracer = Tracer::instance();
+            int64_t end_ns = tracer.now_ns();
+
+            tracer.record({name, Tracer::current_request_id(), Tracer::current_thread_id(),
+                           start_ns, end_ns - start_ns});
+        }
+    }
+
+private:
+    const char *name;   /**< Span name, null when tracing was disabled at start */
+    int64_t start_ns;   /**< Start time */
+};
+
+/**
+ * @class TraceRequestScope
+ * @brief Tags spans on the calling thread with a new request id for its lifetime
+ */
+class TraceRequestScope {
+public:
+    /**
+     * @brief Assigns a fresh request id to the calling thread
+     */
+    TraceRequestScope() noexcept
+        : previous(Tracer::current_request_id())
+    {
+        if (Tracer::instance().is_enabled()) {
+            Tracer::set_current_request_id(Tracer::instance().next_request_id());
+        }
+    }
+
+    TraceRequestScope(const TraceRequestScope &) = delete;
+    TraceRequestScope &operator=(const TraceRequestScope &) = delete;
+
+    /**
+     * @brief Restores the previous request id
+     */
+    ~TraceRequestScope() { Tracer::set_current_request_id(previous); }
+
+private:
+    uint64_t previous;  /**< Request id in effect before this scope */
+};
+
+}
+
+#endif
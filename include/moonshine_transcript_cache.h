@@ -0,0 +1,136 @@
+#ifndef MOONSHINE_TRANSCRIPT_CACHE_H__
+#define MOONSHINE_TRANSCRIPT_CACHE_H__
+
+/**
+ * @file moonshine_transcript_cache.h
+ * @brief Content addressed cache of transcripts with in-flight request coalescing
+ */
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "moonshine_onnx_model.h"
+
+
+namespace Moonshine {
+
+/**
+ * @class TranscriptCache
+ * @brief Caches transcripts keyed by a hash of the audio samples and the model id
+ *
+ * Lookups go to an in-memory LRU tier first and then, if configured, to an
+ * on-disk tier that survives restarts. The disk tier is bounded in bytes:
+ * once a write takes it over budget, the least recently used files (by
+ * modification time, which a hit refreshes) are deleted until it is back
+ * to three quarters of the budget. Concurrent requests for the same key
+ * are coalesced: the first caller runs the inference and every other caller
+ * waits for, and shares, its result.
+ */
+class TranscriptCache {
+public:
+    /**
+     * @struct Stats
+     * @brief Cache effectiveness counters
+     */
+    struct Stats {
+        uint64_t memory_hits = 0;   /**< Served from the memory tier */
+        uint64_t disk_hits = 0;     /**< Served from the disk tier */
+        uint64_t coalesced = 0;     /**< Waited on an identical in-flight request */
+        uint64_t misses = 0;        /**< Ran inference */
+        uint64_t disk_evictions = 0;    /**< Files deleted to keep the disk tier within budget */
+    };
+
+    /**
+     * @brief Construct a new TranscriptCache
+     *
+     * @param max_entries Maximum number of transcripts held in memory (default: 4096)
+     * @param disk_dir Directory for the on-disk tier, created if missing (default: none)
+     * @param max_disk_bytes Size of the files in disk_dir above which old entries are deleted,
+     *                       0 for no limit (default: 256MiB)
+     */
+    explicit TranscriptCache(size_t max_entries = 4096,
+                             std::optional<f_path> disk_dir = std::nullopt,
+                             uint64_t max_disk_bytes = 256ull << 20);
+
+    /**
+     * @brief Gets the cached transcript for the audio, computing it on a miss
+     *
+     * A failed computation is not cached in either tier, so a retry runs
+     * inference again. Requests coalesced onto it receive the same empty
+     * transcript, or the same exception if compute threw.
+     *
+     * @param model_id Identifies the model, tokenizer and every option that changes the transcript
+     * @param audio_data Vector of float audio samples
+     * @param compute Produces the transcript on a miss, or std::nullopt if inference failed
+     * @return std::string The transcript, empty if compute failed
+     */
+    std::string get_or_compute(const std::string &model_id,
+                               const std::vector<float> &audio_data,
+                               const std::function<std::optional<std::string>()> &compute);
+
+    /**
+     * @brief Removes every entry from the memory tier
+     */
+    void clear() noexcept;
+
+    /**
+     * @brief Gets the cache effectiveness counters
+     * @return Stats Snapshot of the counters
+     */
+    Stats get_stats() const noexcept;
+
+private:
+    /**
+     * @brief Looks up a key in the on-disk tier
+     */
+    std::optional<std::string> read_disk(const std::string &key, uint64_t key_hash) const;
+
+    /**
+     * @brief Stores a transcript in the on-disk tier
+     */
+    void write_disk(const std::string &key, uint64_t key_hash, const std::string &transcript);
+
+    /**
+     * @brief Deletes the least recently used disk tier files until it is within budget
+     * @note Caller must hold disk_mutex
+     */
+    void prune_disk();
+
+    /**
+     * @brief Stores a transcript in the memory tier
+     * @note Caller must hold mutex
+     */
+    void insert_memory(const std::string &key, const std::string &transcript);
+
+    /**
+     * @struct MemoryEntry
+     * @brief A transcript and its position in the LRU list
+     */
+    struct MemoryEntry {
+        std::string transcript;                     /**< Cached transcript */
+        std::list<std::string>::iterator lru_pos;   /**< Position in lru */
+    };
+
+    size_t max_entries;                 /**< Capacity of the memory tier */
+    std::optional<f_path> disk_dir;     /**< Root of the disk tier, if enabled */
+    uint64_t max_disk_bytes;            /**< Budget of the disk tier, 0 for no limit */
+
+    std::mutex disk_mutex;              /**< Guards disk_bytes and pruning */
+    uint64_t disk_bytes = 0;            /**< Estimated size of the disk tier, recounted by pruning */
+
+    mutable std::mutex mutex;                                                   /**< Guards members below */
+    std::unordered_map<std::string, MemoryEntry> memory;                        /**< Memory tier */
+    std::list<std::string> lru;                                                 /**< Keys, most recent first */
+    std::unordered_map<std::string, std::shared_future<std::string>> in_flight; /**< Running computations */
+    Stats stats;                                                                /**< Effectiveness counters */
+};
+
+}
+
+#endif
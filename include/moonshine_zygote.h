@@ -0,0 +1,95 @@
+#ifndef MOONSHINE_ZYGOTE_H__
+#define MOONSHINE_ZYGOTE_H__
+
+/**
+ * @file moonshine_zygote.h
+ * @brief Pre-fork worker spawning that shares loaded model weights copy-on-write
+ */
+
+#include <functional>
+#include <vector>
+#include <sys/types.h>
+#include "moonshine.h"
+
+
+namespace Moonshine {
+
+/**
+ * @class Zygote
+ * @brief Loads and warms a Transcriber once, then forks workers that inherit it
+ *
+ * ONNX Runtime thread pools do not survive fork(), and a session's pools can
+ * not be replaced once it is created. The zygote therefore builds its sessions
+ * with a single intra-op thread, which makes ORT run everything on the calling
+ * thread and create no pool threads at all. The parent process stays
+ * thread-free, so forking is safe, and each worker gets the fully initialized
+ * sessions (weights, prepacked buffers, I/O names) as copy-on-write pages.
+ * Scale out by spawning more workers rather than adding threads per worker.
+ */
+class Zygote {
+public:
+    /**
+     * @brief Worker entry point, run in the child process
+     *
+     * The return value becomes the child's exit status.
+     */
+    using Worker = std::function<int(Transcriber &)>;
+
+    /**
+     * @brief Callback run around fork()
+     */
+    using Hook = std::function<void()>;
+
+    /**
+     * @brief Construct a new Zygote, loading and warming the model
+     *
+     * @param model_type The type of model to use (Base or Tiny)
+     * @param encoder_path Path to the encoder ONNX model file
+     * @param decoder_path Path to the decoder ONNX model file
+     * @param tokenizer_path Path to the tokenizer model (JSON) file
+     */
+    Zygote(const ModelType model_type,
+           const f_path &encoder_path,
+           const f_path &decoder_path,
+           const f_path &tokenizer_path);
+
+    /**
+     * @brief Registers callbacks run around every fork() done by spawn()
+     *
+     * Use these to quiesce application state the library does not know about,
+     * e.g. lock mutexes in prepare and release them in parent and child, or
+     * start per-worker threads in child.
+     *
+     * @param prepare Run in the parent just before fork()
+     * @param parent Run in the parent just after fork()
+     * @param child Run in the child just after fork(), before the worker
+     */
+    void add_fork_hooks(Hook prepare, Hook parent, Hook child);
+
+    /**
+     * @brief Forks a worker process that runs the worker function
+     *
+     * The child never returns from this call; it exits with the worker's
+     * return value (or 1 if the worker throws).
+     *
+     * @param worker Function run in the child with the inherited Transcriber
+     * @return pid_t Process id of the new worker
+     */
+    pid_t spawn(const Worker &worker);
+
+    /**
+     * @brief Gets the Transcriber shared with the workers
+     * @return Transcriber& The warmed transcriber
+     */
+    Transcriber &get_transcriber() noexcept;
+
+private:
+    Transcriber transcriber;            /**< Warmed, single-threaded transcriber */
+    std::vector<Hook> prepare_hooks;    /**< Run before fork() */
+    std::vector<Hook> parent_hooks;     /**< Run in the parent after fork() */
+    std::vector<Hook> child_hooks;      /**< Run in the child after fork() */
+};
+
+}
+
+#endif
@@ -0,0 +1,170 @@
+#!/usr/bin/env python3
+"""Exports a decoder whose logits only cover a vocabulary shortlist.
+
+Moonshine::VocabShortlist needs a second decoder export with the same inputs
+and outputs as the full decoder, whose logits hold one entry per token of the
+shortlist, in token list order. This script derives it from the full decoder
+by slicing the final vocabulary projection: the weight (and bias, if any)
+feeding the logits output keep only the listed token columns. Everything
+else, including the If branches of merged decoders, is left untouched.
+
+The projection may be a MatMul or Gemm on a weight initializer, optionally
+through a Transpose of a tied embedding, followed by an optional bias Add.
+Quantized projections are not supported.
+
+Usage:
+    scripts/export_shortlist_decoder.py decoder.onnx shortlist.txt decoder_shortlist.onnx
+
+Requires the onnx and numpy Python packages.
+"""
+
+import argparse
+import sys
+
+import numpy as np
+import onnx
+from onnx import numpy_helper
+
+END_TOKEN = 2
+PASS_THROUGH = {"Identity", "Cast"}
+
+
+def read_tokens(path):
+    with open(path) as f:
+        text = f.read().split()
+
+    try:
+        tokens = [int(token) for token in text]
+    except ValueError:
+        sys.exit(f"Token list must hold whitespace separated token ids: {path}")
+
+    if not tokens:
+        sys.exit(f"Token list is empty: {path}")
+
+    if END_TOKEN not in tokens:
+        sys.exit(f"Token list does not include the end token {END_TOKEN}: {path}")
+
+    return tokens
+
+
+class Slicer:
+    """Slices the vocabulary projection of every graph producing logits."""
+
+    def __init__(self, model, tokens):
+        self.root = model.graph
+        self.tokens = np.array(tokens, dtype=np.int64)
+        self.initializers = {init.name: init for init in self.root.initializer}
+        self.sliced = {}
+        self.projections = 0
+
+    def initializer(self, graph, name):
+        for init in graph.initializer:
+            if init.name == name:
+                return init
+
+        return self.initializers.get(name)
+
+    def add_slice(self, graph, name, axis, transpose=False):
+        """Adds a root initializer holding the token slice of an existing one."""
+        key = (name, axis, transpose)
+
+        if key in self.sliced:
+            return self.sliced[key]
+
+        array = numpy_helper.to_array(self.initializer(graph, name))
+
+        if self.tokens.max() >= array.shape[axis]:
+            sys.exit(f"Token id {self.tokens.max()} is outside the vocabulary of {array.shape[axis]}")
+
+        sliced = np.take(array, self.tokens, axis=axis)
+
+        if transpose:
+            sliced = sliced.T
+
+        sliced_name = f"{name}_shortlist_{len(self.sliced)}"
+        self.root.initializer.append(numpy_helper.from_array(np.ascontiguousarray(sliced), sliced_name))
+        self.sliced[key] = sliced_name
+
+        return sliced_name
+
+    def slice_graph(self, graph, output_index):
+        producers = {out: node for node in graph.node for out in node.output}
+        name = graph.output[output_index].name
+        node = producers.get(name)
+
+        while node is not None and node.op_type in PASS_THROUGH:
+            node = producers.get(node.input[0])
+
+        if node is None:
+            sys.exit(f"Logits output '{name}' is not produced by a node")
+
+        if node.op_type == "If":
+            index = list(node.output).index(name)
+
+            for attr in node.attribute:
+                if attr.type == onnx.AttributeProto.GRAPH:
+                    self.slice_graph(attr.g, index)
+
+            return
+
+        # Optional bias on the vocabulary axis
+        if node.op_type == "Add":
+            bias = next((i for i, x in enumerate(node.input) if self.initializer(graph, x) is not None), None)
+
+            if bias is None:
+                sys.exit("Logits Add has no bias initializer")
+
+            node.input[bias] = self.add_slice(graph, node.input[bias], axis=-1)
+            node = producers.get(node.input[1 - bias])
+
+        if node is None or node.op_type not in ("MatMul", "Gemm"):
+            sys.exit(f"Unsupported vocabulary projection: {node.op_type if node else 'graph input'}")
+
+        trans_b = node.op_type == "Gemm" and any(a.name == "transB" and a.i for a in node.attribute)
+        weight = node.input[1]
+
+        if self.initializer(graph, weight) is not None:
+            node.input[1] = self.add_slice(graph, weight, axis=0 if trans_b else -1)
+        elif weight in producers and producers[weight].op_type == "Transpose":
+            # Tied embedding [vocab, hidden] transposed into the projection
+            source = producers[weight].input[0]
+
+            if self.initializer(graph, source) is None or trans_b:
+                sys.exit("Unsupported transposed projection weight")
+
+            node.input[1] = self.add_slice(graph, source, axis=0, transpose=True)
+        else:
+            sys.exit(f"Projection weight '{weight}' is not an initializer")
+
+        if node.op_type == "Gemm" and len(node.input) > 2 and node.input[2]:
+            node.input[2] = self.add_slice(graph, node.input[2], axis=-1)
+
+        self.fix_shape(graph.output[output_index])
+        self.projections += 1
+
+    def fix_shape(self, value):
+        dims = value.type.tensor_type.shape.dim
+
+        if dims and dims[-1].HasField("dim_value"):
+            dims[-1].dim_value = len(self.tokens)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Export a vocabulary shortlist decoder")
+    parser.add_argument("decoder", help="Full decoder .onnx")
+    parser.add_argument("tokens", help="Token list, e.g. written by moonshine_token_freq")
+    parser.add_argument("output", help="Shortlist decoder .onnx to write")
+    args = parser.parse_args()
+
+    model = onnx.load(args.decoder)
+    slicer = Slicer(model, read_tokens(args.tokens))
+    slicer.slice_graph(model.graph, 0)
+    slicer.fix_shape(model.graph.output[0])
+
+    onnx.checker.check_model(model)
+    onnx.save(model, args.output)
+    print(f"Sliced {slicer.projections} projections to {len(slicer.tokens)} tokens: {args.output}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,185 @@
+/**
+ * @file moonshine_capture.cpp
+ * @brief Binary capture log of transcription requests.
+ *
+ * Layout, all integers in host byte order:
+ *   header:  "MSCAP1\0\0" (8 bytes), uint32 version
+ *   record:  uint32 body size, then
+ *            uint64 arrival_ns, uint64 audio_hash, uint32 sample_count,
+ *            uint8 stop_reason, uint8 has_audio, uint32 token_count,
+ *            uint32 decode_steps, 5 x float32 stage wall times (input_prep,
+ *            encode, decode, detokenize, total), uint16 config size, config
+ *            bytes, and sample_count x int16 samples when has_audio is set
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include "moonshine_blob.h"
+#include "moonshine_capture.h"
+#include "moonshine_hash.h"
+
+
+namespace {
+    constexpr char magic[8] = {'M', 'S', 'C', 'A', 'P', '1', '\0', '\0'};
+    constexpr uint32_t version = 1;
+
+    /**
+     * @brief Decides whether a clip's samples are stored
+     *
+     * Depends only on the audio hash, so a clip seen twice is treated the same.
+     */
+    bool keep_audio(uint64_t audio_hash, double fraction) {
+        if (fraction >= 1.0) {
+            return true;
+        }
+
+        if (fraction <= 0.0) {
+            return false;
+        }
+
+        return static_cast<double>(audio_hash >> 11) * 0x1.0p-53 < fraction;
+    }
+}
+
+
+namespace Moonshine {
+
+TrafficRecorder::TrafficRecorder(CaptureOptions options)
+    : options(std::move(options)),
+      epoch(std::chrono::steady_clock::now()),
+      out(this->options.path, std::ios::binary | std::ios::trunc)
+{
+    if (!out) {
+        throw std::runtime_error("Failed to create capture log: " + this->options.path.string());
+    }
+
+    out.write(magic, sizeof(magic));
+    out.write(reinterpret_cast<const char *>(&version), sizeof(version));
+    bytes = sizeof(magic) + sizeof(version);
+}
+
+void TrafficRecorder::record(uint64_t arrival_ns,
+                             const std::vector<float> &audio_data,
+                             const std::string &config,
+                             const TranscriptionResult &result) noexcept
+{
+    try {
+        const uint64_t audio_hash = hash_samples(audio_data);
+        const bool has_audio = keep_audio(audio_hash, options.audio_fraction);
+        const size_t config_size = std::min<size_t>(config.size(), std::numeric_limits<uint16_t>::max());
+
+        BlobWriter body;
+        body.data().reserve(64 + config_size + (has_audio ? audio_data.size() * sizeof(int16_t) : 0));
+
+        body.put<uint64_t>(arrival_ns);
+        body.put<uint64_t>(audio_hash);
+        body.put<uint32_t>(static_cast<uint32_t>(audio_data.size()));
+        body.put<uint8_t>(static_cast<uint8_t>(result.stop_reason));
+        body.put<uint8_t>(has_audio ? 1 : 0);
+        body.put<uint32_t>(static_cast<uint32_t>(result.tokens.size()));
+        body.put<uint32_t>(static_cast<uint32_t>(result.decode_steps));
+
+        for (const StageTiming *stage : {&result.input_prep, &result.encode, &result.decode,
+                                         &result.detokenize, &result.total}) {
+            body.put<float>(static_cast<float>(stage->wall_ms));
+        }
+
+        body.put<uint16_t>(static_cast<uint16_t>(config_size));
+        body.put_bytes(config.data(), config_size);
+
+        if (has_audio) {
+            body.put_pcm16(audio_data.data(), audio_data.size());
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        uint64_t record_bytes = sizeof(uint32_t) + body.data().size();
+
+        if (!out || bytes + record_bytes > options.max_bytes) {
+            return;
+        }
+
+        const auto body_size = static_cast<uint32_t>(body.data().size());
+        out.write(reinterpret_cast<const char *>(&body_size), sizeof(body_size));
+        out.write(body.data().data(), static_cast<std::streamsize>(body_size));
+        out.flush();
+
+        bytes += record_bytes;
+        recorded++;
+    } catch (...) {
+        // Capture must never fail a transcription
+    }
+}
+
+uint64_t TrafficRecorder::get_recorded() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return recorded;
+}
+
+uint64_t TrafficRecorder::get_bytes_written() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytes;
+}
+
+CaptureReader::CaptureReader(const f_path &path)
+    : in(path, std::ios::binary)
+{
+    if (!in) {
+        throw std::runtime_error("Failed to open capture log: " + path.string());
+    }
+
+    char header[sizeof(magic)];
+    uint32_t file_version = 0;
+    in.read(header, sizeof(header));
+    in.read(reinterpret_cast<char *>(&file_version), sizeof(file_version));
+
+    if (!in || std::memcmp(header, magic, sizeof(magic)) != 0) {
+        throw std::runtime_error("Not a capture log: " + path.string());
+    }
+
+    if (file_version != version) {
+        throw std::runtime_error("Unsupported capture log version " + std::to_string(file_version));
+    }
+}
+
+bool CaptureReader::next(CapturedRequest &request) {
+    uint32_t body_size = 0;
+
+    if (!in.read(reinterpret_cast<char *>(&body_size), sizeof(body_size))) {
+        return false;
+    }
+
+    std::string body(body_size, '\0');
+
+    if (!in.read(body.data(), body_size)) {
+        throw std::runtime_error("Capture log is truncated");
+    }
+
+    BlobReader reader(body);
+    request.arrival_ns = reader.take<uint64_t>();
+    request.audio_hash = reader.take<uint64_t>();
+    request.sample_count = reader.take<uint32_t>();
+    request.stop_reason = reader.take_enum(StopReason::Error);
+    const bool has_audio = reader.take<uint8_t>() != 0;
+    request.token_count = reader.take<uint32_t>();
+    request.decode_steps = reader.take<uint32_t>();
+    request.input_prep_ms = reader.take<float>();
+    request.encode_ms = reader.take<float>();
+    request.decode_ms = reader.take<float>();
+    request.detokenize_ms = reader.take<float>();
+    request.total_ms = reader.take<float>();
+
+    request.config.resize(reader.take<uint16_t>());
+    reader.take_bytes(request.config.data(), request.config.size());
+
+    request.samples.clear();
+
+    if (has_audio) {
+        reader.take_pcm16(request.samples, request.sample_count);
+    }
+
+    return true;
+}
+
+} // namespace Moonshine
@@ -0,0 +1,146 @@
+/**
+ * @file moonshine_hash.cpp
+ * @brief Fast non-cryptographic hashing of audio buffers.
+ */
+
+#include <cstring>
+#include "moonshine_hash.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MOONSHINE_HASH_SSE2 1
+#endif
+
+
+namespace {
+    constexpr size_t lanes = 8;                         /**< 64-bit accumulators */
+    constexpr size_t stripe_size = lanes * 8;           /**< Bytes consumed per accumulate step */
+    constexpr size_t stripes_per_block = 16;            /**< Stripes between scrambles */
+    constexpr uint64_t prime32 = 0x9E3779B1ULL;
+    constexpr uint64_t prime64_1 = 0x9E3779B185EBCA87ULL;
+    constexpr uint64_t prime64_2 = 0xC2B2AE3D27D4EB4FULL;
+
+    /** Per-lane keys; stripe s uses keys [s, s + lanes), the scramble uses the last lanes keys. */
+    alignas(16) constexpr uint64_t secret[stripes_per_block + lanes] = {
+        0xbe4ba423396cfeb8ULL, 0x1cad21f72c81017cULL, 0xdb979083e96dd4deULL, 0x1f67b3b7a4a44072ULL,
+        0x78e5c0cc4ee679cbULL, 0x2172ffcc7dd05a82ULL, 0x8e2443f7744608b8ULL, 0x4c263a81e69035e0ULL,
+        0xcb00c391bb52283cULL, 0xa32e531b8b65d088ULL, 0x4ef90da297486471ULL, 0xd8acdea946ef1938ULL,
+        0x3f349ce33f76faa8ULL, 0x1d4f0bc7c7bbdcf9ULL, 0x3159b4cd4be0518aULL, 0x647378d9c97e9fc8ULL,
+        0xc3ebd33483acc5eaULL, 0xeb6313faffa081c5ULL, 0x49daf0b751dd0d17ULL, 0x9e68d429265516d3ULL,
+        0xfca1477d58be162bULL, 0xce31d07ad1b8f88fULL, 0x280416958f3acb45ULL, 0x7e404bbbcafbd7afULL,
+    };
+
+    inline uint64_t read64(const unsigned char *p) noexcept {
+        uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    inline uint64_t avalanche(uint64_t h) noexcept {
+        h ^= h >> 33;
+        h *= prime64_2;
+        h ^= h >> 29;
+        h *= prime64_1;
+        h ^= h >> 32;
+        return h;
+    }
+
+    /**
+     * @brief Accumulates one 64 byte stripe into the lanes
+     *
+     * For each lane: acc += data; acc += lo32(data ^ key) * hi32(data ^ key)
+     */
+    inline void accumulate(uint64_t *acc, const unsigned char *stripe, const uint64_t *key) noexcept {
+#if defined(MOONSHINE_HASH_SSE2)
+        for (size_t i = 0; i < lanes; i += 2) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + i));
+            __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(stripe + i * 8));
+            __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i *>(key + i));
+            __m128i dk = _mm_xor_si128(d, k);
+            __m128i product = _mm_mul_epu32(dk, _mm_shuffle_epi32(dk, _MM_SHUFFLE(2, 3, 0, 1)));
+
+            a = _mm_add_epi64(a, d);
+            a = _mm_add_epi64(a, product);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(acc + i), a);
+        }
+#else
+        for (size_t i = 0; i < lanes; i++) {
+            uint64_t d = read64(stripe + i * 8);
+            uint64_t dk = d ^ key[i];
+
+            acc[i] += d;
+            acc[i] += (dk & 0xFFFFFFFFULL) * (dk >> 32);
+        }
+#endif
+    }
+
+    /**
+     * @brief Mixes the lanes so stripe order affects the result
+     *
+     * For each lane: acc = (acc ^ (acc >> 47) ^ key) * prime32
+     */
+    inline void scramble(uint64_t *acc, const uint64_t *key) noexcept {
+#if defined(MOONSHINE_HASH_SSE2)
+        const __m128i prime = _mm_set1_epi32(static_cast<int>(prime32));
+
+        for (size_t i = 0; i < lanes; i += 2) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + i));
+            __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i *>(key + i));
+
+            a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+            a = _mm_xor_si128(a, k);
+
+            __m128i lo = _mm_mul_epu32(a, prime);
+            __m128i hi = _mm_mul_epu32(_mm_srli_epi64(a, 32), prime);
+            a = _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(acc + i), a);
+        }
+#else
+        for (size_t i = 0; i < lanes; i++) {
+            acc[i] ^= acc[i] >> 47;
+            acc[i] ^= key[i];
+            acc[i] *= prime32;
+        }
+#endif
+    }
+}
+
+
+namespace Moonshine {
+
+uint64_t hash_bytes(const void *data, size_t size, uint64_t seed) noexcept {
+    const auto *p = static_cast<const unsigned char *>(data);
+    alignas(16) uint64_t acc[lanes] = {
+        prime32, prime64_1, prime64_2, prime64_1 ^ seed,
+        prime64_2 ^ seed, prime32 ^ seed, prime64_1 + seed, prime64_2 + seed,
+    };
+
+    size_t stripe = 0;
+    size_t offset = 0;
+
+    for (; offset + stripe_size <= size; offset += stripe_size) {
+        accumulate(acc, p + offset, secret + stripe);
+
+        if (++stripe == stripes_per_block) {
+            scramble(acc, secret + stripes_per_block);
+            stripe = 0;
+        }
+    }
+
+    if (offset < size) {
+        alignas(16) unsigned char last[stripe_size] = {};
+        std::memcpy(last, p + offset, size - offset);
+        accumulate(acc, last, secret + stripe);
+    }
+
+    uint64_t h = static_cast<uint64_t>(size) * prime64_1 ^ seed;
+
+    for (size_t i = 0; i < lanes; i++) {
+        h ^= avalanche(acc[i] + secret[i]);
+        h = (h << 27 | h >> 37) * prime64_1;
+    }
+
+    return avalanche(h);
+}
+
+} // namespace Moonshine
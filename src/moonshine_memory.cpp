@@ -0,0 +1,153 @@
+/**
+ * @file moonshine_memory.cpp
+ * @brief Tracking CPU allocator for ORT and per-thread memory scopes.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <string>
+#include "moonshine_memory.h"
+
+
+namespace {
+    /**
+     * @brief Alignment ORT expects of CPU buffers, also the size of the block header
+     */
+    constexpr size_t alignment = 64;
+
+    /**
+     * @struct BlockHeader
+     * @brief Stored in front of every tracked ORT block
+     */
+    struct alignas(alignment) BlockHeader {
+        size_t size;        /**< Requested size */
+        uint64_t scope_id;  /**< Scope charged, 0 if none */
+    };
+
+    static_assert(sizeof(BlockHeader) == alignment, "Header must keep blocks aligned");
+
+    thread_local Moonshine::MemoryScope *current_scope = nullptr;
+    std::atomic<uint64_t> next_scope_id{1};
+    std::atomic<size_t> total_live{0};
+    std::atomic<size_t> total_peak{0};
+
+    void *tracked_alloc(OrtAllocator *, size_t size) {
+        void *raw = ::operator new(sizeof(BlockHeader) + size, std::align_val_t{alignment}, std::nothrow);
+
+        if (!raw) {
+            return nullptr;
+        }
+
+        auto *header = static_cast<BlockHeader *>(raw);
+        auto *scope = Moonshine::MemoryScope::current();
+
+        header->size = size;
+        header->scope_id = scope ? scope->get_id() : 0;
+
+        if (scope) {
+            scope->charge(size, false);
+        }
+
+        size_t live = total_live.fetch_add(size, std::memory_order_relaxed) + size;
+        size_t peak = total_peak.load(std::memory_order_relaxed);
+
+        while (live > peak && !total_peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+
+        return header + 1;
+    }
+
+    void tracked_free(OrtAllocator *, void *p) {
+        if (!p) {
+            return;
+        }
+
+        auto *header = static_cast<BlockHeader *>(p) - 1;
+        auto *scope = Moonshine::MemoryScope::current();
+
+        if (scope && header->scope_id == scope->get_id()) {
+            scope->release(header->size, false);
+        }
+
+        total_live.fetch_sub(header->size, std::memory_order_relaxed);
+        ::operator delete(header, std::align_val_t{alignment});
+    }
+
+    const OrtMemoryInfo *tracked_info(const OrtAllocator *) {
+        // Leaked like the allocator itself, which ORT may use until exit
+        static auto *info = new Ort::MemoryInfo("Cpu", OrtDeviceAllocator, 0, OrtMemTypeDefault);
+
+        return *info;
+    }
+
+    OrtAllocator *tracking_allocator() {
+        static auto *allocator = new OrtAllocator{
+            ORT_API_VERSION,
+            tracked_alloc,
+            tracked_free,
+            tracked_info,
+            tracked_alloc,
+        };
+
+        return allocator;
+    }
+}
+
+
+namespace Moonshine {
+
+MemoryScope::MemoryScope() noexcept
+    : id(next_scope_id.fetch_add(1, std::memory_order_relaxed)),
+      previous(current_scope)
+{
+    current_scope = this;
+}
+
+MemoryScope::~MemoryScope() {
+    current_scope = previous;
+}
+
+MemoryScope *MemoryScope::current() noexcept {
+    return current_scope;
+}
+
+void MemoryScope::charge(size_t bytes, bool host) noexcept {
+    live += bytes;
+    peak = std::max(peak, live);
+    max = std::max(max, live);
+
+    if (host) {
+        host_live += bytes;
+        host_peak = std::max(host_peak, host_live);
+    }
+}
+
+void MemoryScope::release(size_t bytes, bool host) noexcept {
+    live -= std::min(live, bytes);
+
+    if (host) {
+        host_live -= std::min(host_live, bytes);
+    }
+}
+
+void register_tracking_allocator(Ort::Env &env) {
+    try {
+        env.RegisterAllocator(tracking_allocator());
+    } catch (const Ort::Exception &e) {
+        // Every Ort::Env shares one environment, which keeps the allocator
+        // registered by an earlier model for as long as any Env is alive.
+        if (std::string(e.what()).find("already") == std::string::npos) {
+            throw;
+        }
+    }
+}
+
+size_t get_tracked_live_bytes() noexcept {
+    return total_live.load(std::memory_order_relaxed);
+}
+
+size_t get_tracked_peak_bytes() noexcept {
+    return total_peak.load(std::memory_order_relaxed);
+}
+
+} // namespace Moonshine
@@ -0,0 +1,257 @@
+/**
+ * @file moonshine_metrics.cpp
+ * @brief Low overhead counters and latency histograms with a Prometheus text exporter.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include "moonshine_metrics.h"
+
+
+namespace {
+    /**
+     * @brief Reinterprets a double as its bit pattern
+     */
+    uint64_t to_bits(double value) noexcept {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    /**
+     * @brief Reinterprets a bit pattern as a double
+     */
+    double from_bits(uint64_t bits) noexcept {
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    /**
+     * @brief Writes the HELP and TYPE header of a metric
+     */
+    void write_header(std::ostringstream &out, const char *name, const char *type, const char *help) {
+        out << "# HELP " << name << ' ' << help << '\n'
+            << "# TYPE " << name << ' ' << type << '\n';
+    }
+
+    /**
+     * @brief Writes a histogram in Prometheus text format
+     */
+    void write_histogram(std::ostringstream &out,
+                         const char *name,
+                         const char *help,
+                         const Moonshine::Histogram &histogram)
+    {
+        auto snap = histogram.snapshot();
+        uint64_t cumulative = 0;
+
+        write_header(out, name, "histogram", help);
+
+        for (size_t i = 0; i < snap.bounds.size(); i++) {
+            cumulative += snap.counts[i];
+            out << name << "_bucket{le=\"" << snap.bounds[i] << "\"} " << cumulative << '\n';
+        }
+
+        out << name << "_bucket{le=\"+Inf\"} " << snap.count << '\n'
+            << name << "_sum " << snap.sum << '\n'
+            << name << "_count " << snap.count << '\n';
+    }
+}
+
+
+namespace Moonshine {
+
+size_t metric_shard_index() noexcept {
+    static std::atomic<size_t> next_index{0};
+    thread_local size_t index = next_index.fetch_add(1, std::memory_order_relaxed) % metric_shards;
+
+    return index;
+}
+
+uint64_t Counter::value() const noexcept {
+    uint64_t total = 0;
+
+    for (const auto &shard : shards) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+
+    return total;
+}
+
+void Counter::reset() noexcept {
+    for (auto &shard : shards) {
+        shard.value.store(0, std::memory_order_relaxed);
+    }
+}
+
+double HistogramSnapshot::quantile(double q) const noexcept {
+    if (count == 0) {
+        return 0.0;
+    }
+
+    double rank = std::clamp(q, 0.0, 1.0) * count;
+    uint64_t cumulative = 0;
+
+    for (size_t i = 0; i < counts.size(); i++) {
+        if (counts[i] == 0 || cumulative + counts[i] < rank) {
+            cumulative += counts[i];
+            continue;
+        }
+
+        if (i >= bounds.size()) {
+            return bounds.empty() ? 0.0 : bounds.back();   // Overflow bucket has no upper bound
+        }
+
+        double lower = i == 0 ? 0.0 : bounds[i - 1];
+        double fraction = (rank - cumulative) / counts[i];
+
+        return lower + (bounds[i] - lower) * fraction;
+    }
+
+    return bounds.empty() ? 0.0 : bounds.back();
+}
+
+Histogram::Histogram(std::vector<double> bounds)
+    : bounds(std::move(bounds))
+{
+    std::sort(this->bounds.begin(), this->bounds.end());
+
+    for (auto &shard : shards) {
+        shard.counts = std::vector<std::atomic<uint64_t>>(this->bounds.size() + 1);
+    }
+}
+
+void Histogram::observe(double value) noexcept {
+    auto &shard = shards[metric_shard_index()];
+    size_t bucket = std::lower_bound(bounds.begin(), bounds.end(), value) - bounds.begin();
+
+    shard.counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    shard.count.fetch_add(1, std::memory_order_relaxed);
+
+    // Shards are per thread, so this loop almost never retries
+    uint64_t expected = shard.sum_bits.load(std::memory_order_relaxed);
+
+    while (!shard.sum_bits.compare_exchange_weak(expected,
+                                                 to_bits(from_bits(expected) + value),
+                                                 std::memory_order_relaxed))
+    {}
+}
+
+HistogramSnapshot Histogram::snapshot() const {
+    HistogramSnapshot snap;
+    snap.bounds = bounds;
+    snap.counts.assign(bounds.size() + 1, 0);
+
+    for (const auto &shard : shards) {
+        for (size_t i = 0; i < shard.counts.size(); i++) {
+            snap.counts[i] += shard.counts[i].load(std::memory_order_relaxed);
+        }
+
+        snap.sum += from_bits(shard.sum_bits.load(std::memory_order_relaxed));
+        snap.count += shard.count.load(std::memory_order_relaxed);
+    }
+
+    return snap;
+}
+
+void Histogram::reset() noexcept {
+    for (auto &shard : shards) {
+        for (auto &count : shard.counts) {
+            count.store(0, std::memory_order_relaxed);
+        }
+
+        shard.sum_bits.store(to_bits(0.0), std::memory_order_relaxed);
+        shard.count.store(0, std::memory_order_relaxed);
+    }
+}
+
+std::vector<double> Histogram::exponential_bounds(double start, double factor, size_t count) {
+    std::vector<double> result;
+    result.reserve(count);
+
+    for (double bound = start; result.size() < count; bound *= factor) {
+        result.push_back(bound);
+    }
+
+    return result;
+}
+
+Metrics::Metrics()
+    : request_latency(Histogram::exponential_bounds(0.005, 2.0, 14)),
+      real_time_factor(Histogram::exponential_bounds(0.005, 1.5, 16)),
+      encoder_latency_per_audio_second(Histogram::exponential_bounds(0.001, 1.5, 16)),
+      decoder_step_latency(Histogram::exponential_bounds(0.0005, 1.5, 16)),
+      tokens_per_request(Histogram::exponential_bounds(1.0, 2.0, 10)),
+      queue_wait(Histogram::exponential_bounds(0.001, 2.0, 14)),
+      request_peak_memory(Histogram::exponential_bounds(1 << 20, 2.0, 14)),
+      kv_cache_memory(Histogram::exponential_bounds(1 << 16, 2.0, 16))
+{}
+
+Metrics &Metrics::instance() {
+    static Metrics metrics;
+
+    return metrics;
+}
+
+std::string Metrics::render_prometheus() const {
+    std::ostringstream out;
+
+    write_header(out, "moonshine_requests_total", "counter", "Completed transcription requests.");
+    out << "moonshine_requests_total " << requests.value() << '\n';
+
+    write_header(out, "moonshine_failed_requests_total", "counter", "Transcription requests where inference failed.");
+    out << "moonshine_failed_requests_total " << failed_requests.value() << '\n';
+
+    write_header(out, "moonshine_audio_seconds_total", "counter", "Seconds of audio transcribed.");
+    out << "moonshine_audio_seconds_total " << audio_milliseconds.value() / 1000.0 << '\n';
+
+    write_header(out, "moonshine_tokens_total", "counter", "Tokens generated.");
+    out << "moonshine_tokens_total " << tokens.value() << '\n';
+
+    write_header(out, "moonshine_in_flight_requests", "gauge", "Requests currently being transcribed.");
+    out << "moonshine_in_flight_requests " << in_flight.value() << '\n';
+
+    write_histogram(out, "moonshine_request_latency_seconds", "Transcription request wall time.", request_latency);
+    write_histogram(out, "moonshine_real_time_factor", "Request wall time divided by audio duration.", real_time_factor);
+    write_histogram(out, "moonshine_encoder_seconds_per_audio_second", "Encoder wall time per second of audio.",
+                    encoder_latency_per_audio_second);
+    write_histogram(out, "moonshine_decoder_step_seconds", "Wall time of a single decoder step.", decoder_step_latency);
+    write_histogram(out, "moonshine_tokens_per_request", "Tokens generated per request.", tokens_per_request);
+    write_histogram(out, "moonshine_queue_wait_seconds", "Time requests spent queued before transcription.", queue_wait);
+    write_histogram(out, "moonshine_request_peak_memory_bytes", "Peak memory allocated by a request.", request_peak_memory);
+    write_histogram(out, "moonshine_kv_cache_memory_bytes", "Largest decoder KV cache of a request.", kv_cache_memory);
+
+    write_header(out, "moonshine_spin_runs_total", "counter", "Session runs routed to spinning sessions.");
+    out << "moonshine_spin_runs_total " << spin_runs.value() << '\n';
+
+    write_header(out, "moonshine_spin_switches_total", "counter", "Switches between spinning and blocking sessions.");
+    out << "moonshine_spin_switches_total " << spin_switches.value() << '\n';
+
+    write_header(out, "moonshine_spin_idle_cpu_seconds_total", "counter",
+                 "CPU time of the spinning sessions' intra-op workers while they had no run in flight.");
+    out << "moonshine_spin_idle_cpu_seconds_total " << spin_idle_cpu_microseconds.value() / 1e6 << '\n';
+
+    return out.str();
+}
+
+void Metrics::reset() noexcept {
+    requests.reset();
+    failed_requests.reset();
+    audio_milliseconds.reset();
+    tokens.reset();
+    request_latency.reset();
+    real_time_factor.reset();
+    encoder_latency_per_audio_second.reset();
+    decoder_step_latency.reset();
+    tokens_per_request.reset();
+    queue_wait.reset();
+    request_peak_memory.reset();
+    kv_cache_memory.reset();
+    spin_runs.reset();
+    spin_switches.reset();
+    spin_idle_cpu_microseconds.reset();
+}
+
+} // namespace Moonshine
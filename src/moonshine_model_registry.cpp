@@ -0,0 +1,307 @@
+/**
+ * @file moonshine_model_registry.cpp
+ * @brief Process-wide registry of lazily loaded, shared models and tokenizers.
+ */
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include "moonshine_model_registry.h"
+
+
+namespace {
+    /**
+     * @brief Hashes the content of a file with 64-bit FNV-1a
+     *
+     * @param path File to hash
+     * @return uint64_t The content hash
+     */
+    uint64_t hash_file(const Moonshine::f_path &path) {
+        std::ifstream ifs(path, std::ios::binary);
+
+        if (!ifs) {
+            throw std::runtime_error("Unable to open file: " + path.string());
+        }
+
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        std::vector<char> chunk(1 << 20);
+
+        while (ifs) {
+            ifs.read(chunk.data(), chunk.size());
+
+            for (std::streamsize i = 0; i < ifs.gcount(); i++) {
+                hash ^= static_cast<unsigned char>(chunk[i]);
+                hash *= 0x100000001b3ULL;
+            }
+        }
+
+        return hash;
+    }
+
+    /**
+     * @brief Formats a hash as a fixed width hex string
+     *
+     * @param hash Hash value to format
+     * @return std::string 16 character hex representation
+     */
+    std::string to_hex(uint64_t hash) {
+        std::ostringstream hex;
+        hex << std::hex << std::setw(16) << std::setfill('0') << hash;
+
+        return hex.str();
+    }
+
+    /**
+     * @brief Reads a whole file into a string
+     *
+     * @param path File to read
+     * @return std::string The file content
+     */
+    std::string read_file(const Moonshine::f_path &path) {
+        std::ifstream ifs(path);
+        std::stringstream buffer;
+
+        buffer << ifs.rdbuf();
+
+        return buffer.str();
+    }
+
+    /**
+     * @brief Checks that a path exists and is a regular file
+     *
+     * @param path Path to check
+     */
+    void require_regular_file(const Moonshine::f_path &path) {
+        if (!std::filesystem::exists(path)) {
+            throw std::runtime_error("File not found: " + path.string());
+        } else if (!std::filesystem::is_regular_file(path)) {
+            throw std::runtime_error("Not a regular file: " + path.string());
+        }
+    }
+}
+
+
+namespace Moonshine {
+
+SharedTokenizer::SharedTokenizer(const std::string &json_blob)
+    : tokenizer(tokenizers::Tokenizer::FromBlobJSON(json_blob))
+{}
+
+std::string SharedTokenizer::decode(const std::vector<int> &tokens) {
+    std::lock_guard<std::mutex> lock(decode_mutex);
+
+    return tokenizer->Decode(tokens);
+}
+
+ModelRegistry &ModelRegistry::instance() {
+    static ModelRegistry registry;
+
+    return registry;
+}
+
+std::string ModelRegistry::register_model(const ModelType model_type,
+                                          const f_path &encoder_path,
+                                          const f_path &decoder_path,
+                                          const int num_threads)
+{
+    require_regular_file(encoder_path);
+    require_regular_file(decoder_path);
+
+    std::string id = (model_type == ModelType::Base ? "base/" : "tiny/")
+                   + fingerprint(encoder_path) + "/"
+                   + fingerprint(decoder_path) + "/t"
+                   + std::to_string(num_threads);
+
+    size_t footprint = std::filesystem::file_size(encoder_path)
+                     + std::filesystem::file_size(decoder_path);
+
+    add_entry(id, footprint, [=]() -> std::shared_ptr<void> {
+        switch (model_type) {
+            case ModelType::Base:
+                return std::make_shared<OnnxModel>(OnnxModel::Base(encoder_path, decoder_path, num_threads));
+            case ModelType::Tiny:
+                return std::make_shared<OnnxModel>(OnnxModel::Tiny(encoder_path, decoder_path, num_threads));
+        }
+
+        throw std::runtime_error("Unknown model type");
+    });
+
+    return id;
+}
+
+std::string ModelRegistry::register_tokenizer(const f_path &tokenizer_path) {
+    require_regular_file(tokenizer_path);
+
+    std::string id = "tokenizer/" + fingerprint(tokenizer_path);
+    size_t footprint = std::filesystem::file_size(tokenizer_path);
+
+    add_entry(id, footprint, [=]() -> std::shared_ptr<void> {
+        return std::make_shared<SharedTokenizer>(read_file(tokenizer_path));
+    });
+
+    return id;
+}
+
+std::shared_ptr<OnnxModel> ModelRegistry::acquire_model(const std::string &model_id) {
+    return std::static_pointer_cast<OnnxModel>(acquire(model_id));
+}
+
+std::shared_ptr<SharedTokenizer> ModelRegistry::acquire_tokenizer(const std::string &tokenizer_id) {
+    return std::static_pointer_cast<SharedTokenizer>(acquire(tokenizer_id));
+}
+
+void ModelRegistry::set_memory_budget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    memory_budget = bytes;
+    evict_until(memory_budget);
+}
+
+size_t ModelRegistry::get_memory_budget() const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return memory_budget;
+}
+
+size_t ModelRegistry::get_resident_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return resident_bytes;
+}
+
+size_t ModelRegistry::trim() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return evict_until(memory_budget);
+}
+
+size_t ModelRegistry::evict_idle() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return evict_until(0);
+}
+
+std::string ModelRegistry::fingerprint(const f_path &path) {
+    auto canonical = std::filesystem::weakly_canonical(path).string();
+    auto size = std::filesystem::file_size(path);
+    auto mtime = std::filesystem::last_write_time(path);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = fingerprints.find(canonical);
+
+        if (it != fingerprints.end() && it->second.size == size && it->second.mtime == mtime) {
+            return to_hex(it->second.hash);
+        }
+    }
+
+    uint64_t hash = hash_file(path);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    fingerprints[canonical] = Fingerprint{size, mtime, hash};
+
+    return to_hex(hash);
+}
+
+void ModelRegistry::add_entry(const std::string &id,
+                              size_t footprint,
+                              std::function<std::shared_ptr<void>()> load)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (entries.find(id) != entries.end()) {
+        return;
+    }
+
+    Entry entry;
+    entry.load = std::move(load);
+    entry.footprint = footprint;
+
+    entries.emplace(id, std::move(entry));
+}
+
+std::shared_ptr<void> ModelRegistry::acquire(const std::string &id) {
+    std::shared_ptr<std::mutex> load_mutex;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(id);
+
+        if (it == entries.end()) {
+            throw std::runtime_error("Unknown registry id: " + id);
+        }
+
+        Entry &entry = it->second;
+
+        if (entry.resident) {
+            lru.splice(lru.begin(), lru, entry.lru_pos);
+            return entry.resident;
+        }
+
+        load_mutex = entry.load_mutex;
+    }
+
+    // Load outside the registry lock so other entries stay available, but
+    // never load the same entry twice concurrently.
+    std::lock_guard<std::mutex> load_lock(*load_mutex);
+    std::function<std::shared_ptr<void>()> load;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry &entry = entries.at(id);
+
+        if (entry.resident) {
+            lru.splice(lru.begin(), lru, entry.lru_pos);
+            return entry.resident;
+        }
+
+        // Make room before loading so the old and new weights are not resident together
+        if (memory_budget >= entry.footprint) {
+            evict_until(memory_budget - entry.footprint);
+        } else {
+            evict_until(0);
+        }
+
+        load = entry.load;
+    }
+
+    auto value = load();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry &entry = entries.at(id);
+
+    entry.resident = value;
+    lru.push_front(id);
+    entry.lru_pos = lru.begin();
+    resident_bytes += entry.footprint;
+
+    evict_until(memory_budget, id);
+
+    return value;
+}
+
+size_t ModelRegistry::evict_until(size_t limit, const std::string &keep) {
+    size_t evicted = 0;
+    auto it = lru.end();
+
+    while (resident_bytes > limit && it != lru.begin()) {
+        --it;
+
+        Entry &entry = entries.at(*it);
+        bool idle = entry.resident.use_count() == 1;
+
+        if (!idle || *it == keep) {
+            continue;
+        }
+
+        entry.resident.reset();
+        resident_bytes -= entry.footprint;
+        it = lru.erase(it);
+        evicted++;
+    }
+
+    return evicted;
+}
+
+} // namespace Moonshine
@@ -9,43 +9,450 @@
 
 #include <stdexcept>
 #include <cmath>
+#include <cstring>
+#include <fstream>
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
 #include "moonshine.h"
+#include "moonshine_blob.h"
+#include "moonshine_hash.h"
+#include "moonshine_memory.h"
+#include "moonshine_metrics.h"
+#include "moonshine_trace.h"
+
+#if defined(__unix__)
+#include <pthread.h>
+#include <time.h>
+#endif
 
 namespace {
     /**
-     * @brief Clones an existing tensor.
+     * @brief Converts a float to IEEE half precision, rounding to nearest even
      *
-     * The Ort::Value tensors are treated similar to unique_pointers in that they are move only.
-     * This presents a challenge for the decoder where the auto-regressive nature of the model
-     * requires that previous iteration tensor values be passed in future iterations (i.e. the
-     * key-value cache and encoder hidden states). This function allows for the cloning of these
-     * tensors to ensure that the original values are not modified.
+     * @param value The value to convert
+     * @return uint16_t The half precision bit pattern
+     */
+    uint16_t float_to_half(float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+
+        uint32_t sign = (bits >> 16) & 0x8000;
+        uint32_t abs = bits & 0x7FFFFFFF;
+
+        if (abs >= 0x7F800000) {  // Inf or NaN
+            return static_cast<uint16_t>(sign | 0x7C00 | (abs > 0x7F800000 ? 0x200 : 0));
+        }
+
+        if (abs >= 0x477FF000) {  // Overflows to Inf after rounding
+            return static_cast<uint16_t>(sign | 0x7C00);
+        }
+
+        if (abs < 0x38800000) {   // Subnormal or zero in half precision
+            float f;
+            uint32_t abs_bits = abs;
+            std::memcpy(&f, &abs_bits, sizeof(f));
+            return static_cast<uint16_t>(sign | static_cast<uint32_t>(std::nearbyint(f * 16777216.0f)));
+        }
+
+        uint32_t mantissa_odd = (abs >> 13) & 1;
+        abs += 0xC8000FFF + mantissa_odd;  // Rebias exponent and round to nearest even
+
+        return static_cast<uint16_t>(sign | (abs >> 13));
+    }
+
+    /**
+     * @brief Converts IEEE half precision to float
      *
-     * @tparam T The data type of the tensor elements.
-     * @param tensor The tensor to be cloned.
-     * @param mem_info The memory information for the new tensor.
-     * @return Ort::Value A new tensor that is a clone of the input tensor.
+     * @param half The half precision bit pattern
+     * @return float The converted value
      */
-    template<typename T>
-    Ort::Value clone_tensor(Ort::Value &tensor, Ort::MemoryInfo &mem_info) {
-        return Ort::Value::CreateTensor<T>(
-            mem_info,
-            tensor.GetTensorMutableData<T>(),
-            tensor.GetTensorTypeAndShapeInfo().GetElementCount(),
-            tensor.GetTensorTypeAndShapeInfo().GetShape().data(),
-            tensor.GetTensorTypeAndShapeInfo().GetShape().size()
-        );
+    float half_to_float(uint16_t half) {
+        uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+        uint32_t exponent = (half >> 10) & 0x1F;
+        uint32_t mantissa = half & 0x3FF;
+        uint32_t bits;
+
+        if (exponent == 0x1F) {
+            bits = sign | 0x7F800000 | (mantissa << 13);
+        } else if (exponent != 0) {
+            bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+        } else {
+            float f = static_cast<float>(mantissa) / 16777216.0f;
+            std::memcpy(&bits, &f, sizeof(bits));
+            bits |= sign;
+        }
+
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+
+        return value;
     }
 }
 
 namespace Moonshine {
 
+namespace {
+    constexpr uint32_t decoder_state_magic = 0x5453444D;  // "MDST"
+    constexpr uint32_t decoder_state_version = 1;
+
+    /**
+     * @brief Appends a float tensor as its rank, dims and data
+     */
+    void put_tensor(BlobWriter &writer, const Ort::Value &tensor, bool half_precision) {
+        auto info = tensor.GetTensorTypeAndShapeInfo();
+        auto shape = info.GetShape();
+        size_t count = info.GetElementCount();
+
+        writer.put<uint32_t>(static_cast<uint32_t>(shape.size()));
+
+        for (int64_t dim : shape) {
+            writer.put<int64_t>(dim);
+        }
+
+        if (count == 0) {
+            return;
+        }
+
+        const float *p_data = tensor.GetTensorData<float>();
+
+        if (half_precision) {
+            for (size_t i = 0; i < count; i++) {
+                writer.put<uint16_t>(float_to_half(p_data[i]));
+            }
+        } else {
+            writer.put_bytes(p_data, count * sizeof(float));
+        }
+    }
+
+    /**
+     * @brief Reads a tensor written by put_tensor() into a tensor owning its data
+     */
+    Ort::Value take_tensor(BlobReader &reader, bool half_precision) {
+        size_t count = 0;
+        auto shape = reader.take_shape(half_precision ? sizeof(uint16_t) : sizeof(float), count);
+        Ort::AllocatorWithDefaultOptions allocator;
+        auto tensor = Ort::Value::CreateTensor<float>(allocator, shape.data(), shape.size());
+
+        if (count == 0) {
+            return tensor;
+        }
+
+        float *p_data = tensor.GetTensorMutableData<float>();
+
+        if (half_precision) {
+            for (size_t i = 0; i < count; i++) {
+                p_data[i] = half_to_float(reader.take<uint16_t>());
+            }
+        } else {
+            reader.take_bytes(p_data, count * sizeof(float));
+        }
+
+        return tensor;
+    }
+
+    /**
+     * @brief Mixes a value's bytes into a digest
+     */
+    template<typename T>
+    uint64_t mix(uint64_t digest, const T &value) noexcept {
+        return Moonshine::hash_bytes(&value, sizeof(value), digest);
+    }
+}
+
+DecoderState::DecoderState() = default;
+DecoderState::DecoderState(DecoderState &&) noexcept = default;
+DecoderState &DecoderState::operator=(DecoderState &&) noexcept = default;
+DecoderState::~DecoderState() = default;
+
+size_t DecoderState::get_tensor_bytes() const {
+    size_t count = 0;
+
+    if (!encoder_output.empty()) {
+        count += encoder_output.front().GetTensorTypeAndShapeInfo().GetElementCount();
+    }
+
+    for (const auto &value : past_key_values) {
+        count += value.GetTensorTypeAndShapeInfo().GetElementCount();
+    }
+
+    return count * sizeof(float);
+}
+
+std::string DecoderState::serialize(bool half_precision) const {
+    if (encoder_output.empty()) {
+        throw std::runtime_error("Decoder state is empty");
+    }
+
+    BlobWriter writer;
+    writer.data().reserve(64 + tokens.size() * sizeof(int32_t) + get_tensor_bytes() / (half_precision ? 2 : 1));
+
+    writer.put<uint32_t>(decoder_state_magic);
+    writer.put<uint32_t>(decoder_state_version);
+    writer.put<uint8_t>(half_precision ? 1 : 0);
+    writer.put<uint8_t>(finished ? 1 : 0);
+    writer.put<uint8_t>(static_cast<uint8_t>(stop_reason));
+    writer.put<int64_t>(next_input);
+    writer.put<uint64_t>(max_len);
+    writer.put<uint64_t>(steps);
+
+    writer.put<uint32_t>(static_cast<uint32_t>(tokens.size()));
+
+    for (int token : tokens) {
+        writer.put<int32_t>(token);
+    }
+
+    // Only the (possibly trimmed) hidden state is needed; the entries after
+    // it merely keep the buffer behind a trimmed view alive.
+    put_tensor(writer, encoder_output.front(), half_precision);
+    writer.put<uint32_t>(static_cast<uint32_t>(past_key_values.size()));
+
+    for (const auto &value : past_key_values) {
+        put_tensor(writer, value, half_precision);
+    }
+
+    return std::move(writer.data());
+}
+
+DecoderState DecoderState::deserialize(const std::string &blob) {
+    BlobReader reader(blob);
+
+    if (blob.size() < 2 * sizeof(uint32_t) || reader.take<uint32_t>() != decoder_state_magic) {
+        throw std::runtime_error("Not a decoder state");
+    }
+
+    auto blob_version = reader.take<uint32_t>();
+
+    if (blob_version != decoder_state_version) {
+        throw std::runtime_error("Unsupported decoder state version " + std::to_string(blob_version));
+    }
+
+    DecoderState state;
+    bool half_precision = reader.take<uint8_t>() != 0;
+    state.finished = reader.take<uint8_t>() != 0;
+    state.stop_reason = reader.take_enum(StopReason::Error);
+    state.next_input = reader.take<int64_t>();
+    state.max_len = reader.take<uint64_t>();
+    state.steps = reader.take<uint64_t>();
+
+    auto token_count = reader.take<uint32_t>();
+
+    if (token_count > reader.remaining() / sizeof(int32_t)) {
+        throw std::runtime_error("Blob is truncated");
+    }
+
+    state.tokens.resize(token_count);
+
+    for (auto &token : state.tokens) {
+        token = reader.take<int32_t>();
+    }
+
+    state.encoder_output.emplace_back(take_tensor(reader, half_precision));
+    auto kv_count = reader.take<uint32_t>();
+
+    for (uint32_t i = 0; i < kv_count; i++) {
+        state.past_key_values.emplace_back(take_tensor(reader, half_precision));
+    }
+
+    return state;
+}
+
+/**
+ * @struct OnnxModel::EncoderCache
+ * @brief Bounded LRU cache of encoder outputs keyed by a hash of the audio
+ */
+struct OnnxModel::EncoderCache {
+    using Entry = std::pair<uint64_t, EncodedAudioHandle>;
+
+    size_t max_bytes;                   /**< Memory budget for cached outputs */
+    bool half_precision;                /**< Store outputs as fp16 */
+    size_t bytes = 0;                   /**< Current size of cached outputs */
+    std::list<Entry> lru;               /**< Entries, most recent first */
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index;  /**< Entries by audio key */
+    std::mutex mutex;                   /**< Guards all members */
+};
+
+/**
+ * @struct OnnxModel::ProfilingState
+ * @brief Run counts and finished profile files of the profiled sessions
+ */
+struct OnnxModel::ProfilingState {
+    ProfilingOptions options;                   /**< Run limits */
+    std::atomic<size_t> encoder_runs{0};        /**< Encoder runs so far */
+    std::atomic<size_t> decoder_runs{0};        /**< Decoder runs so far */
+    std::mutex mutex;                           /**< Guards the files below */
+    f_path encoder_file;                        /**< Encoder profile, empty while profiling */
+    f_path decoder_file;                        /**< Decoder profile, empty while profiling */
+};
+
+/**
+ * @struct OnnxModel::SpinState
+ * @brief Spinning copies of the sessions and the request rate that selects them
+ *
+ * Keeps its own reference to the prepacked weights so they outlive the
+ * spinning sessions when a model is move-assigned.
+ */
+struct OnnxModel::SpinState {
+    /**
+     * @class Run
+     * @brief Routes one session run and tracks when the spinning sessions go idle
+     */
+    class Run {
+    public:
+        explicit Run(SpinState *state) noexcept
+            : state(state),
+              spinning(state && state->spinning.load(std::memory_order_relaxed))
+        {
+            if (!spinning) {
+                return;
+            }
+
+            if (state->active_runs.fetch_add(1) == 0) {
+                state->end_idle();
+            }
+
+            auto &metrics = Metrics::instance();
+
+            if (metrics.is_enabled()) {
+                metrics.spin_runs.add();
+            }
+        }
+
+        ~Run() {
+            if (spinning && state->active_runs.fetch_sub(1) == 1) {
+                state->idle_since_ms.store(state->thread_cpu_ms());
+            }
+        }
+
+        Run(const Run &) = delete;
+        Run &operator=(const Run &) = delete;
+
+        /**
+         * @brief Checks whether the run goes to a spinning session
+         */
+        bool is_spinning() const noexcept { return spinning; }
+
+    private:
+        SpinState *state;   /**< Null without adaptive spin */
+        bool spinning;      /**< Routed to a spinning session */
+    };
+
+    /**
+     * @struct Thread
+     * @brief Intra-op worker of a spinning session, created by create_thread()
+     */
+    struct Thread {
+        SpinState *state;       /**< Owner of the thread list */
+        std::thread thread;     /**< Runs ORT's worker function */
+        bool joining = false;   /**< Left out of thread_cpu_ms() once set */
+    };
+
+    /**
+     * @brief Starts an intra-op worker for a spinning session and records it
+     *
+     * Registered as the spinning sessions' OrtCustomCreateThreadFn so their
+     * CPU time can be read per thread.
+     */
+    static OrtCustomThreadHandle create_thread(void *options, OrtThreadWorkerFn worker, void *param) noexcept {
+        auto *state = static_cast<SpinState *>(options);
+        std::lock_guard<std::mutex> lock(state->threads_mutex);
+
+        try {
+            state->threads.push_back({state, {}});
+        } catch (const std::exception &) {
+            return nullptr;
+        }
+
+        try {
+            state->threads.back().thread = std::thread(worker, param);
+        } catch (const std::exception &) {
+            state->threads.pop_back();
+            return nullptr;
+        }
+
+        return reinterpret_cast<OrtCustomThreadHandle>(&state->threads.back());
+    }
+
+    /**
+     * @brief Joins a worker started by create_thread() and forgets it
+     */
+    static void join_thread(OrtCustomThreadHandle handle) noexcept {
+        auto *worker = reinterpret_cast<Thread *>(handle);
+        auto *state = worker->state;
+
+        {
+            std::lock_guard<std::mutex> lock(state->threads_mutex);
+            worker->joining = true;
+        }
+
+        worker->thread.join();
+
+        std::lock_guard<std::mutex> lock(state->threads_mutex);
+        state->threads.remove_if([worker](const Thread &t) { return &t == worker; });
+    }
+
+    /**
+     * @brief Gets the CPU time consumed by the spinning sessions' intra-op workers
+     * @return double CPU time in milliseconds, or 0 where per-thread clocks are unsupported
+     */
+    double thread_cpu_ms() noexcept {
+        double total = 0.0;
+#if defined(__unix__)
+        std::lock_guard<std::mutex> lock(threads_mutex);
+
+        for (auto &worker : threads) {
+            clockid_t clock;
+            timespec ts;
+
+            if (!worker.joining && pthread_getcpuclockid(worker.thread.native_handle(), &clock) == 0 &&
+                clock_gettime(clock, &ts) == 0)
+            {
+                total += ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+            }
+        }
+#endif
+        return total;
+    }
+
+    /**
+     * @brief Charges the CPU the intra-op workers used since they went idle to the spin cost
+     */
+    void end_idle() noexcept {
+        double since = idle_since_ms.exchange(-1.0);
+        auto &metrics = Metrics::instance();
+
+        if (since >= 0.0 && metrics.is_enabled()) {
+            metrics.spin_idle_cpu_microseconds.add(
+                static_cast<uint64_t>(std::max(0.0, thread_cpu_ms() - since) * 1000.0));
+        }
+    }
+
+    std::mutex threads_mutex;                               /**< Guards threads */
+    std::list<Thread> threads;                              /**< Intra-op workers, outlive the sessions below */
+    AdaptiveSpin options;                                   /**< Switching thresholds */
+    std::shared_ptr<Ort::PrepackedWeightsContainer> prepacked_weights;  /**< Outlives the sessions below */
+    Ort::Session encoder{nullptr};                          /**< Spinning encoder */
+    Ort::Session decoder{nullptr};                          /**< Spinning decoder */
+    Ort::Session shortlist_decoder{nullptr};                /**< Spinning shortlist decoder, null when disabled */
+
+    std::mutex mutex;                                       /**< Guards rate and last_arrival */
+    double rate = 0.0;                                      /**< Decaying requests per second */
+    std::chrono::steady_clock::time_point last_arrival;     /**< Time of the last counted request */
+    std::atomic<bool> spinning{false};                      /**< Where runs currently go */
+    std::atomic<int> active_runs{0};                        /**< Runs in flight on spinning sessions */
+    std::atomic<double> idle_since_ms{-1.0};                /**< Worker CPU time when they went idle, -1 while busy */
+};
+
 OnnxModel::OnnxModel(const f_path &encoder_path,
                      const f_path &decoder_path,
                      const int64_t num_layers,
                      const int64_t num_kv_heads,
                      const int64_t head_dim,
-                     const int num_threads,
+                     const ModelOptions &options,
                      Ort::Env env,
                      Ort::MemoryInfo memory_info)
     : num_layers(num_layers),
@@ -54,7 +461,8 @@ OnnxModel::OnnxModel(const f_path &encoder_path,
       env(std::move(env)),
       memory_info(std::move(memory_info)),
       encoder(nullptr),
-      decoder(nullptr)
+      decoder(nullptr),
+      shortlist_decoder(nullptr)
 {
     if (!std::filesystem::is_regular_file(encoder_path)) {
         throw std::runtime_error("Encoder path is not a regular file: " + encoder_path.string());
@@ -64,31 +472,204 @@ OnnxModel::OnnxModel(const f_path &encoder_path,
         throw std::runtime_error("Decoder path is not a regular file: " + decoder_path.string());
     }
 
-    Ort::SessionOptions options;
-    options.SetIntraOpNumThreads(num_threads);
-    options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
-    options.DisableCpuMemArena();
+    Ort::SessionOptions session_options;
+    // ORT's own default for 0 counts the host's cores and ignores cgroup quotas
+    int num_threads = options.num_threads > 0 ? options.num_threads : get_resource_limits().get_default_threads();
+    session_options.SetIntraOpNumThreads(num_threads);
+    intra_op_threads = num_threads;
+    session_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+
+    if (options.cpu_mem_arena) {
+        session_options.EnableCpuMemArena();
+    } else {
+        session_options.DisableCpuMemArena();
+    }
+
+    if (options.track_memory) {
+        // Replaces the arena too: sessions allocate straight from the env allocator
+        register_tracking_allocator(this->env);
+        session_options.AddConfigEntry("session.use_env_allocators", "1");
+        track_memory = true;
+    }
+
+    Ort::SessionOptions spin_options = session_options.Clone();
+
+    if (options.adaptive_spin) {
+        // Two configurations of the same graphs; prepacked weights are shared
+        // between them rather than packed twice.
+        session_options.AddConfigEntry("session.intra_op.allow_spinning", "0");
+        spin_options.AddConfigEntry("session.intra_op.allow_spinning", "1");
+        prepacked_weights = std::make_shared<Ort::PrepackedWeightsContainer>();
+
+        spin = std::make_unique<SpinState>();
+        spin->options = *options.adaptive_spin;
+        spin->prepacked_weights = prepacked_weights;
+
+        spin_options.SetCustomCreateThreadFn(&SpinState::create_thread);
+        spin_options.SetCustomThreadCreationOptions(spin.get());
+        spin_options.SetCustomJoinThreadFn(&SpinState::join_thread);
+    }
+
+    Ort::SessionOptions encoder_options = session_options.Clone();
+    Ort::SessionOptions decoder_options = session_options.Clone();
+    Ort::SessionOptions shortlist_options = session_options.Clone();
 
-    encoder = Ort::Session(this->env, encoder_path.c_str(), options);
-    decoder = Ort::Session(this->env, decoder_path.c_str(), options);
+    if (options.profiling) {
+        profiling = std::make_unique<ProfilingState>();
+        profiling->options = *options.profiling;
 
+        auto prefix = options.profiling->output_prefix.string();
+        encoder_options.EnableProfiling(f_path(prefix + "_encoder").c_str());
+        decoder_options.EnableProfiling(f_path(prefix + "_decoder").c_str());
+    }
+
+    auto load = [&](const f_path &path, const Ort::SessionOptions &session_opts) {
+        if (prepacked_weights) {
+            return Ort::Session(this->env, path.c_str(), session_opts, *prepacked_weights);
+        }
+
+        return Ort::Session(this->env, path.c_str(), session_opts);
+    };
+
+    // Builds a session, optionally preceded by throwaway builds without
+    // prepacking, and without optimization either, to split its cost.
+    auto build = [&](const f_path &path, const Ort::SessionOptions &session_opts, SessionStartup &report) {
+        StartupPhase optimized;
+
+        if (options.split_startup) {
+            Ort::SessionOptions unpacked = session_opts.Clone();
+            unpacked.DisableProfiling();
+            unpacked.AddConfigEntry("session.disable_prepacking", "1");
+
+            Ort::SessionOptions bare = unpacked.Clone();
+            bare.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_DISABLE_ALL);
+
+            // Untimed, so the timed builds below all find the file cached
+            Ort::Session(this->env, path.c_str(), bare);
+
+            StartupTimer timer;
+            Ort::Session(this->env, path.c_str(), bare);
+            report.graph_load = timer.elapsed();
+
+            timer.restart();
+            Ort::Session(this->env, path.c_str(), unpacked);
+            optimized = timer.elapsed();
+            report.optimization = optimized.minus(report.graph_load);
+        }
+
+        StartupTimer timer;
+        auto session = load(path, session_opts);
+        report.total = timer.elapsed();
+
+        if (options.split_startup) {
+            report.prepacking = report.total.minus(optimized);
+        }
+
+        return session;
+    };
+
+    startup.sessions_split = options.split_startup;
+    encoder = build(encoder_path, encoder_options, startup.encoder);
+    decoder = build(decoder_path, decoder_options, startup.decoder);
+
+    if (spin) {
+        spin->encoder = load(encoder_path, spin_options);
+        spin->decoder = load(decoder_path, spin_options);
+    }
+
+    if (options.shortlist) {
+        options.shortlist->validate();
+
+        if (!std::filesystem::is_regular_file(options.shortlist->decoder_path)) {
+            throw std::runtime_error("Shortlist decoder path is not a regular file: "
+                                     + options.shortlist->decoder_path.string());
+        }
+
+        shortlist_decoder = load(options.shortlist->decoder_path, shortlist_options);
+
+        if (spin) {
+            spin->shortlist_decoder = load(options.shortlist->decoder_path, spin_options);
+        }
+
+        if (shortlist_decoder.GetInputCount() != decoder.GetInputCount() ||
+            shortlist_decoder.GetOutputCount() != decoder.GetOutputCount())
+        {
+            throw std::runtime_error("Shortlist decoder inputs and outputs do not match the decoder");
+        }
+
+        auto logits_shape = shortlist_decoder.GetOutputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+
+        if (!logits_shape.empty() && logits_shape.back() > 0 &&
+            static_cast<size_t>(logits_shape.back()) != options.shortlist->token_ids.size())
+        {
+            throw std::runtime_error("Shortlist decoder logits do not match the shortlist size");
+        }
+
+        shortlist = options.shortlist;
+    }
+
+    StartupTimer io_timer;
     initialize_model_io_names();
+    startup.io_names = io_timer.elapsed();
+
+    silence_compaction = options.silence_compaction;
+    update_output_identity();
+
+    if (!options.encoder_buckets.empty()) {
+        set_encoder_buckets(options.encoder_buckets);
+    }
 }
 
 OnnxModel OnnxModel::Base(const f_path &encoder_path,
                           const f_path &decoder_path,
                           const int num_threads)
 {
-    return OnnxModel(encoder_path, decoder_path, 8, 8, 52, num_threads);
+    return Base(encoder_path, decoder_path, ModelOptions{num_threads, std::nullopt});
+}
+
+OnnxModel OnnxModel::Base(const f_path &encoder_path,
+                          const f_path &decoder_path,
+                          const ModelOptions &options)
+{
+    return create(encoder_path, decoder_path, 8, 8, 52, options);
 }
 
 OnnxModel OnnxModel::Tiny(const f_path &encoder_path,
                           const f_path &decoder_path,
                           const int num_threads)
 {
-    return OnnxModel(encoder_path, decoder_path, 6, 8, 36, num_threads);
+    return Tiny(encoder_path, decoder_path, ModelOptions{num_threads, std::nullopt});
 }
 
+OnnxModel OnnxModel::Tiny(const f_path &encoder_path,
+                          const f_path &decoder_path,
+                          const ModelOptions &options)
+{
+    return create(encoder_path, decoder_path, 6, 8, 36, options);
+}
+
+OnnxModel OnnxModel::create(const f_path &encoder_path,
+                            const f_path &decoder_path,
+                            const int64_t num_layers,
+                            const int64_t num_kv_heads,
+                            const int64_t head_dim,
+                            const ModelOptions &options)
+{
+    StartupTimer timer;
+    Ort::Env env = default_env();
+    StartupPhase env_phase = timer.elapsed();
+
+    OnnxModel model(encoder_path, decoder_path, num_layers, num_kv_heads, head_dim, options, std::move(env));
+    model.startup.env = env_phase;
+    model.startup.total = timer.elapsed();
+
+    return model;
+}
+
+OnnxModel::OnnxModel(OnnxModel &&) noexcept = default;
+OnnxModel &OnnxModel::operator=(OnnxModel &&) noexcept = default;
+OnnxModel::~OnnxModel() = default;
+
 void OnnxModel::initialize_model_io_names() {
     for (size_t i = 0; i < encoder.GetInputCount(); i++) {
         auto input_name = encoder.GetInputNameAllocated(i, model_name_allocator);
@@ -115,26 +696,422 @@ void OnnxModel::initialize_model_io_names() {
     }
 }
 
+bool OnnxModel::is_spinning() const noexcept {
+    return spin && spin->spinning.load(std::memory_order_relaxed);
+}
+
+std::string OnnxModel::get_config() const {
+    std::ostringstream out;
+    out << "threads=" << intra_op_threads << " compaction=";
+
+    if (silence_compaction) {
+        out << "rms:" << silence_compaction->silence_rms
+            << ",pause:" << silence_compaction->min_pause_ms
+            << ",gap:" << silence_compaction->kept_gap_ms
+            << ",trim:" << silence_compaction->trim_edges;
+    } else {
+        out << "off";
+    }
+
+    out << " shortlist=";
+
+    if (shortlist) {
+        out << shortlist->decoder_path.string() << ",tokens:" << shortlist->token_ids.size()
+            << ",min_logit:" << shortlist->min_logit;
+    } else {
+        out << "off";
+    }
+
+    out << " buckets=";
+
+    for (size_t i = 0; i < encoder_buckets.size(); i++) {
+        out << (i > 0 ? "," : "") << encoder_buckets[i];
+    }
+
+    if (encoder_buckets.empty()) {
+        out << "off";
+    }
+
+    out << " spin=";
+
+    if (spin) {
+        out << "above:" << spin->options.spin_above_rps
+            << ",below:" << spin->options.idle_below_rps
+            << ",window:" << spin->options.window_s;
+    } else {
+        out << "off";
+    }
+
+    return out.str();
+}
+
+void OnnxModel::note_request() {
+    if (!spin) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(spin->mutex);
+    auto now = std::chrono::steady_clock::now();
+    double window = std::max(spin->options.window_s, 1e-3);
+
+    if (spin->last_arrival != std::chrono::steady_clock::time_point{}) {
+        std::chrono::duration<double> gap = now - spin->last_arrival;
+        spin->rate *= std::exp(-gap.count() / window);
+    }
+
+    spin->rate += 1.0 / window;
+    spin->last_arrival = now;
+
+    bool spinning = spin->spinning.load(std::memory_order_relaxed);
+    bool want = spinning ? spin->rate >= spin->options.idle_below_rps
+                         : spin->rate >= spin->options.spin_above_rps;
+
+    if (want == spinning) {
+        return;
+    }
+
+    spin->spinning.store(want, std::memory_order_relaxed);
+
+    if (!want) {
+        spin->end_idle();
+    }
+
+    auto &metrics = Metrics::instance();
+
+    if (metrics.is_enabled()) {
+        metrics.spin_switches.add();
+    }
+}
+
 std::vector<int> OnnxModel::run(std::vector<float> &audio_data) noexcept {
-    double audio_len = static_cast<double>(audio_data.size()) / sample_rate;
+    std::vector<float> compacted;
+
+    if (silence_compaction) {
+        compacted = compact_silence(audio_data, *silence_compaction);
+    }
+
+    auto &audio = silence_compaction ? compacted : audio_data;
+    double audio_len = static_cast<double>(audio.size()) / sample_rate;
     size_t max_len = std::round(audio_len * max_tokens_per_second);
 
-    auto last_hidden_state = encode(audio_data);
+    auto last_hidden_state = run_encoder(audio);
     return decode(std::move(last_hidden_state.at(0)), max_len);
 }
 
-std::vector<Ort::Value> OnnxModel::encode(std::vector<float> &audio_data) {
-    std::vector<int64_t> encoder_input_shape = {1, static_cast<int64_t>(audio_data.size())};
+void OnnxModel::run(std::vector<float> &audio_data, TranscriptionResult &result, bool collect_timings) noexcept {
+    result.timings_collected = collect_timings && MOONSHINE_ENABLE_TIMINGS;
+
+    // Compaction is input preparation; run_encoder() adds the tensor setup
+    StageTimer prep_timer(result.timings_collected);
+    std::vector<float> compacted;
+
+    if (silence_compaction) {
+        compacted = compact_silence(audio_data, *silence_compaction);
+        result.compacted_samples = audio_data.size() - compacted.size();
+    }
+
+    result.input_prep = prep_timer.elapsed();
+
+    auto &audio = silence_compaction ? compacted : audio_data;
+    double audio_len = static_cast<double>(audio.size()) / sample_rate;
+    size_t max_len = std::round(audio_len * max_tokens_per_second);
+
+    std::optional<MemoryScope> memory;
+
+    if (track_memory) {
+        memory.emplace();
+        result.memory_collected = true;
+        result.memory = {};
+    }
+
+    try {
+        auto last_hidden_state = run_encoder(audio, &result);
+
+        if (memory) {
+            result.memory.encoder_peak_bytes = memory->get_peak_bytes();
+            result.memory.encoder_output_bytes = memory->get_live_bytes();
+        }
+
+        result.tokens = decode(std::move(last_hidden_state.at(0)), max_len, &result);
+    } catch (const std::exception &) {
+        result.tokens.clear();
+        result.stop_reason = StopReason::Error;
+    }
+
+    if (memory) {
+        result.memory.transient_peak_bytes = memory->get_host_peak_bytes();
+        result.memory.peak_bytes = memory->get_max_bytes();
+    }
+
+    if (result.timings_collected && !result.decode_step_timings.empty()) {
+        result.time_to_first_token_ms = result.input_prep.wall_ms
+                                      + result.encode.wall_ms
+                                      + result.decode_step_timings.front().wall_ms;
+    }
+}
+
+EncodedAudioHandle OnnxModel::encode(const std::vector<float> &audio_data) {
+    // Hashing reads every sample, so it is skipped without a cache
+    std::optional<uint64_t> key;
+    bool half_precision = false;
+
+    if (encoder_cache) {
+        key = hash_samples(audio_data, audio_data.size());
+
+        std::lock_guard<std::mutex> lock(encoder_cache->mutex);
+        auto it = encoder_cache->index.find(*key);
+
+        if (it != encoder_cache->index.end()) {
+            encoder_cache->lru.splice(encoder_cache->lru.begin(), encoder_cache->lru, it->second);
+            return it->second->second;
+        }
+
+        half_precision = encoder_cache->half_precision;
+    }
+
+    std::vector<float> compacted;
+
+    if (silence_compaction) {
+        compacted = compact_silence(audio_data, *silence_compaction);
+    }
+
+    auto &audio = silence_compaction ? compacted : const_cast<std::vector<float> &>(audio_data);
+    auto output = run_encoder(audio);
+    auto &last_hidden_state = output.at(0);
+    auto info = last_hidden_state.GetTensorTypeAndShapeInfo();
+    const float *p_data = last_hidden_state.GetTensorData<float>();
+    size_t count = info.GetElementCount();
+
+    auto encoded = std::make_shared<EncodedAudio>();
+    encoded->shape = info.GetShape();
+    encoded->sample_count = audio.size();
+
+    if (half_precision) {
+        encoded->half_data.resize(count);
+        std::transform(p_data, p_data + count, encoded->half_data.begin(), float_to_half);
+    } else {
+        encoded->data.assign(p_data, p_data + count);
+    }
+
+    if (encoder_cache && key) {
+        std::lock_guard<std::mutex> lock(encoder_cache->mutex);
+
+        if (encoder_cache->index.find(*key) == encoder_cache->index.end() &&
+            encoded->get_size_bytes() <= encoder_cache->max_bytes)
+        {
+            encoder_cache->lru.emplace_front(*key, encoded);
+            encoder_cache->index[*key] = encoder_cache->lru.begin();
+            encoder_cache->bytes += encoded->get_size_bytes();
+
+            while (encoder_cache->bytes > encoder_cache->max_bytes) {
+                auto &oldest = encoder_cache->lru.back();
+                encoder_cache->bytes -= oldest.second->get_size_bytes();
+                encoder_cache->index.erase(oldest.first);
+                encoder_cache->lru.pop_back();
+            }
+        }
+    }
+
+    return encoded;
+}
+
+std::vector<int> OnnxModel::decode(const EncodedAudioHandle &encoded, const DecodeOptions &options) {
+    if (!encoded) {
+        throw std::invalid_argument("Encoded audio handle is empty");
+    }
+
+    double audio_len = static_cast<double>(encoded->sample_count) / sample_rate;
+    size_t max_len = options.max_tokens.value_or(std::round(audio_len * options.max_tokens_per_second));
+
+    // The decoder only reads its inputs, so the handle's storage can be
+    // wrapped without a copy when it is already fp32.
+    std::vector<float> widened;
+    float *p_data = const_cast<float *>(encoded->data.data());
+    size_t count = encoded->data.size();
+
+    if (encoded->is_half_precision()) {
+        widened.resize(encoded->half_data.size());
+        std::transform(encoded->half_data.begin(), encoded->half_data.end(), widened.begin(), half_to_float);
+        p_data = widened.data();
+        count = widened.size();
+    }
+
+    auto last_hidden_state = Ort::Value::CreateTensor<float>(
+        memory_info,
+        p_data,
+        count,
+        encoded->shape.data(),
+        encoded->shape.size()
+    );
+
+    return decode(std::move(last_hidden_state), max_len);
+}
+
+void OnnxModel::set_encoder_cache(size_t max_bytes, bool half_precision) {
+    if (max_bytes == 0) {
+        encoder_cache.reset();
+        return;
+    }
+
+    encoder_cache = std::make_unique<EncoderCache>();
+    encoder_cache->max_bytes = max_bytes;
+    encoder_cache->half_precision = half_precision;
+}
+
+void OnnxModel::set_encoder_buckets(std::vector<size_t> bucket_sizes, bool warm_up) {
+    std::sort(bucket_sizes.begin(), bucket_sizes.end());
+    bucket_sizes.erase(std::unique(bucket_sizes.begin(), bucket_sizes.end()), bucket_sizes.end());
+    bucket_sizes.erase(std::remove(bucket_sizes.begin(), bucket_sizes.end(), 0), bucket_sizes.end());
+
+    encoder_buckets = std::move(bucket_sizes);
+    clear_encoder_cache();
+    update_output_identity();
+
+    if (warm_up) {
+        for (auto bucket : encoder_buckets) {
+            std::vector<float> silence(bucket, 0.0f);
+            run_encoder(silence);
+        }
+    }
+}
+
+void OnnxModel::set_silence_compaction(std::optional<SilenceCompaction> compaction) {
+    silence_compaction = std::move(compaction);
+    clear_encoder_cache();
+    update_output_identity();
+}
+
+void OnnxModel::update_output_identity() {
+    output_identity.clear();
+
+    if (silence_compaction) {
+        uint64_t digest = mix(0, silence_compaction->silence_rms);
+        digest = mix(digest, silence_compaction->min_pause_ms);
+        digest = mix(digest, silence_compaction->kept_gap_ms);
+        digest = mix(digest, silence_compaction->trim_edges);
+        output_identity += ":compaction@" + std::to_string(digest);
+    }
+
+    if (shortlist) {
+        std::error_code ec;
+        auto mtime = std::filesystem::last_write_time(shortlist->decoder_path, ec).time_since_epoch().count();
+        uint64_t digest = hash_string(std::filesystem::weakly_canonical(shortlist->decoder_path, ec).string());
+        digest = mix(digest, std::filesystem::file_size(shortlist->decoder_path, ec));
+        digest = mix(digest, mtime);
+        digest = hash_bytes(shortlist->token_ids.data(), shortlist->token_ids.size() * sizeof(int), digest);
+        digest = mix(digest, shortlist->min_logit);
+        output_identity += ":shortlist@" + std::to_string(digest);
+    }
+
+    if (!encoder_buckets.empty()) {
+        uint64_t digest = hash_bytes(encoder_buckets.data(), encoder_buckets.size() * sizeof(size_t));
+        output_identity += ":buckets@" + std::to_string(digest);
+    }
+}
+
+void OnnxModel::clear_encoder_cache() {
+    if (!encoder_cache) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(encoder_cache->mutex);
+    encoder_cache->lru.clear();
+    encoder_cache->index.clear();
+    encoder_cache->bytes = 0;
+}
+
+bool OnnxModel::check_encoder_buckets(const std::vector<float> &audio_data) {
+    auto &audio = const_cast<std::vector<float> &>(audio_data);
+    auto bucketed = run(audio);
+
+    std::vector<size_t> buckets;
+    std::swap(buckets, encoder_buckets);
+    auto unbucketed = run(audio);
+    std::swap(buckets, encoder_buckets);
+
+    return bucketed == unbucketed;
+}
+
+ProfileSummary OnnxModel::get_profile_summary() {
+    if (!profiling) {
+        throw std::runtime_error("Profiling is not enabled for this model");
+    }
+
+    std::lock_guard<std::mutex> lock(profiling->mutex);
+
+    end_profiling(true);
+    end_profiling(false);
+
+    size_t encoder_runs = std::min(profiling->encoder_runs.load(), profiling->options.max_encoder_runs);
+    size_t decoder_runs = std::min(profiling->decoder_runs.load(), profiling->options.max_decoder_runs);
+
+    ProfileSummary summary;
+    summary.encoder = summarize_ort_profile(profiling->encoder_file, encoder_runs);
+    summary.decoder = summarize_ort_profile(profiling->decoder_file, decoder_runs);
+
+    return summary;
+}
+
+void OnnxModel::count_profiled_run(bool is_encoder) {
+    auto &runs = is_encoder ? profiling->encoder_runs : profiling->decoder_runs;
+    size_t limit = is_encoder ? profiling->options.max_encoder_runs : profiling->options.max_decoder_runs;
+
+    if (runs.fetch_add(1) + 1 == limit) {
+        std::lock_guard<std::mutex> lock(profiling->mutex);
+        end_profiling(is_encoder);
+    }
+}
+
+void OnnxModel::end_profiling(bool is_encoder) {
+    auto &file = is_encoder ? profiling->encoder_file : profiling->decoder_file;
+
+    if (!file.empty()) {
+        return;
+    }
+
+    auto &session = is_encoder ? encoder : decoder;
+    auto profile_path = session.EndProfilingAllocated(model_name_allocator);
+    file = profile_path.get();
+}
+
+std::vector<Ort::Value> OnnxModel::run_encoder(std::vector<float> &audio_data,
+                                               TranscriptionResult *result)
+{
+    TraceSpan span("encode");
+    StageTimer timer(result && result->timings_collected);
+    auto bucket = std::lower_bound(encoder_buckets.begin(), encoder_buckets.end(), audio_data.size());
+    bool use_bucket = bucket != encoder_buckets.end() && *bucket != audio_data.size();
+
+    std::vector<float, TrackingAllocator<float>> padded;
+
+    if (use_bucket) {
+        padded.reserve(*bucket);
+        padded.assign(audio_data.begin(), audio_data.end());
+        padded.resize(*bucket, 0.0f);
+    }
+
+    float *input_data = use_bucket ? padded.data() : audio_data.data();
+    size_t input_size = use_bucket ? padded.size() : audio_data.size();
+    std::vector<int64_t> encoder_input_shape = {1, static_cast<int64_t>(input_size)};
 
     auto in_tensor = Ort::Value::CreateTensor<float>(
         memory_info,
-        audio_data.data(),
-        audio_data.size(),
+        input_data,
+        input_size,
         encoder_input_shape.data(),
         encoder_input_shape.size()
     );
 
-    return encoder.Run(
+    if (result) {
+        auto prep = timer.elapsed();
+        result->input_prep.wall_ms += prep.wall_ms;
+        result->input_prep.cpu_ms += prep.cpu_ms;
+        timer.restart();
+    }
+
+    SpinState::Run route(spin.get());
+    auto &session = route.is_spinning() ? spin->encoder : encoder;
+    auto output = session.Run(
         Ort::RunOptions{nullptr},
         encoder_input_names.data(),
         &in_tensor,
@@ -142,30 +1119,139 @@ std::vector<Ort::Value> OnnxModel::encode(std::vector<float> &audio_data) {
         encoder_output_names.data(),
         encoder_output_names.size()
     );
+
+    if (profiling && !route.is_spinning()) {
+        count_profiled_run(true);
+    }
+
+    if (!use_bucket) {
+        if (result) {
+            result->encode = timer.elapsed();
+        }
+
+        return output;
+    }
+
+    // Drop the frames computed from padding. This does not undo the padding:
+    // the encoder's self-attention is not causal, so the real frames attended
+    // to it too and differ from an unpadded encode; check_encoder_buckets()
+    // exists to validate the transcripts. The hidden state is [1, frames, dim]
+    // in row-major order, so the real frames are a prefix of the buffer and can
+    // be exposed as a view. The view does not own its data, so the full output
+    // is kept alive behind it in the returned vector.
+    auto shape = output.at(0).GetTensorTypeAndShapeInfo().GetShape();
+    int64_t frames = shape.at(1);
+    int64_t real_frames = (frames * static_cast<int64_t>(audio_data.size()) + static_cast<int64_t>(*bucket) - 1)
+                        / static_cast<int64_t>(*bucket);
+    shape[1] = std::max<int64_t>(real_frames, 1);
+
+    std::vector<Ort::Value> trimmed;
+    trimmed.emplace_back(Ort::Value::CreateTensor<float>(
+        memory_info,
+        output.at(0).GetTensorMutableData<float>(),
+        shape[0] * shape[1] * shape[2],
+        shape.data(),
+        shape.size()
+    ));
+
+    for (auto &value : output) {
+        trimmed.emplace_back(std::move(value));
+    }
+
+    if (result) {
+        result->encode = timer.elapsed();
+    }
+
+    return trimmed;
 }
 
-std::vector<int> OnnxModel::decode(Ort::Value last_hidden_state, size_t max_len) {
+std::vector<int> OnnxModel::decode(Ort::Value last_hidden_state,
+                                   size_t max_len,
+                                   TranscriptionResult *result)
+{
+    TraceSpan span("decode");
     size_t max_token_count = std::max(max_len, min_token_count); // Ensure at least one token is generated
     auto past_key_values = initialize_past_key_values();
     std::vector<int> result_tokens{};
     std::vector<int64_t> cur_tokens{ start_token };
 
+    bool timed = result && result->timings_collected;
+    StageTimer decode_timer(timed);
+    StageTimer step_timer(timed);
+
+    if (result) {
+        result->stop_reason = StopReason::TokenBudget;
+        result->decode_steps = 0;
+
+        if (timed) {
+            result->decode_step_timings.reserve(max_token_count);
+        }
+    }
+
+    // Everything live past this point that was not live here belongs to the
+    // KV cache or to the step in progress.
+    MemoryScope *memory = result && result->memory_collected ? MemoryScope::current() : nullptr;
+    size_t memory_base = memory ? memory->get_live_bytes() : 0;
+
     for (size_t i = 0; i < max_token_count; i++) {
         bool use_cache_branch = i > 0;
 
+        step_timer.restart();
+
+        size_t held = 0;
+
+        if (memory) {
+            held = memory->get_live_bytes();
+            result->memory.kv_cache_bytes = std::max(result->memory.kv_cache_bytes, held - memory_base);
+            memory->reset_peak();
+        }
+
+        bool shortlisted = shortlist.has_value();
+
         auto output = decode_next_token(
             cur_tokens,
             last_hidden_state,
             past_key_values,
-            use_cache_branch
+            use_cache_branch,
+            shortlisted
         );
 
-        auto next_token = get_next_token(std::move(output.at(0)));
+        size_t with_logits = 0;
+
+        if (memory) {
+            result->memory.decoder_step_peak_bytes = std::max(result->memory.decoder_step_peak_bytes,
+                                                              memory->get_peak_bytes() - held);
+            with_logits = memory->get_live_bytes();
+        }
+
+        bool fell_back = false;
+        int next_token = select_token(output, cur_tokens, last_hidden_state, past_key_values,
+                                      use_cache_branch, fell_back);
+
+        if (fell_back && result) {
+            result->shortlist_fallbacks++;
+        }
+
+        if (memory && !fell_back) {
+            result->memory.logits_bytes = std::max(result->memory.logits_bytes, with_logits - memory->get_live_bytes());
+        }
 
         cur_tokens.clear();
         cur_tokens.push_back(next_token);
 
+        if (result) {
+            result->decode_steps++;
+        }
+
         if (next_token == end_token) {
+            if (result) {
+                result->stop_reason = StopReason::EndToken;
+
+                if (timed) {
+                    result->decode_step_timings.push_back(step_timer.elapsed());
+                }
+            }
+
             break;
         }
 
@@ -178,16 +1264,132 @@ std::vector<int> OnnxModel::decode(Ort::Value last_hidden_state, size_t max_len)
         }
 
         update_kv_cache(past_key_values, present_kv, use_cache_branch);
+
+        if (timed) {
+            result->decode_step_timings.push_back(step_timer.elapsed());
+        }
+    }
+
+    if (memory) {
+        result->memory.kv_cache_bytes = std::max(result->memory.kv_cache_bytes,
+                                                 memory->get_live_bytes() - memory_base);
+    }
+
+    if (timed) {
+        result->decode = decode_timer.elapsed();
     }
 
     return result_tokens;
 }
 
+DecoderState OnnxModel::start_decode(const std::vector<float> &audio_data, const DecodeOptions &options) {
+    std::vector<float> compacted;
+
+    if (silence_compaction) {
+        compacted = compact_silence(audio_data, *silence_compaction);
+    }
+
+    auto &audio = silence_compaction ? compacted : const_cast<std::vector<float> &>(audio_data);
+    double audio_len = static_cast<double>(audio.size()) / sample_rate;
+    size_t max_len = options.max_tokens.value_or(std::round(audio_len * options.max_tokens_per_second));
+
+    DecoderState state;
+    state.encoder_output = run_encoder(audio);
+    state.past_key_values = initialize_past_key_values();
+    state.next_input = start_token;
+    state.max_len = std::max(max_len, min_token_count);
+
+    return state;
+}
+
+bool OnnxModel::continue_decode(DecoderState &state, size_t max_steps) {
+    TraceSpan span("continue_decode");
+    size_t expected_kv = std::count_if(decoder_input_names.begin(), decoder_input_names.end(), [](const char *name) {
+        return std::string(name).find("past_key_values") != std::string::npos;
+    });
+
+    if (state.encoder_output.empty() || state.past_key_values.size() != expected_kv) {
+        throw std::runtime_error("Decoder state does not match this model");
+    }
+
+    for (size_t n = 0; n < max_steps && !state.finished; n++) {
+        if (state.steps >= state.max_len) {
+            state.finished = true;
+            state.stop_reason = StopReason::TokenBudget;
+            break;
+        }
+
+        bool use_cache_branch = state.steps > 0;
+        std::vector<int64_t> cur_tokens{state.next_input};
+        auto output = decode_next_token(cur_tokens, state.encoder_output.at(0), state.past_key_values,
+                                        use_cache_branch, shortlist.has_value());
+
+        bool fell_back = false;
+        int next_token = select_token(output, cur_tokens, state.encoder_output.at(0), state.past_key_values,
+                                      use_cache_branch, fell_back);
+        state.steps++;
+
+        if (next_token == end_token) {
+            state.finished = true;
+            state.stop_reason = StopReason::EndToken;
+            break;
+        }
+
+        state.tokens.push_back(next_token);
+        state.next_input = next_token;
+
+        std::vector<Ort::Value> present_kv;
+
+        for (auto out_iter = output.begin() + 1; out_iter != output.end(); ++out_iter) {
+            present_kv.emplace_back(std::move(*out_iter));
+        }
+
+        update_kv_cache(state.past_key_values, present_kv, use_cache_branch);
+    }
+
+    if (!state.finished && state.steps >= state.max_len) {
+        state.finished = true;
+        state.stop_reason = StopReason::TokenBudget;
+    }
+
+    return state.finished;
+}
+
+int OnnxModel::select_token(std::vector<Ort::Value> &output,
+                            std::vector<int64_t> &cur_tokens,
+                            Ort::Value &last_hidden_state,
+                            std::vector<Ort::Value> &past_key_values,
+                            bool use_cache_branch,
+                            bool &fell_back)
+{
+    fell_back = false;
+
+    if (!shortlist) {
+        return get_next_token(std::move(output.at(0)));
+    }
+
+    auto best = best_logit(output.at(0));
+    output.at(0) = Ort::Value(nullptr);
+
+    if (auto token = shortlist->select(best.first, best.second)) {
+        return *token;
+    }
+
+    // No confident shortlisted token; the full decoder takes the same
+    // inputs, so the step is simply rerun over every token.
+    fell_back = true;
+    output = decode_next_token(cur_tokens, last_hidden_state, past_key_values, use_cache_branch);
+
+    return get_next_token(std::move(output.at(0)));
+}
+
 std::vector<Ort::Value> OnnxModel::decode_next_token(std::vector<int64_t> &cur_tokens,
                                                      Ort::Value &last_hidden_state,
                                                      std::vector<Ort::Value> &past_key_values,
-                                                     bool use_cache_branch)
+                                                     bool use_cache_branch,
+                                                     bool shortlisted)
 {
+    TraceSpan span("decode_next_token");
     std::vector<Ort::Value> decoder_inputs;
 
     std::array<int64_t, 2> dec_input_ids_shape{1, static_cast<int64_t>(cur_tokens.size())};
@@ -215,7 +1417,10 @@ std::vector<Ort::Value> OnnxModel::decode_next_token(std::vector<int64_t> &cur_t
         dec_use_cache_branch_shape.size()
     ));
 
-    return decoder.Run(
+    SpinState::Run route(spin.get());
+    auto &blocking = shortlisted ? shortlist_decoder : decoder;
+    auto &session = !route.is_spinning() ? blocking : shortlisted ? spin->shortlist_decoder : spin->decoder;
+    auto output = session.Run(
         Ort::RunOptions{nullptr},
         decoder_input_names.data(),
         decoder_inputs.data(),
@@ -223,6 +1428,12 @@ std::vector<Ort::Value> OnnxModel::decode_next_token(std::vector<int64_t> &cur_t
         decoder_output_names.data(),
         decoder_output_names.size()
     );
+
+    if (profiling && !shortlisted && !route.is_spinning()) {
+        count_profiled_run(false);
+    }
+
+    return output;
 }
 
 std::vector<Ort::Value> OnnxModel::initialize_past_key_values() {
@@ -251,6 +1462,7 @@ void OnnxModel::update_kv_cache(std::vector<Ort::Value> &cache,
                                 std::vector<Ort::Value> &new_values,
                                 bool use_cache_branch)
 {
+    TraceSpan span("update_kv_cache");
     auto cache_iter = cache.begin();
     auto new_iter = new_values.begin();
 
@@ -269,6 +1481,7 @@ void OnnxModel::update_kv_cache(std::vector<Ort::Value> &cache,
 }
 
 int OnnxModel::get_next_token(Ort::Value logits) {
+    TraceSpan span("get_next_token");
     auto shape = logits.GetTensorTypeAndShapeInfo().GetShape();
 
     // Validate the shape is as expected [1,1,vocabulary_size]
@@ -278,10 +1491,24 @@ int OnnxModel::get_next_token(Ort::Value logits) {
 
     int64_t vocab_size = shape[2];
     const float *p_logit_data = logits.GetTensorData<float>();
-    std::vector<float> logit_vec(p_logit_data, p_logit_data + vocab_size);
+    std::vector<float, TrackingAllocator<float>> logit_vec(p_logit_data, p_logit_data + vocab_size);
 
     // Find the index of the maximum value in the logits
     return std::distance(logit_vec.begin(), std::max_element(logit_vec.begin(), logit_vec.end()));
 }
 
+std::pair<size_t, float> OnnxModel::best_logit(Ort::Value &logits) {
+    TraceSpan span("best_logit");
+    auto shape = logits.GetTensorTypeAndShapeInfo().GetShape();
+
+    if (shape.size() != 3 || shape[0] != 1 || shape[1] != 1 || shape[2] < 1) {
+        throw std::runtime_error("Unexpected logits shape");
+    }
+
+    const float *p_logit_data = logits.GetTensorData<float>();
+    const float *best = std::max_element(p_logit_data, p_logit_data + shape[2]);
+
+    return {static_cast<size_t>(best - p_logit_data), *best};
+}
+
 } // namespace Moonshine
\ No newline at end of file
@@ -0,0 +1,199 @@
+/**
+ * @file moonshine_profiling.cpp
+ * @brief Per-operator cost summaries built from ONNX Runtime session profiles.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include "moonshine_profiling.h"
+
+
+namespace {
+    /**
+     * @brief Splits the top level array of an ORT profile into event objects
+     *
+     * ORT writes a flat array of trace events. Only brace depth and string
+     * boundaries matter to find where each object starts and ends.
+     */
+    std::vector<std::string> split_events(const std::string &json) {
+        std::vector<std::string> events;
+        int depth = 0;
+        bool in_string = false;
+        size_t start = 0;
+
+        for (size_t i = 0; i < json.size(); i++) {
+            char c = json[i];
+
+            if (in_string) {
+                if (c == '\\') {
+                    i++;
+                } else if (c == '"') {
+                    in_string = false;
+                }
+                continue;
+            }
+
+            if (c == '"') {
+                in_string = true;
+            } else if (c == '{') {
+                if (depth++ == 0) {
+                    start = i;
+                }
+            } else if (c == '}') {
+                if (--depth == 0) {
+                    events.push_back(json.substr(start, i - start + 1));
+                }
+            }
+        }
+
+        return events;
+    }
+
+    /**
+     * @brief Finds where the value of a key starts inside an event object
+     */
+    size_t find_value(const std::string &object, const std::string &key) {
+        auto pos = object.find("\"" + key + "\"");
+
+        if (pos == std::string::npos) {
+            return std::string::npos;
+        }
+
+        pos = object.find(':', pos + key.size() + 2);
+
+        if (pos == std::string::npos) {
+            return std::string::npos;
+        }
+
+        return object.find_first_not_of(" \t\r\n", pos + 1);
+    }
+
+    /**
+     * @brief Gets a string field of an event object, empty if missing
+     */
+    std::string string_field(const std::string &object, const std::string &key) {
+        auto pos = find_value(object, key);
+
+        if (pos == std::string::npos || object[pos] != '"') {
+            return {};
+        }
+
+        auto end = object.find('"', pos + 1);
+
+        return end == std::string::npos ? std::string{} : object.substr(pos + 1, end - pos - 1);
+    }
+
+    /**
+     * @brief Gets a numeric field of an event object, 0 if missing
+     */
+    double number_field(const std::string &object, const std::string &key) {
+        auto pos = find_value(object, key);
+
+        if (pos == std::string::npos) {
+            return 0.0;
+        }
+
+        return std::strtod(object.c_str() + pos, nullptr);
+    }
+
+    /**
+     * @brief Checks whether a string ends with a suffix
+     */
+    bool ends_with(const std::string &str, const std::string &suffix) {
+        return str.size() >= suffix.size() &&
+               str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    /**
+     * @brief Appends one session's table to the output
+     */
+    void write_session(std::ostringstream &out,
+                       const char *title,
+                       const Moonshine::SessionProfile &profile,
+                       size_t top_n)
+    {
+        out << title << ": " << profile.runs << " runs, "
+            << std::fixed << std::setprecision(3) << profile.total_ms << " ms kernel time\n"
+            << "  " << std::left << std::setw(28) << "op_type"
+            << std::right << std::setw(12) << "total_ms"
+            << std::setw(12) << "per_run_ms"
+            << std::setw(10) << "calls"
+            << std::setw(8) << "%" << '\n';
+
+        size_t count = std::min(top_n, profile.operators.size());
+
+        for (size_t i = 0; i < count; i++) {
+            const auto &op = profile.operators[i];
+
+            out << "  " << std::left << std::setw(28) << op.op_type
+                << std::right << std::setw(12) << op.total_ms
+                << std::setw(12) << op.per_run_ms
+                << std::setw(10) << op.calls
+                << std::setw(8) << std::setprecision(1) << op.percent << std::setprecision(3) << '\n';
+        }
+    }
+}
+
+
+namespace Moonshine {
+
+SessionProfile summarize_ort_profile(const std::filesystem::path &file, size_t runs) {
+    std::ifstream ifs(file);
+
+    if (!ifs) {
+        throw std::runtime_error("Unable to open profile: " + file.string());
+    }
+
+    std::stringstream buffer;
+    buffer << ifs.rdbuf();
+
+    std::map<std::string, OperatorCost> by_op;
+    SessionProfile profile;
+    profile.file = file;
+    profile.runs = runs;
+
+    for (const auto &event : split_events(buffer.str())) {
+        // Each node execution is reported as fence_before, kernel_time and
+        // fence_after events; only the kernel time is operator cost.
+        if (string_field(event, "cat") != "Node" || !ends_with(string_field(event, "name"), "_kernel_time")) {
+            continue;
+        }
+
+        std::string op_type = string_field(event, "op_name");
+        double dur_ms = number_field(event, "dur") / 1000.0;
+
+        auto &cost = by_op[op_type.empty() ? "unknown" : op_type];
+        cost.op_type = op_type.empty() ? "unknown" : op_type;
+        cost.total_ms += dur_ms;
+        cost.calls++;
+        profile.total_ms += dur_ms;
+    }
+
+    for (auto &entry : by_op) {
+        auto &cost = entry.second;
+        cost.per_run_ms = runs ? cost.total_ms / runs : 0.0;
+        cost.percent = profile.total_ms > 0.0 ? 100.0 * cost.total_ms / profile.total_ms : 0.0;
+        profile.operators.push_back(cost);
+    }
+
+    std::sort(profile.operators.begin(), profile.operators.end(),
+              [](const OperatorCost &a, const OperatorCost &b) { return a.total_ms > b.total_ms; });
+
+    return profile;
+}
+
+std::string ProfileSummary::to_string(size_t top_n) const {
+    std::ostringstream out;
+
+    write_session(out, "encoder", encoder, top_n);
+    write_session(out, "decoder step", decoder, top_n);
+
+    return out.str();
+}
+
+} // namespace Moonshine
@@ -0,0 +1,219 @@
+/**
+ * @file moonshine_resources.cpp
+ * @brief CPU and memory limits from the affinity mask, SMT topology and cgroup v2.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "moonshine_resources.h"
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+
+namespace {
+#if defined(__linux__)
+    const std::filesystem::path cgroup_root = "/sys/fs/cgroup";
+    const std::filesystem::path cpu_root = "/sys/devices/system/cpu";
+
+    /**
+     * @brief Reads the first line of a file
+     *
+     * @return std::string The line, empty if the file can not be read
+     */
+    std::string read_line(const std::filesystem::path &path) {
+        std::ifstream ifs(path);
+        std::string line;
+        std::getline(ifs, line);
+
+        return line;
+    }
+
+    /**
+     * @brief Gets the directories of the process's cgroup and its ancestors
+     *
+     * Uses the unified hierarchy entry "0::<path>" of /proc/self/cgroup. Inside
+     * a cgroup namespace that path is "/" and the container's own limits are
+     * at the root of the mount.
+     */
+    std::vector<std::filesystem::path> cgroup_dirs() {
+        std::ifstream ifs("/proc/self/cgroup");
+        std::string relative;
+
+        for (std::string line; std::getline(ifs, line);) {
+            if (line.rfind("0::", 0) == 0) {
+                relative = line.substr(3);
+                break;
+            }
+        }
+
+        std::vector<std::filesystem::path> dirs;
+        std::error_code ec;
+        auto dir = (cgroup_root / std::filesystem::path(relative).relative_path()).lexically_normal();
+
+        if (relative.empty() || !std::filesystem::is_directory(dir, ec) ||
+            dir.string().rfind(cgroup_root.string(), 0) != 0)
+        {
+            return {cgroup_root};
+        }
+
+        for (; dir != cgroup_root && dir.has_relative_path(); dir = dir.parent_path()) {
+            dirs.push_back(dir);
+        }
+
+        dirs.push_back(cgroup_root);
+
+        return dirs;
+    }
+
+    /**
+     * @brief Counts the cores behind a set of CPUs, SMT siblings once
+     *
+     * @return size_t Distinct (package, core) pairs, 0 if the topology can not be read
+     */
+    size_t count_cores(const std::vector<int> &cpus) {
+        std::set<std::pair<std::string, std::string>> cores;
+
+        for (int cpu : cpus) {
+            auto topology = cpu_root / ("cpu" + std::to_string(cpu)) / "topology";
+            auto package = read_line(topology / "physical_package_id");
+            auto core = read_line(topology / "core_id");
+
+            if (package.empty() || core.empty()) {
+                return 0;
+            }
+
+            cores.emplace(package, core);
+        }
+
+        return cores.size();
+    }
+#endif
+}
+
+
+namespace Moonshine {
+
+double ResourceLimits::get_cpu_budget() const noexcept {
+    double budget = static_cast<double>(std::max<size_t>(affinity_cpus, 1));
+
+    return cpu_quota > 0.0 ? std::min(budget, cpu_quota) : budget;
+}
+
+uint64_t ResourceLimits::get_memory_budget() const noexcept {
+    if (memory_limit_bytes > 0 && physical_memory_bytes > 0) {
+        return std::min(memory_limit_bytes, physical_memory_bytes);
+    }
+
+    return memory_limit_bytes > 0 ? memory_limit_bytes : physical_memory_bytes;
+}
+
+int ResourceLimits::get_default_threads() const noexcept {
+    auto threads = static_cast<size_t>(std::floor(get_cpu_budget()));
+    threads = std::min(threads, std::max<size_t>(physical_cores, 1));
+
+    return static_cast<int>(std::max<size_t>(threads, 1));
+}
+
+size_t ResourceLimits::get_default_workers(int threads_per_model) const noexcept {
+    auto workers = static_cast<size_t>(std::floor(get_cpu_budget() / std::max(threads_per_model, 1)));
+
+    return std::max<size_t>(workers, 1);
+}
+
+size_t ResourceLimits::get_max_in_flight(uint64_t bytes_per_request, uint64_t reserved_bytes) const noexcept {
+    uint64_t budget = get_memory_budget();
+
+    if (budget == 0 || bytes_per_request == 0) {
+        return std::numeric_limits<size_t>::max();
+    }
+
+    uint64_t available = budget > reserved_bytes ? budget - reserved_bytes : 0;
+
+    return static_cast<size_t>(std::max<uint64_t>(available / bytes_per_request, 1));
+}
+
+ResourceLimits ResourceLimits::detect() {
+    ResourceLimits limits;
+    limits.online_cpus = std::max(std::thread::hardware_concurrency(), 1u);
+    limits.affinity_cpus = limits.online_cpus;
+    limits.physical_cores = limits.online_cpus;
+
+#if defined(__unix__) || defined(__APPLE__)
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long page_size = sysconf(_SC_PAGE_SIZE);
+
+    if (pages > 0 && page_size > 0) {
+        limits.physical_memory_bytes = static_cast<uint64_t>(pages) * static_cast<uint64_t>(page_size);
+    }
+#endif
+
+#if defined(__linux__)
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+
+    if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+        std::vector<int> cpus;
+
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &mask)) {
+                cpus.push_back(cpu);
+            }
+        }
+
+        if (!cpus.empty()) {
+            limits.affinity_cpus = cpus.size();
+            size_t cores = count_cores(cpus);
+            limits.physical_cores = cores > 0 ? cores : cpus.size();
+        }
+    }
+
+    // Limits nest: a cgroup can not use more than any of its ancestors allow
+    for (const auto &dir : cgroup_dirs()) {
+        // "<quota> <period>" or "max <period>"; "max" fails the numeric read
+        std::ifstream cpu_max(dir / "cpu.max");
+        double quota = 0.0;
+        double period = 0.0;
+
+        if (cpu_max >> quota >> period && quota > 0.0 && period > 0.0) {
+            double cpus = quota / period;
+
+            if (limits.cpu_quota == 0.0 || cpus < limits.cpu_quota) {
+                limits.cpu_quota = cpus;
+            }
+        }
+
+        std::ifstream memory_max(dir / "memory.max");
+        uint64_t bytes = 0;
+
+        if (memory_max >> bytes && bytes > 0) {
+            if (limits.memory_limit_bytes == 0 || bytes < limits.memory_limit_bytes) {
+                limits.memory_limit_bytes = bytes;
+            }
+        }
+    }
+#endif
+
+    return limits;
+}
+
+const ResourceLimits &get_resource_limits() {
+    static const ResourceLimits limits = ResourceLimits::detect();
+
+    return limits;
+}
+
+} // namespace Moonshine
@@ -0,0 +1,39 @@
+/**
+ * @file moonshine_result.cpp
+ * @brief Thread CPU time source for stage timings.
+ */
+
+#include "moonshine_result.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <time.h>
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+
+namespace Moonshine {
+
+double thread_cpu_time_ms() noexcept {
+#if defined(__unix__) || defined(__APPLE__)
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+#elif defined(_WIN32)
+    FILETIME creation, exit, kernel, user;
+    GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user);
+
+    auto to_100ns = [](const FILETIME &ft) {
+        return (static_cast<uint64_t>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+    };
+
+    return (to_100ns(kernel) + to_100ns(user)) / 1e4;
+#else
+    return 0.0;
+#endif
+}
+
+} // namespace Moonshine
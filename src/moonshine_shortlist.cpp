@@ -0,0 +1,61 @@
+/**
+ * @file moonshine_shortlist.cpp
+ * @brief Loading, validation and logit mapping of vocabulary shortlists.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include "moonshine_onnx_model.h"
+
+
+namespace Moonshine {
+
+void VocabShortlist::validate() const {
+    if (token_ids.empty()) {
+        throw std::runtime_error("Vocabulary shortlist has no tokens");
+    }
+
+    if (std::find(token_ids.begin(), token_ids.end(), end_token) == token_ids.end()) {
+        throw std::runtime_error("Vocabulary shortlist does not include the end token "
+                                 + std::to_string(end_token));
+    }
+}
+
+std::optional<int> VocabShortlist::select(size_t index, float logit) const {
+    int token = token_ids.at(index);
+
+    if (logit < min_logit) {
+        return std::nullopt;
+    }
+
+    return token;
+}
+
+VocabShortlist VocabShortlist::from_files(const f_path &decoder_path,
+                                          const f_path &token_list_path,
+                                          float min_logit)
+{
+    std::ifstream ifs(token_list_path);
+
+    if (!ifs) {
+        throw std::runtime_error("Failed to open token list: " + token_list_path.string());
+    }
+
+    VocabShortlist shortlist{decoder_path, {}, min_logit};
+    int token_id;
+
+    while (ifs >> token_id) {
+        shortlist.token_ids.push_back(token_id);
+    }
+
+    if (!ifs.eof() || shortlist.token_ids.empty()) {
+        throw std::runtime_error("Token list must hold whitespace separated token ids: " + token_list_path.string());
+    }
+
+    shortlist.validate();
+
+    return shortlist;
+}
+
+} // namespace Moonshine
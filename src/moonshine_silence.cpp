@@ -0,0 +1,79 @@
+/**
+ * @file moonshine_silence.cpp
+ * @brief Energy based pause detection and shortening.
+ */
+
+#include <algorithm>
+#include "moonshine_silence.h"
+
+
+namespace {
+    constexpr size_t samples_per_ms = 16;
+    constexpr size_t frame_size = 10 * samples_per_ms;
+}
+
+
+namespace Moonshine {
+
+std::vector<float> compact_silence(const std::vector<float> &audio_data, const SilenceCompaction &options) {
+    const size_t n = audio_data.size();
+    const size_t frames = (n + frame_size - 1) / frame_size;
+    const size_t min_pause = options.min_pause_ms * samples_per_ms;
+    const size_t gap = options.kept_gap_ms * samples_per_ms;
+    const double rms_sq = static_cast<double>(options.silence_rms) * options.silence_rms;
+
+    std::vector<bool> silent(frames);
+
+    for (size_t f = 0; f < frames; f++) {
+        size_t begin = f * frame_size;
+        size_t end = std::min(n, begin + frame_size);
+        double energy = 0.0;
+
+        for (size_t i = begin; i < end; i++) {
+            energy += static_cast<double>(audio_data[i]) * audio_data[i];
+        }
+
+        silent[f] = energy <= rms_sq * (end - begin);
+    }
+
+    std::vector<float> compacted;
+    compacted.reserve(n);
+
+    auto append = [&](size_t begin, size_t end) {
+        compacted.insert(compacted.end(), audio_data.begin() + begin, audio_data.begin() + end);
+    };
+
+    for (size_t f = 0; f < frames;) {
+        size_t e = f;
+
+        while (e < frames && silent[e] == silent[f]) {
+            e++;
+        }
+
+        size_t begin = f * frame_size;
+        size_t end = std::min(n, e * frame_size);
+        size_t length = end - begin;
+        bool leading = f == 0;
+        bool trailing = e == frames;
+        bool edge = leading || trailing;
+
+        if (!silent[f] || length <= gap || (edge && !options.trim_edges) || (!edge && length < min_pause)) {
+            append(begin, end);
+        } else if (leading && trailing) {
+            append(begin, begin + gap);
+        } else if (leading) {
+            append(end - gap, end);
+        } else if (trailing) {
+            append(begin, begin + gap);
+        } else {
+            append(begin, begin + gap / 2);
+            append(end - (gap - gap / 2), end);
+        }
+
+        f = e;
+    }
+
+    return compacted;
+}
+
+} // namespace Moonshine
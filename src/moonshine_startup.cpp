@@ -0,0 +1,120 @@
+/**
+ * @file moonshine_startup.cpp
+ * @brief Startup phase measurement from /proc counters and report formatting.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include "moonshine_startup.h"
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+
+namespace {
+    /**
+     * @brief Gets the bytes the process has read through read calls
+     * @return uint64_t rchar of /proc/self/io, 0 if unavailable
+     */
+    uint64_t process_read_bytes() noexcept {
+#if defined(__linux__)
+        std::ifstream ifs("/proc/self/io");
+
+        for (std::string key; ifs >> key;) {
+            uint64_t value = 0;
+            ifs >> value;
+
+            if (key == "rchar:") {
+                return value;
+            }
+        }
+#endif
+        return 0;
+    }
+
+    /**
+     * @brief Gets the resident set size of the process
+     * @return int64_t Bytes, 0 if unavailable
+     */
+    int64_t resident_bytes() noexcept {
+#if defined(__linux__)
+        std::ifstream ifs("/proc/self/statm");
+        int64_t size = 0;
+        int64_t resident = 0;
+
+        if (ifs >> size >> resident) {
+            return resident * sysconf(_SC_PAGESIZE);
+        }
+#endif
+        return 0;
+    }
+
+    /**
+     * @brief Writes one row of the report table
+     */
+    void write_row(std::ostream &out, const std::string &name, const Moonshine::StartupPhase &phase) {
+        out << std::left << std::setw(24) << name << std::right
+            << std::fixed << std::setprecision(1) << std::setw(12) << phase.wall_ms
+            << std::setprecision(2) << std::setw(14) << phase.bytes_read / 1048576.0
+            << std::setw(14) << phase.rss_growth_bytes / 1048576.0 << '\n';
+    }
+}
+
+
+namespace Moonshine {
+
+StartupPhase StartupPhase::minus(const StartupPhase &other) const noexcept {
+    return {
+        std::max(0.0, wall_ms - other.wall_ms),
+        bytes_read > other.bytes_read ? bytes_read - other.bytes_read : 0,
+        rss_growth_bytes - other.rss_growth_bytes
+    };
+}
+
+std::string StartupReport::to_string() const {
+    std::ostringstream out;
+    out << std::left << std::setw(24) << "phase" << std::right
+        << std::setw(12) << "wall ms" << std::setw(14) << "read MiB" << std::setw(14) << "RSS MiB" << '\n';
+
+    write_row(out, "env", env);
+
+    for (const auto &session : {std::make_pair("encoder", &encoder), std::make_pair("decoder", &decoder)}) {
+        std::string name = session.first;
+        write_row(out, name + " session", session.second->total);
+
+        if (sessions_split) {
+            write_row(out, "  graph load", session.second->graph_load);
+            write_row(out, "  optimization", session.second->optimization);
+            write_row(out, "  prepacking", session.second->prepacking);
+        }
+    }
+
+    write_row(out, "io names", io_names);
+    write_row(out, "tokenizer read", tokenizer_read);
+    write_row(out, "tokenizer parse", tokenizer_parse);
+    write_row(out, "total", total);
+
+    return out.str();
+}
+
+void StartupTimer::restart() noexcept {
+    wall_start = std::chrono::steady_clock::now();
+    read_start = process_read_bytes();
+    resident_start = resident_bytes();
+}
+
+StartupPhase StartupTimer::elapsed() const noexcept {
+    std::chrono::duration<double, std::milli> wall = std::chrono::steady_clock::now() - wall_start;
+    uint64_t read_now = process_read_bytes();
+
+    return {
+        wall.count(),
+        read_now > read_start ? read_now - read_start : 0,
+        resident_bytes() - resident_start
+    };
+}
+
+} // namespace Moonshine
@@ -0,0 +1,227 @@
+/**
+ * @file moonshine_stream.cpp
+ * @brief Live transcription with energy and hypothesis based endpointing.
+ */
+
+#include <stdexcept>
+#include "moonshine_blob.h"
+#include "moonshine_stream.h"
+
+
+namespace {
+    constexpr uint32_t stream_state_magic = 0x5453534D;  // "MSST"
+    constexpr uint32_t stream_state_version = 1;
+}
+
+
+namespace Moonshine {
+
+StreamTranscriber::StreamTranscriber(Transcriber &transcriber, EndpointOptions options)
+    : transcriber(transcriber),
+      options(options)
+{}
+
+std::vector<StreamUpdate> StreamTranscriber::push(const std::vector<float> &chunk) {
+    std::vector<StreamUpdate> updates;
+
+    utterance.insert(utterance.end(), chunk.begin(), chunk.end());
+    analyze_frames();
+
+    if (speech_end == 0) {
+        // Nothing to decode yet; keep only a little lookback before speech
+        size_t keep = to_samples(options.leading_silence_ms);
+
+        if (analyzed > keep) {
+            size_t drop = analyzed - keep;
+            utterance.erase(utterance.begin(), utterance.begin() + drop);
+            utterance_start += drop;
+            analyzed -= drop;
+        }
+
+        return updates;
+    }
+
+    bool ended_speech = trailing_silence >= to_samples(options.trailing_silence_ms);
+
+    if (utterance.size() - decoded >= to_samples(options.partial_interval_ms) ||
+        (ended_speech && decoded < speech_end))
+    {
+        updates.push_back(decode_partial());
+    }
+
+    bool stable = stable_count >= options.stable_decodes && decoded >= speech_end;
+
+    if ((ended_speech && stable) || utterance.size() >= to_samples(options.max_utterance_ms)) {
+        updates.push_back(finalize());
+    }
+
+    return updates;
+}
+
+std::optional<StreamUpdate> StreamTranscriber::finish() {
+    if (speech_end == 0) {
+        return std::nullopt;
+    }
+
+    return finalize();
+}
+
+std::string StreamTranscriber::save_state(bool compress) const {
+    BlobWriter writer;
+    writer.data().reserve(64 + utterance.size() * (compress ? sizeof(int16_t) : sizeof(float))
+                          + hypothesis.size() * sizeof(int32_t) + hypothesis_text.size());
+
+    writer.put<uint32_t>(stream_state_magic);
+    writer.put<uint32_t>(stream_state_version);
+    writer.put<uint8_t>(compress ? 1 : 0);
+
+    for (size_t value : {utterance_start, analyzed, speech_end, trailing_silence, decoded, stable_count}) {
+        writer.put<uint64_t>(value);
+    }
+
+    writer.put<uint32_t>(static_cast<uint32_t>(utterance.size()));
+
+    if (compress) {
+        writer.put_pcm16(utterance.data(), utterance.size());
+    } else {
+        writer.put_bytes(utterance.data(), utterance.size() * sizeof(float));
+    }
+
+    writer.put<uint32_t>(static_cast<uint32_t>(hypothesis.size()));
+
+    for (int token : hypothesis) {
+        writer.put<int32_t>(token);
+    }
+
+    writer.put_string(hypothesis_text);
+
+    return std::move(writer.data());
+}
+
+void StreamTranscriber::restore_state(const std::string &blob) {
+    BlobReader reader(blob);
+
+    if (blob.size() < 2 * sizeof(uint32_t) || reader.take<uint32_t>() != stream_state_magic) {
+        throw std::runtime_error("Not a stream state");
+    }
+
+    auto blob_version = reader.take<uint32_t>();
+
+    if (blob_version != stream_state_version) {
+        throw std::runtime_error("Unsupported stream state version " + std::to_string(blob_version));
+    }
+
+    // Read into locals first so a bad blob leaves the stream untouched
+    bool compressed = reader.take<uint8_t>() != 0;
+    size_t counters[6];
+
+    for (auto &value : counters) {
+        value = static_cast<size_t>(reader.take<uint64_t>());
+    }
+
+    std::vector<float> audio;
+    auto sample_count = reader.take<uint32_t>();
+
+    if (compressed) {
+        reader.take_pcm16(audio, sample_count);
+    } else {
+        if (sample_count > reader.remaining() / sizeof(float)) {
+            throw std::runtime_error("Blob is truncated");
+        }
+
+        audio.resize(sample_count);
+        reader.take_bytes(audio.data(), audio.size() * sizeof(float));
+    }
+
+    auto token_count = reader.take<uint32_t>();
+
+    if (token_count > reader.remaining() / sizeof(int32_t)) {
+        throw std::runtime_error("Blob is truncated");
+    }
+
+    std::vector<int> tokens(token_count);
+
+    for (auto &token : tokens) {
+        token = reader.take<int32_t>();
+    }
+
+    std::string text = reader.take_string();
+
+    if (counters[1] > audio.size() || counters[2] > audio.size() || counters[4] > audio.size()) {
+        throw std::runtime_error("Stream state is inconsistent");
+    }
+
+    utterance = std::move(audio);
+    utterance_start = counters[0];
+    analyzed = counters[1];
+    speech_end = counters[2];
+    trailing_silence = counters[3];
+    decoded = counters[4];
+    stable_count = counters[5];
+    hypothesis = std::move(tokens);
+    hypothesis_text = std::move(text);
+}
+
+void StreamTranscriber::analyze_frames() {
+    const size_t frame = to_samples(10);
+    const double threshold = static_cast<double>(options.silence_rms) * options.silence_rms * frame;
+
+    for (; analyzed + frame <= utterance.size(); analyzed += frame) {
+        double energy = 0.0;
+
+        for (size_t i = analyzed; i < analyzed + frame; i++) {
+            energy += static_cast<double>(utterance[i]) * utterance[i];
+        }
+
+        if (energy > threshold) {
+            speech_end = analyzed + frame;
+            trailing_silence = 0;
+        } else if (speech_end != 0) {
+            trailing_silence += frame;
+        }
+    }
+}
+
+StreamUpdate StreamTranscriber::decode_partial() {
+    auto result = transcriber.transcribe_detailed(utterance, false);
+    bool ended = result.stop_reason == StopReason::EndToken;
+
+    if (ended && result.tokens == hypothesis) {
+        stable_count++;
+    } else {
+        stable_count = ended ? 1 : 0;
+    }
+
+    decoded = utterance.size();
+    hypothesis = std::move(result.tokens);
+    hypothesis_text = std::move(result.text);
+
+    const double sample_rate = static_cast<double>(OnnxModel::get_sample_rate());
+
+    return {hypothesis_text, false, utterance_start / sample_rate, (utterance_start + decoded) / sample_rate};
+}
+
+StreamUpdate StreamTranscriber::finalize() {
+    if (decoded < speech_end) {
+        decode_partial();
+    }
+
+    const double sample_rate = static_cast<double>(OnnxModel::get_sample_rate());
+    StreamUpdate update{std::move(hypothesis_text), true,
+                        utterance_start / sample_rate, (utterance_start + speech_end) / sample_rate};
+
+    // Release the utterance's audio and hypothesis rather than keeping capacity around
+    utterance_start += utterance.size();
+    std::vector<float>().swap(utterance);
+    std::vector<int>().swap(hypothesis);
+    hypothesis_text.clear();
+    analyzed = 0;
+    speech_end = 0;
+    trailing_silence = 0;
+    decoded = 0;
+    stable_count = 0;
+
+    return update;
+}
+
+} // namespace Moonshine
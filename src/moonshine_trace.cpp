@@ -0,0 +1,138 @@
+/**
+ * @file moonshine_trace.cpp
+ * @brief Opt-in span tracing into a ring buffer, exportable as Chrome trace JSON.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include "moonshine_trace.h"
+
+
+namespace {
+    constexpr size_t default_capacity = 1 << 16;    /**< Events kept by default */
+
+    thread_local uint64_t thread_request_id = 0;    /**< Request id of this thread */
+
+    /**
+     * @brief Writes nanoseconds as exact microseconds with three decimals
+     *
+     * Streaming the value as a double would keep only six significant digits,
+     * rounding timestamps to milliseconds after a couple of minutes of uptime.
+     */
+    void write_microseconds(std::ostream &out, int64_t ns) {
+        if (ns < 0) {
+            out << '-';
+            ns = -ns;
+        }
+
+        out << ns / 1000 << '.' << std::setw(3) << std::setfill('0') << ns % 1000;
+    }
+}
+
+
+namespace Moonshine {
+
+Tracer::Tracer()
+    : epoch(std::chrono::steady_clock::now()),
+      ring(default_capacity)
+{}
+
+Tracer &Tracer::instance() {
+    static Tracer tracer;
+
+    return tracer;
+}
+
+void Tracer::set_capacity(size_t events) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    ring.assign(std::max<size_t>(events, 1), TraceEvent{});
+    next = 0;
+    wrapped = false;
+}
+
+void Tracer::record(const TraceEvent &event) noexcept {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    ring[next] = event;
+
+    if (++next == ring.size()) {
+        next = 0;
+        wrapped = true;
+    }
+}
+
+std::vector<TraceEvent> Tracer::events() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<TraceEvent> result;
+
+    if (wrapped) {
+        result.insert(result.end(), ring.begin() + next, ring.end());
+    }
+
+    result.insert(result.end(), ring.begin(), ring.begin() + next);
+
+    return result;
+}
+
+void Tracer::clear() noexcept {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    next = 0;
+    wrapped = false;
+}
+
+std::string Tracer::dump_chrome_trace() const {
+    std::ostringstream out;
+    bool first = true;
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    for (const auto &event : events()) {
+        out << (first ? "\n" : ",\n")
+            << "{\"name\":\"" << event.name << "\""
+            << ",\"cat\":\"moonshine\",\"ph\":\"X\""
+            << ",\"ts\":";
+        write_microseconds(out, event.start_ns);
+        out << ",\"dur\":";
+        write_microseconds(out, event.duration_ns);
+        out << ",\"pid\":1,\"tid\":" << event.thread_id
+            << ",\"args\":{\"request_id\":" << event.request_id << "}}";
+
+        first = false;
+    }
+
+    out << "\n]}\n";
+
+    return out.str();
+}
+
+void Tracer::write_chrome_trace(const std::filesystem::path &path) const {
+    std::ofstream ofs(path, std::ios::trunc);
+
+    if (!ofs) {
+        throw std::runtime_error("Unable to open trace file: " + path.string());
+    }
+
+    ofs << dump_chrome_trace();
+}
+
+uint64_t Tracer::current_request_id() noexcept {
+    return thread_request_id;
+}
+
+void Tracer::set_current_request_id(uint64_t request_id) noexcept {
+    thread_request_id = request_id;
+}
+
+uint32_t Tracer::current_thread_id() noexcept {
+    static std::atomic<uint32_t> next_thread_id{1};
+    thread_local uint32_t thread_id = next_thread_id.fetch_add(1, std::memory_order_relaxed);
+
+    return thread_id;
+}
+
+} // namespace Moonshine
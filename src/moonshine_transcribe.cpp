@@ -4,9 +4,57 @@
  */
 
 #include <fstream>
+#include <iostream>
 #include <sstream>
 #include <stdexcept>
 #include "moonshine.h"
+#include "moonshine_capture.h"
+#include "moonshine_metrics.h"
+#include "moonshine_model_registry.h"
+#include "moonshine_trace.h"
+#include "moonshine_transcript_cache.h"
+
+
+namespace {
+    /**
+     * @brief Identifies a file by location, size and modification time
+     *
+     * @param path File to identify
+     * @return std::string Identity string that changes when the file does
+     */
+    std::string file_identity(const Moonshine::f_path &path) {
+        auto mtime = std::filesystem::last_write_time(path).time_since_epoch().count();
+
+        return std::filesystem::weakly_canonical(path).string()
+             + "@" + std::to_string(std::filesystem::file_size(path))
+             + "@" + std::to_string(mtime);
+    }
+
+    /**
+     * @class InFlightGuard
+     * @brief Counts a request in the in-flight gauge until it goes out of scope
+     */
+    class InFlightGuard {
+    public:
+        explicit InFlightGuard(Moonshine::Gauge *gauge) noexcept : gauge(gauge) {
+            if (gauge) {
+                gauge->add(1);
+            }
+        }
+
+        ~InFlightGuard() {
+            if (gauge) {
+                gauge->sub(1);
+            }
+        }
+
+        InFlightGuard(const InFlightGuard &) = delete;
+        InFlightGuard &operator=(const InFlightGuard &) = delete;
+
+    private:
+        Moonshine::Gauge *gauge;    /**< Null when metrics are disabled */
+    };
+}
 
 
 namespace Moonshine {
@@ -16,6 +64,15 @@ Transcriber::Transcriber(const ModelType model_type,
                          const f_path &decoder_path,
                          const f_path &tokenizer_path,
                          const int num_threads)
+    : Transcriber(model_type, encoder_path, decoder_path, tokenizer_path,
+                  ModelOptions{num_threads, std::nullopt})
+{}
+
+Transcriber::Transcriber(const ModelType model_type,
+                         const f_path &encoder_path,
+                         const f_path &decoder_path,
+                         const f_path &tokenizer_path,
+                         const ModelOptions &options)
 {
     if (!std::filesystem::exists(tokenizer_path)) {
         throw std::runtime_error("File not found: " + tokenizer_path.string());
@@ -23,35 +80,234 @@ Transcriber::Transcriber(const ModelType model_type,
         throw std::runtime_error("Not a regular file: " + tokenizer_path.string());
     }
 
+    StartupTimer total_timer;
+    StartupTimer timer;
     std::ifstream ifs(tokenizer_path);
     std::stringstream buffer;
 
     buffer << ifs.rdbuf();
 
+    StartupPhase tokenizer_read = timer.elapsed();
+    timer.restart();
+
     tokenizer = tokenizers::Tokenizer::FromBlobJSON(buffer.str());
 
+    StartupPhase tokenizer_parse = timer.elapsed();
+
     switch (model_type) {
         case ModelType::Base:
-            model = std::make_unique<OnnxModel>(OnnxModel::Base(encoder_path, decoder_path, num_threads));
+            model = std::make_unique<OnnxModel>(OnnxModel::Base(encoder_path, decoder_path, options));
             break;
         case ModelType::Tiny:
-            model = std::make_unique<OnnxModel>(OnnxModel::Tiny(encoder_path, decoder_path, num_threads));
+            model = std::make_unique<OnnxModel>(OnnxModel::Tiny(encoder_path, decoder_path, options));
             break;
     }
+
+    model_id = (model_type == ModelType::Base ? "base:" : "tiny:")
+             + file_identity(encoder_path) + ":" + file_identity(decoder_path);
+    tokenizer_id = file_identity(tokenizer_path);
+
+    startup = model->get_startup_report();
+    startup.tokenizer_read = tokenizer_read;
+    startup.tokenizer_parse = tokenizer_parse;
+    startup.total = total_timer.elapsed();
+
+    if (options.log_startup) {
+        std::clog << "Moonshine startup (" << model_id << "):\n" << startup.to_string() << std::flush;
+    }
 }
 
+Transcriber::Transcriber(ModelRegistry &registry,
+                         const ModelType model_type,
+                         const f_path &encoder_path,
+                         const f_path &decoder_path,
+                         const f_path &tokenizer_path,
+                         const int num_threads)
+    : registry(&registry),
+      model_id(registry.register_model(model_type, encoder_path, decoder_path, num_threads)),
+      tokenizer_id(registry.register_tokenizer(tokenizer_path))
+{}
+
 std::string Transcriber::transcribe(const std::vector<float> &audio_data) noexcept {
-    auto tokens = model->run(const_cast<std::vector<float> &>(audio_data));
+    if (cache) {
+        try {
+            // Keyed by the settings of the model serving this request, which
+            // may have changed since construction, e.g. through the registry
+            std::shared_ptr<OnnxModel> shared_model = registry ? registry->acquire_model(model_id) : nullptr;
+            const OnnxModel &active_model = registry ? *shared_model : *model;
+            std::string key = model_id + active_model.get_output_identity() + "|" + tokenizer_id;
 
-    if (tokens.empty()) {
-        return "";
+            return cache->get_or_compute(key, audio_data,
+                                         [&]() -> std::optional<std::string> {
+                auto result = infer(audio_data, false);
+
+                if (result.stop_reason == StopReason::Error) {
+                    return std::nullopt;
+                }
+
+                return std::move(result.text);
+            });
+        } catch (...) {
+            // The model could not be acquired, which infer() reports as an
+            // error, or the cache failed, e.g. out of memory; run uncached
+        }
     }
 
-    return tokenizer->Decode(tokens);
+    return infer(audio_data, false).text;
 }
 
 std::string Transcriber::operator()(const std::vector<float> &audio_data) noexcept {
     return transcribe(audio_data);
 }
 
+TranscriptionResult Transcriber::transcribe_detailed(const std::vector<float> &audio_data,
+                                                     bool collect_timings) noexcept
+{
+    return infer(audio_data, collect_timings);
+}
+
+void Transcriber::set_cache(std::shared_ptr<TranscriptCache> transcript_cache) noexcept {
+    cache = std::move(transcript_cache);
+}
+
+void Transcriber::set_recorder(std::shared_ptr<TrafficRecorder> traffic_recorder) noexcept {
+    recorder = std::move(traffic_recorder);
+}
+
+std::string Transcriber::get_config() {
+    if (registry) {
+        return model_id + "|" + tokenizer_id + "|" + registry->acquire_model(model_id)->get_config();
+    }
+
+    return model_id + "|" + tokenizer_id + "|" + model->get_config();
+}
+
+StartupReport Transcriber::get_startup_report() {
+    if (registry) {
+        return registry->acquire_model(model_id)->get_startup_report();
+    }
+
+    return startup;
+}
+
+ProfileSummary Transcriber::get_profile_summary() {
+    if (registry) {
+        return registry->acquire_model(model_id)->get_profile_summary();
+    }
+
+    return model->get_profile_summary();
+}
+
+void Transcriber::record(const TranscriptionResult &result, size_t sample_count) noexcept {
+    auto &metrics = Metrics::instance();
+    double audio_seconds = static_cast<double>(sample_count) / OnnxModel::get_sample_rate();
+
+    metrics.requests.add();
+    metrics.audio_milliseconds.add(static_cast<uint64_t>(audio_seconds * 1000.0));
+    metrics.tokens.add(result.tokens.size());
+    metrics.tokens_per_request.observe(static_cast<double>(result.tokens.size()));
+
+    if (result.stop_reason == StopReason::Error) {
+        metrics.failed_requests.add();
+    }
+
+    if (result.memory_collected) {
+        metrics.request_peak_memory.observe(static_cast<double>(result.memory.peak_bytes));
+        metrics.kv_cache_memory.observe(static_cast<double>(result.memory.kv_cache_bytes));
+    }
+
+    if (!result.timings_collected) {
+        return;
+    }
+
+    metrics.request_latency.observe(result.total.wall_ms / 1000.0);
+
+    if (audio_seconds > 0.0) {
+        metrics.real_time_factor.observe(result.total.wall_ms / 1000.0 / audio_seconds);
+        metrics.encoder_latency_per_audio_second.observe(result.encode.wall_ms / 1000.0 / audio_seconds);
+    }
+
+    for (const auto &step : result.decode_step_timings) {
+        metrics.decoder_step_latency.observe(step.wall_ms / 1000.0);
+    }
+}
+
+TranscriptionResult Transcriber::infer(const std::vector<float> &audio_data, bool collect_timings) {
+    auto &metrics = Metrics::instance();
+    bool record_metrics = metrics.is_enabled();
+
+    if (record_metrics) {
+        collect_timings = true;
+    }
+
+    InFlightGuard in_flight(record_metrics ? &metrics.in_flight : nullptr);
+
+    uint64_t arrival_ns = 0;
+
+    if (recorder) {
+        collect_timings = true;
+        arrival_ns = recorder->now_ns();
+    }
+
+    TraceRequestScope trace_request;
+    TraceSpan span("transcribe");
+
+    TranscriptionResult result;
+    StageTimer total_timer(collect_timings);
+    auto &audio = const_cast<std::vector<float> &>(audio_data);
+    std::string config;
+
+    // A registry reloads evicted models and tokenizers here, which can fail
+    // like any load; callers are noexcept, so failures become StopReason::Error.
+    try {
+        std::shared_ptr<OnnxModel> shared_model;
+        OnnxModel *active_model = model.get();
+
+        if (registry) {
+            shared_model = registry->acquire_model(model_id);
+            active_model = shared_model.get();
+        }
+
+        if (recorder) {
+            config = model_id + "|" + tokenizer_id + "|" + active_model->get_config();
+        }
+
+        active_model->note_request();
+        active_model->run(audio, result, collect_timings);
+
+        if (!result.tokens.empty()) {
+            StageTimer detokenize_timer(result.timings_collected);
+            TraceSpan detokenize_span("tokenizer_decode");
+
+            if (registry) {
+                result.text = registry->acquire_tokenizer(tokenizer_id)->decode(result.tokens);
+            } else {
+                result.text = tokenizer->Decode(result.tokens);
+            }
+
+            result.detokenize = detokenize_timer.elapsed();
+        }
+    } catch (...) {
+        result.tokens.clear();
+        result.text.clear();
+        result.stop_reason = StopReason::Error;
+    }
+
+    result.total = total_timer.elapsed();
+
+    if (record_metrics) {
+        record(result, audio_data.size());
+    }
+
+    if (recorder) {
+        if (config.empty()) {
+            config = model_id + "|" + tokenizer_id;
+        }
+
+        recorder->record(arrival_ns, audio_data, config, result);
+    }
+
+    return result;
+}
+
 } // namespace Moonshine
\ No newline at end of file
@@ -0,0 +1,285 @@
+/**
+ * @file moonshine_transcript_cache.cpp
+ * @brief Content addressed cache of transcripts with in-flight request coalescing.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include "moonshine_hash.h"
+#include "moonshine_transcript_cache.h"
+
+
+namespace {
+    /**
+     * @brief Builds the cache key for a model and audio buffer
+     *
+     * The sample count is part of the key so a hash collision also needs
+     * equal lengths to return a wrong transcript.
+     */
+    std::string make_key(const std::string &model_id, const std::vector<float> &audio_data) {
+        std::ostringstream key;
+        key << model_id << '|' << audio_data.size() << '|'
+            << std::hex << std::setw(16) << std::setfill('0') << Moonshine::hash_samples(audio_data);
+
+        return key.str();
+    }
+
+    /**
+     * @brief Gets the disk tier file for a key
+     */
+    Moonshine::f_path disk_file(const Moonshine::f_path &dir, uint64_t key_hash) {
+        std::ostringstream name;
+        name << std::hex << std::setw(16) << std::setfill('0') << key_hash << ".txt";
+
+        return dir / name.str();
+    }
+
+    /**
+     * @brief Lists the disk tier files of a directory, skipping partial writes
+     */
+    std::vector<std::filesystem::directory_entry> disk_files(const Moonshine::f_path &dir) {
+        std::vector<std::filesystem::directory_entry> files;
+        std::error_code ec;
+
+        for (const auto &entry : std::filesystem::directory_iterator(dir, ec)) {
+            if (entry.is_regular_file(ec) && entry.path().extension() == ".txt") {
+                files.push_back(entry);
+            }
+        }
+
+        return files;
+    }
+}
+
+
+namespace Moonshine {
+
+TranscriptCache::TranscriptCache(size_t max_entries, std::optional<f_path> disk_dir, uint64_t max_disk_bytes)
+    : max_entries(max_entries),
+      disk_dir(std::move(disk_dir)),
+      max_disk_bytes(max_disk_bytes)
+{
+    if (this->disk_dir) {
+        std::filesystem::create_directories(*this->disk_dir);
+        std::error_code ec;
+
+        for (const auto &file : disk_files(*this->disk_dir)) {
+            disk_bytes += file.file_size(ec);
+        }
+    }
+}
+
+std::string TranscriptCache::get_or_compute(const std::string &model_id,
+                                            const std::vector<float> &audio_data,
+                                            const std::function<std::optional<std::string>()> &compute)
+{
+    const std::string key = make_key(model_id, audio_data);
+    const uint64_t key_hash = hash_string(key);
+    std::promise<std::string> promise;
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto hit = memory.find(key);
+
+        if (hit != memory.end()) {
+            stats.memory_hits++;
+            lru.splice(lru.begin(), lru, hit->second.lru_pos);
+            return hit->second.transcript;
+        }
+
+        auto running = in_flight.find(key);
+
+        if (running != in_flight.end()) {
+            stats.coalesced++;
+            auto result = running->second;
+            lock.unlock();
+
+            return result.get();
+        }
+
+        in_flight.emplace(key, promise.get_future().share());
+    }
+
+    std::optional<std::string> transcript;
+    bool from_disk = false;
+
+    try {
+        transcript = read_disk(key, key_hash);
+        from_disk = transcript.has_value();
+
+        if (!transcript) {
+            transcript = compute();
+
+            if (transcript) {
+                write_disk(key, key_hash, *transcript);
+            }
+        }
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        promise.set_exception(std::current_exception());
+        in_flight.erase(key);
+        throw;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (from_disk) {
+        stats.disk_hits++;
+    } else {
+        stats.misses++;
+    }
+
+    if (!transcript) {
+        // Settled but not cached, so the next request for this audio retries
+        promise.set_value(std::string());
+        in_flight.erase(key);
+
+        return std::string();
+    }
+
+    insert_memory(key, *transcript);
+    promise.set_value(*transcript);
+    in_flight.erase(key);
+
+    return *transcript;
+}
+
+void TranscriptCache::clear() noexcept {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    memory.clear();
+    lru.clear();
+}
+
+TranscriptCache::Stats TranscriptCache::get_stats() const noexcept {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return stats;
+}
+
+std::optional<std::string> TranscriptCache::read_disk(const std::string &key, uint64_t key_hash) const {
+    if (!disk_dir) {
+        return std::nullopt;
+    }
+
+    std::ifstream ifs(disk_file(*disk_dir, key_hash), std::ios::binary);
+
+    if (!ifs) {
+        return std::nullopt;
+    }
+
+    // First line is the full key, guarding against file name collisions
+    std::string stored_key;
+    std::getline(ifs, stored_key);
+
+    if (stored_key != key) {
+        return std::nullopt;
+    }
+
+    std::stringstream buffer;
+    buffer << ifs.rdbuf();
+
+    // Marks the entry recently used for pruning
+    std::error_code ec;
+    std::filesystem::last_write_time(disk_file(*disk_dir, key_hash),
+                                     std::filesystem::file_time_type::clock::now(), ec);
+
+    return buffer.str();
+}
+
+void TranscriptCache::write_disk(const std::string &key, uint64_t key_hash, const std::string &transcript) {
+    if (!disk_dir) {
+        return;
+    }
+
+    auto path = disk_file(*disk_dir, key_hash);
+    auto tmp_path = path;
+    tmp_path += ".tmp";
+
+    {
+        std::ofstream ofs(tmp_path, std::ios::binary | std::ios::trunc);
+
+        if (!ofs) {
+            return;
+        }
+
+        ofs << key << '\n' << transcript;
+    }
+
+    // Rename is atomic, so concurrent readers never see a partial file
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, path, ec);
+
+    if (ec) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(disk_mutex);
+    disk_bytes += key.size() + 1 + transcript.size();
+
+    if (max_disk_bytes > 0 && disk_bytes > max_disk_bytes) {
+        prune_disk();
+    }
+}
+
+void TranscriptCache::prune_disk() {
+    struct File {
+        f_path path;
+        std::filesystem::file_time_type used;
+        uint64_t size;
+    };
+
+    std::vector<File> files;
+    uint64_t total = 0;
+    std::error_code ec;
+
+    // Recounted from the directory, which other processes may share
+    for (const auto &entry : disk_files(*disk_dir)) {
+        File file{entry.path(), entry.last_write_time(ec), entry.file_size(ec)};
+
+        if (!ec) {
+            total += file.size;
+            files.push_back(std::move(file));
+        }
+    }
+
+    std::sort(files.begin(), files.end(), [](const File &a, const File &b) { return a.used < b.used; });
+
+    // Pruning to below the budget leaves room for a run of writes before the next scan
+    const uint64_t target = max_disk_bytes / 4 * 3;
+    uint64_t evicted = 0;
+
+    for (const auto &file : files) {
+        if (total <= target) {
+            break;
+        }
+
+        if (std::filesystem::remove(file.path, ec)) {
+            total -= file.size;
+            evicted++;
+        }
+    }
+
+    disk_bytes = total;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.disk_evictions += evicted;
+}
+
+void TranscriptCache::insert_memory(const std::string &key, const std::string &transcript) {
+    if (max_entries == 0 || memory.find(key) != memory.end()) {
+        return;
+    }
+
+    while (memory.size() >= max_entries) {
+        memory.erase(lru.back());
+        lru.pop_back();
+    }
+
+    lru.push_front(key);
+    memory.emplace(key, MemoryEntry{transcript, lru.begin()});
+}
+
+} // namespace Moonshine
@@ -0,0 +1,91 @@
+/**
+ * @file moonshine_zygote.cpp
+ * @brief Pre-fork worker spawning that shares loaded model weights copy-on-write.
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <unistd.h>
+#include "moonshine_zygote.h"
+
+
+namespace Moonshine {
+
+Zygote::Zygote(const ModelType model_type,
+               const f_path &encoder_path,
+               const f_path &decoder_path,
+               const f_path &tokenizer_path)
+    : transcriber(model_type, encoder_path, decoder_path, tokenizer_path, 1)
+{
+    // Run one second of silence through both sessions so lazy initialization
+    // (kernel selection, weight prepacking, first allocations) happens here
+    // rather than privately in every worker.
+    transcriber.transcribe(std::vector<float>(OnnxModel::get_sample_rate(), 0.0f));
+}
+
+void Zygote::add_fork_hooks(Hook prepare, Hook parent, Hook child) {
+    if (prepare) {
+        prepare_hooks.push_back(std::move(prepare));
+    }
+
+    if (parent) {
+        parent_hooks.push_back(std::move(parent));
+    }
+
+    if (child) {
+        child_hooks.push_back(std::move(child));
+    }
+}
+
+pid_t Zygote::spawn(const Worker &worker) {
+    // Prepare hooks run in reverse registration order, like pthread_atfork
+    for (auto it = prepare_hooks.rbegin(); it != prepare_hooks.rend(); ++it) {
+        (*it)();
+    }
+
+    std::fflush(nullptr);
+    pid_t pid = fork();
+
+    if (pid < 0) {
+        int err = errno;
+
+        for (auto &hook : parent_hooks) {
+            hook();
+        }
+
+        throw std::runtime_error(std::string("fork failed: ") + std::strerror(err));
+    }
+
+    if (pid > 0) {
+        for (auto &hook : parent_hooks) {
+            hook();
+        }
+
+        return pid;
+    }
+
+    int status = 1;
+
+    try {
+        for (auto &hook : child_hooks) {
+            hook();
+        }
+
+        status = worker(transcriber);
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "Moonshine::Zygote worker %d failed: %s\n", getpid(), e.what());
+    } catch (...) {
+        std::fprintf(stderr, "Moonshine::Zygote worker %d failed\n", getpid());
+    }
+
+    std::fflush(nullptr);
+    _exit(status);
+}
+
+Transcriber &Zygote::get_transcriber() noexcept {
+    return transcriber;
+}
+
+} // namespace Moonshine
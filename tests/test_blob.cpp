@@ -0,0 +1,167 @@
+/**
+ * @file test_blob.cpp
+ * @brief Round trips and corrupt input rejection of BlobWriter and BlobReader.
+ */
+
+#include <cmath>
+#include <limits>
+#include "moonshine_blob.h"
+#include "moonshine_result.h"
+#include "test_common.h"
+
+
+namespace {
+    using Moonshine::BlobReader;
+    using Moonshine::BlobWriter;
+    using Moonshine::StopReason;
+
+    /**
+     * @brief Writes a tensor shape the way put_tensor() does
+     */
+    void put_shape(BlobWriter &writer, const std::vector<int64_t> &shape) {
+        writer.put<uint32_t>(static_cast<uint32_t>(shape.size()));
+
+        for (int64_t dim : shape) {
+            writer.put<int64_t>(dim);
+        }
+    }
+}
+
+
+TEST(values_round_trip) {
+    BlobWriter writer;
+    writer.put<uint32_t>(0xDEADBEEF);
+    writer.put<int64_t>(-42);
+    writer.put<float>(1.25f);
+    writer.put_string("hello");
+    writer.put_string("");
+
+    BlobReader reader(writer.data());
+
+    CHECK(reader.take<uint32_t>() == 0xDEADBEEF);
+    CHECK(reader.take<int64_t>() == -42);
+    CHECK(reader.take<float>() == 1.25f);
+    CHECK(reader.take_string() == "hello");
+    CHECK(reader.take_string().empty());
+    CHECK(reader.remaining() == 0);
+}
+
+TEST(pcm16_round_trip_clips_and_quantizes) {
+    std::vector<float> samples{0.0f, 0.5f, -0.25f, 2.0f, -2.0f};
+    BlobWriter writer;
+    writer.put_pcm16(samples.data(), samples.size());
+
+    BlobReader reader(writer.data());
+    std::vector<float> restored;
+    reader.take_pcm16(restored, samples.size());
+
+    CHECK(restored.size() == samples.size());
+    CHECK(restored[0] == 0.0f);
+    CHECK(std::abs(restored[1] - 0.5f) < 1.0f / 32767);
+    CHECK(std::abs(restored[2] + 0.25f) < 1.0f / 32767);
+    CHECK(restored[3] == 1.0f);
+    CHECK(restored[4] == -1.0f);
+}
+
+TEST(truncated_reads_throw) {
+    BlobWriter writer;
+    writer.put<uint16_t>(7);
+    writer.put<uint32_t>(100);
+
+    BlobReader reader(writer.data());
+    reader.take<uint16_t>();
+
+    CHECK_THROWS(reader.take<uint64_t>());
+    CHECK_THROWS(reader.take_string());
+
+    std::vector<float> samples;
+    BlobReader pcm_reader(writer.data());
+    CHECK_THROWS(pcm_reader.take_pcm16(samples, 4));
+}
+
+TEST(enum_out_of_range_is_rejected) {
+    BlobWriter writer;
+    writer.put<uint8_t>(static_cast<uint8_t>(StopReason::Error));
+    writer.put<uint8_t>(static_cast<uint8_t>(StopReason::Error) + 1);
+    writer.put<uint8_t>(255);
+
+    BlobReader reader(writer.data());
+
+    CHECK(reader.take_enum(StopReason::Error) == StopReason::Error);
+    CHECK_THROWS(reader.take_enum(StopReason::Error));
+    CHECK_THROWS(reader.take_enum(StopReason::Error));
+}
+
+TEST(shape_round_trip) {
+    BlobWriter writer;
+    put_shape(writer, {1, 3, 2});
+    std::vector<float> data(6, 1.0f);
+    writer.put_bytes(data.data(), data.size() * sizeof(float));
+
+    BlobReader reader(writer.data());
+    size_t count = 0;
+
+    CHECK((reader.take_shape(sizeof(float), count) == std::vector<int64_t>{1, 3, 2}));
+    CHECK(count == 6);
+    CHECK(reader.remaining() == 6 * sizeof(float));
+}
+
+TEST(shape_with_zero_dimension_needs_no_data) {
+    BlobWriter writer;
+    put_shape(writer, {1, 8, 0, 64});
+
+    BlobReader reader(writer.data());
+    size_t count = 1;
+
+    CHECK(reader.take_shape(sizeof(float), count).size() == 4);
+    CHECK(count == 0);
+}
+
+TEST(shape_rank_is_bounded) {
+    BlobWriter huge;
+    huge.put<uint32_t>(std::numeric_limits<uint32_t>::max());
+
+    BlobWriter deep;
+    put_shape(deep, std::vector<int64_t>(BlobReader::max_rank + 1, 1));
+
+    size_t count = 0;
+    BlobReader huge_reader(huge.data());
+    BlobReader deep_reader(deep.data());
+
+    CHECK_THROWS(huge_reader.take_shape(sizeof(float), count));
+    CHECK_THROWS(deep_reader.take_shape(sizeof(float), count));
+}
+
+TEST(shape_rejects_negative_dimension) {
+    BlobWriter writer;
+    put_shape(writer, {1, -4});
+
+    BlobReader reader(writer.data());
+    size_t count = 0;
+
+    CHECK_THROWS(reader.take_shape(sizeof(float), count));
+}
+
+TEST(shape_rejects_overflowing_count) {
+    int64_t big = int64_t(1) << 40;
+    BlobWriter writer;
+    put_shape(writer, {big, big});
+
+    BlobReader reader(writer.data());
+    size_t count = 0;
+
+    CHECK_THROWS(reader.take_shape(sizeof(float), count));
+}
+
+TEST(shape_rejects_missing_data) {
+    BlobWriter writer;
+    put_shape(writer, {2, 2});
+    writer.put<float>(1.0f);
+
+    BlobReader reader(writer.data());
+    size_t count = 0;
+
+    CHECK_THROWS(reader.take_shape(sizeof(float), count));
+}
+
+MOONSHINE_TEST_MAIN()
@@ -0,0 +1,106 @@
+#ifndef MOONSHINE_TEST_COMMON_H__
+#define MOONSHINE_TEST_COMMON_H__
+
+/**
+ * @file test_common.h
+ * @brief Minimal check macros and runner for the model-free unit tests
+ *
+ * Each test file defines its cases with TEST() and ends with
+ * MOONSHINE_TEST_MAIN(). A failed CHECK reports the location and marks the
+ * case failed without stopping the remaining cases.
+ */
+
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+namespace MoonshineTest {
+
+/**
+ * @struct Case
+ * @brief A registered test case
+ */
+struct Case {
+    const char *name;               /**< Case name */
+    std::function<void()> body;     /**< Case body */
+};
+
+/**
+ * @brief Gets the cases registered in this executable
+ */
+inline std::vector<Case> &cases() {
+    static std::vector<Case> registered;
+    return registered;
+}
+
+/**
+ * @brief Gets the number of failed checks in the current case
+ */
+inline int &failures() {
+    static int count = 0;
+    return count;
+}
+
+/**
+ * @brief Registers a case at static initialization
+ */
+struct Registrar {
+    Registrar(const char *name, std::function<void()> body) { cases().push_back({name, std::move(body)}); }
+};
+
+/**
+ * @brief Records a failed check
+ */
+inline void fail(const char *expr, const char *file, int line) {
+    std::cerr << file << ':' << line << ": check failed: " << expr << std::endl;
+    failures()++;
+}
+
+/**
+ * @brief Runs every registered case
+ * @return int Process exit status, 0 if all passed
+ */
+inline int run_all() {
+    int failed = 0;
+
+    for (const auto &test : cases()) {
+        failures() = 0;
+
+        try {
+            test.body();
+        } catch (const std::exception &e) {
+            std::cerr << test.name << ": unexpected exception: " << e.what() << std::endl;
+            failures()++;
+        }
+
+        std::cout << (failures() == 0 ? "[pass] " : "[FAIL] ") << test.name << std::endl;
+        failed += failures() != 0;
+    }
+
+    return failed == 0 ? 0 : 1;
+}
+
+}
+
+#define TEST(name) \
+    static void name(); \
+    static MoonshineTest::Registrar name##_registrar(#name, name); \
+    static void name()
+
+#define CHECK(expr) \
+    do { if (!(expr)) MoonshineTest::fail(#expr, __FILE__, __LINE__); } while (0)
+
+#define CHECK_THROWS(expr) \
+    do { \
+        bool thrown = false; \
+        try { expr; } catch (const std::exception &) { thrown = true; } \
+        if (!thrown) MoonshineTest::fail("throws: " #expr, __FILE__, __LINE__); \
+    } while (0)
+
+#define MOONSHINE_TEST_MAIN() \
+    int main() { return MoonshineTest::run_all(); }
+
+#endif
@@ -0,0 +1,70 @@
+/**
+ * @file test_shortlist.cpp
+ * @brief Token list parsing, validation and logit mapping of VocabShortlist.
+ */
+
+#include <fstream>
+#include <stdexcept>
+#include "moonshine_onnx_model.h"
+#include "test_common.h"
+
+
+namespace {
+    using Moonshine::VocabShortlist;
+
+    /**
+     * @brief Writes a token list to a temporary file
+     */
+    Moonshine::f_path token_list(const std::string &name, const std::string &contents) {
+        auto path = std::filesystem::temp_directory_path() / ("moonshine_test_" + name + ".txt");
+        std::ofstream(path) << contents;
+
+        return path;
+    }
+}
+
+
+TEST(from_files_reads_ids_in_order) {
+    auto shortlist = VocabShortlist::from_files("decoder.onnx", token_list("order", "2 17\n5\t9\n"), 1.5f);
+
+    CHECK((shortlist.token_ids == std::vector<int>{2, 17, 5, 9}));
+    CHECK(shortlist.min_logit == 1.5f);
+    CHECK(shortlist.decoder_path == "decoder.onnx");
+}
+
+TEST(from_files_rejects_bad_lists) {
+    CHECK_THROWS(VocabShortlist::from_files("decoder.onnx", token_list("empty", "")));
+    CHECK_THROWS(VocabShortlist::from_files("decoder.onnx", token_list("text", "2 17 abc")));
+    CHECK_THROWS(VocabShortlist::from_files("decoder.onnx", "/nonexistent/moonshine_tokens.txt"));
+}
+
+TEST(end_token_is_required) {
+    CHECK_THROWS(VocabShortlist::from_files("decoder.onnx", token_list("no_end", "17 5 9")));
+    CHECK_THROWS((VocabShortlist{"decoder.onnx", {17, 5}, 0.0f}.validate()));
+    CHECK_THROWS((VocabShortlist{"decoder.onnx", {}, 0.0f}.validate()));
+
+    VocabShortlist{"decoder.onnx", {17, 2}, 0.0f}.validate();
+}
+
+TEST(select_maps_index_to_token) {
+    VocabShortlist shortlist{"decoder.onnx", {2, 17, 5}, 0.0f};
+
+    CHECK(shortlist.select(0, 3.0f) == 2);
+    CHECK(shortlist.select(1, 3.0f) == 17);
+    CHECK(shortlist.select(2, 0.0f) == 5);
+}
+
+TEST(select_falls_back_below_min_logit) {
+    VocabShortlist shortlist{"decoder.onnx", {2, 17, 5}, 4.0f};
+
+    CHECK(!shortlist.select(1, 3.9f).has_value());
+    CHECK(shortlist.select(1, 4.0f) == 17);
+}
+
+TEST(select_rejects_out_of_range_index) {
+    VocabShortlist shortlist{"decoder.onnx", {2, 17, 5}, 0.0f};
+
+    CHECK_THROWS(shortlist.select(3, 10.0f));
+}
+
+MOONSHINE_TEST_MAIN()
@@ -0,0 +1,115 @@
+/**
+ * @file test_silence.cpp
+ * @brief Pause boundaries of compact_silence().
+ */
+
+#include <algorithm>
+#include "moonshine_silence.h"
+#include "test_common.h"
+
+
+namespace {
+    using Moonshine::SilenceCompaction;
+    using Moonshine::compact_silence;
+
+    constexpr size_t ms = 16;   /**< Samples per millisecond at 16kHz */
+
+    /**
+     * @brief Pauses of 100ms or more keep 20ms
+     */
+    SilenceCompaction options(bool trim_edges = true) {
+        return SilenceCompaction{0.01f, 100, 20, trim_edges};
+    }
+
+    /**
+     * @brief Builds audio from alternating speech and silence lengths in ms, speech first
+     */
+    std::vector<float> audio(std::initializer_list<size_t> lengths_ms) {
+        std::vector<float> samples;
+        bool speech = true;
+
+        for (size_t length : lengths_ms) {
+            samples.insert(samples.end(), length * ms, speech ? 0.5f : 0.0f);
+            speech = !speech;
+        }
+
+        return samples;
+    }
+
+    size_t count(const std::vector<float> &samples, float value) {
+        return static_cast<size_t>(std::count(samples.begin(), samples.end(), value));
+    }
+}
+
+
+TEST(speech_is_unchanged) {
+    auto samples = audio({300});
+
+    CHECK(compact_silence(samples, options()) == samples);
+}
+
+TEST(pause_shorter_than_minimum_is_kept) {
+    auto samples = audio({100, 90, 100});
+
+    CHECK(compact_silence(samples, options()) == samples);
+}
+
+TEST(pause_of_exactly_minimum_is_shortened) {
+    auto compacted = compact_silence(audio({100, 100, 100}), options());
+
+    CHECK(compacted.size() == (100 + 20 + 100) * ms);
+    CHECK(count(compacted, 0.0f) == 20 * ms);
+}
+
+TEST(long_pause_keeps_gap_split_around_it) {
+    auto compacted = compact_silence(audio({100, 500, 100}), options());
+
+    CHECK(compacted == audio({100, 20, 100}));
+}
+
+TEST(edges_are_trimmed_to_gap) {
+    std::vector<float> samples(300 * ms, 0.0f);
+    auto speech = audio({100});
+    samples.insert(samples.end(), speech.begin(), speech.end());
+    samples.insert(samples.end(), 300 * ms, 0.0f);
+
+    auto compacted = compact_silence(samples, options());
+
+    CHECK(compacted.size() == (20 + 100 + 20) * ms);
+    CHECK(compacted.front() == 0.0f && compacted.back() == 0.0f);
+    CHECK(count(compacted, 0.5f) == 100 * ms);
+}
+
+TEST(edges_are_kept_without_trim_edges) {
+    auto samples = audio({100, 300});
+
+    CHECK(compact_silence(samples, options(false)) == samples);
+}
+
+TEST(short_edges_are_kept) {
+    auto samples = audio({100, 20});
+
+    CHECK(compact_silence(samples, options()) == samples);
+}
+
+TEST(all_silence_is_cut_to_gap) {
+    std::vector<float> samples(1000 * ms, 0.0f);
+
+    CHECK(compact_silence(samples, options()).size() == 20 * ms);
+    CHECK(compact_silence(samples, options(false)) == samples);
+}
+
+TEST(partial_last_frame_is_kept) {
+    auto samples = audio({100, 200});
+    samples.resize(samples.size() - 7, 0.0f);
+
+    auto compacted = compact_silence(samples, options());
+
+    CHECK(compacted.size() == (100 + 20) * ms);
+}
+
+TEST(empty_audio) {
+    CHECK(compact_silence({}, options()).empty());
+}
+
+MOONSHINE_TEST_MAIN()
@@ -0,0 +1,203 @@
+/**
+ * @file test_transcript_cache.cpp
+ * @brief Keying, coalescing, eviction, disk bounds and failure handling of TranscriptCache.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include "moonshine_transcript_cache.h"
+#include "test_common.h"
+
+
+namespace {
+    using Moonshine::TranscriptCache;
+
+    std::vector<float> clip(float value, size_t size = 1600) {
+        return std::vector<float>(size, value);
+    }
+
+    /**
+     * @brief Makes a fresh directory for a disk tier test
+     */
+    Moonshine::f_path temp_dir(const std::string &name) {
+        auto dir = std::filesystem::temp_directory_path() / ("moonshine_test_" + name);
+        std::filesystem::remove_all(dir);
+
+        return dir;
+    }
+}
+
+
+TEST(hit_after_miss) {
+    TranscriptCache cache(8);
+    int calls = 0;
+    auto compute = [&]() -> std::optional<std::string> { calls++; return std::string("hello"); };
+
+    CHECK(cache.get_or_compute("m", clip(0.1f), compute) == "hello");
+    CHECK(cache.get_or_compute("m", clip(0.1f), compute) == "hello");
+    CHECK(calls == 1);
+    CHECK(cache.get_stats().memory_hits == 1);
+    CHECK(cache.get_stats().misses == 1);
+}
+
+TEST(key_includes_model_id_and_audio) {
+    TranscriptCache cache(8);
+    int calls = 0;
+    auto compute = [&]() -> std::optional<std::string> { calls++; return std::to_string(calls); };
+
+    cache.get_or_compute("a", clip(0.1f), compute);
+    cache.get_or_compute("b", clip(0.1f), compute);
+    cache.get_or_compute("a", clip(0.2f), compute);
+    cache.get_or_compute("a", clip(0.1f, 1601), compute);
+
+    CHECK(calls == 4);
+}
+
+TEST(lru_evicts_oldest) {
+    TranscriptCache cache(2);
+    int calls = 0;
+    auto compute = [&]() -> std::optional<std::string> { calls++; return std::string("x"); };
+
+    cache.get_or_compute("m", clip(0.1f), compute);
+    cache.get_or_compute("m", clip(0.2f), compute);
+    cache.get_or_compute("m", clip(0.1f), compute);     // refreshes 0.1
+    cache.get_or_compute("m", clip(0.3f), compute);     // evicts 0.2
+    CHECK(calls == 3);
+
+    cache.get_or_compute("m", clip(0.1f), compute);
+    CHECK(calls == 3);
+
+    cache.get_or_compute("m", clip(0.2f), compute);
+    CHECK(calls == 4);
+}
+
+TEST(concurrent_requests_coalesce) {
+    TranscriptCache cache(8);
+    std::atomic<int> calls{0};
+    auto compute = [&]() -> std::optional<std::string> {
+        calls++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return std::string("shared");
+    };
+
+    std::vector<std::thread> threads;
+    std::vector<std::string> results(4);
+
+    for (size_t i = 0; i < results.size(); i++) {
+        threads.emplace_back([&, i]() { results[i] = cache.get_or_compute("m", clip(0.5f), compute); });
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    CHECK(calls == 1);
+
+    for (const auto &result : results) {
+        CHECK(result == "shared");
+    }
+}
+
+TEST(failed_compute_is_not_cached) {
+    auto dir = temp_dir("failed");
+    TranscriptCache cache(8, dir);
+    int calls = 0;
+    auto failing = [&]() -> std::optional<std::string> { calls++; return std::nullopt; };
+    auto working = [&]() -> std::optional<std::string> { calls++; return std::string("ok"); };
+
+    CHECK(cache.get_or_compute("m", clip(0.1f), failing).empty());
+    CHECK(cache.get_or_compute("m", clip(0.1f), working) == "ok");
+    CHECK(calls == 2);
+
+    // Nothing from the failure reached the disk tier either
+    TranscriptCache other(8, dir);
+    CHECK(other.get_or_compute("m", clip(0.1f), failing) == "ok");
+    CHECK(calls == 2);
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(throwing_compute_propagates_and_is_not_cached) {
+    TranscriptCache cache(8);
+    int calls = 0;
+    auto throwing = [&]() -> std::optional<std::string> { calls++; throw std::runtime_error("boom"); };
+    auto working = [&]() -> std::optional<std::string> { calls++; return std::string("ok"); };
+
+    CHECK_THROWS(cache.get_or_compute("m", clip(0.1f), throwing));
+    CHECK(cache.get_or_compute("m", clip(0.1f), working) == "ok");
+    CHECK(calls == 2);
+}
+
+TEST(disk_tier_survives_instances) {
+    auto dir = temp_dir("disk");
+    int calls = 0;
+    auto compute = [&]() -> std::optional<std::string> { calls++; return std::string("line one\nline two"); };
+
+    {
+        TranscriptCache cache(8, dir);
+        cache.get_or_compute("m", clip(0.1f), compute);
+    }
+
+    TranscriptCache cache(8, dir);
+    CHECK(cache.get_or_compute("m", clip(0.1f), compute) == "line one\nline two");
+    CHECK(calls == 1);
+    CHECK(cache.get_stats().disk_hits == 1);
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(disk_tier_is_bounded) {
+    auto dir = temp_dir("bounded");
+    int calls = 0;
+    auto compute = [&]() -> std::optional<std::string> { calls++; return std::string(200, 'x'); };
+    TranscriptCache cache(0, dir, 1000);
+
+    for (int i = 1; i <= 10; i++) {
+        cache.get_or_compute("m", clip(0.01f * i), compute);
+
+        uint64_t bytes = 0;
+
+        for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+            bytes += entry.file_size();
+        }
+
+        CHECK(bytes <= 1000);
+    }
+
+    CHECK(calls == 10);
+    CHECK(cache.get_stats().disk_evictions > 0);
+
+    // The newest entry survived and the oldest was deleted
+    cache.get_or_compute("m", clip(0.01f * 10), compute);
+    CHECK(calls == 10);
+    cache.get_or_compute("m", clip(0.01f * 1), compute);
+    CHECK(calls == 11);
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(disk_hits_protect_from_pruning) {
+    auto dir = temp_dir("lru");
+    int calls = 0;
+    auto compute = [&]() -> std::optional<std::string> { calls++; return std::string(200, 'x'); };
+    TranscriptCache cache(0, dir, 1000);
+
+    for (int i = 1; i <= 4; i++) {
+        cache.get_or_compute("m", clip(0.01f * i), compute);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    cache.get_or_compute("m", clip(0.01f * 1), compute);    // refreshes the oldest
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    cache.get_or_compute("m", clip(0.01f * 5), compute);    // prunes
+    CHECK(calls == 5);
+
+    cache.get_or_compute("m", clip(0.01f * 1), compute);
+    CHECK(calls == 5);
+
+    std::filesystem::remove_all(dir);
+}
+
+MOONSHINE_TEST_MAIN()